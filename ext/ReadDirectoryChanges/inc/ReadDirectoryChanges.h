@@ -117,6 +117,19 @@ public:
 	/// </remarks>
 	void AddDirectory(LPCTSTR wszDirectory, UINT32 token, BOOL bWatchSubtree, DWORD dwNotifyFilter, DWORD dwBufferSize = 16384);
 
+	/// <summary>
+	/// Stop monitoring directories added with the given token.
+	/// </summary>
+	/// <param name="token">Token passed to AddDirectory.</param>
+	/// <remarks>
+	/// <para>
+	/// This function will make an APC call to the worker thread to cancel
+	/// the outstanding ReadDirectoryChangesW calls for the token. Notifications
+	/// already queued for the token may still be popped.
+	/// </para>
+	/// </remarks>
+	void RemoveWatch(UINT32 token);
+
 	/// <summary>
 	/// Return a handle for the Win32 Wait... functions that will be
 	/// signaled when there is a queue entry.
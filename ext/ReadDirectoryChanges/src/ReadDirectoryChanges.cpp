@@ -86,6 +86,15 @@ void CReadDirectoryChanges::AddDirectory(LPCTSTR szDirectory, UINT32 token, BOOL
 	QueueUserAPC(CReadChangesServer::AddDirectoryProc, m_hThread, (ULONG_PTR)pRequest);
 }
 
+void CReadDirectoryChanges::RemoveWatch(UINT32 token)
+{
+	if (!m_hThread)
+		return;
+
+	CReadChangesServer::RemoveWatchRequest* pRequest = new CReadChangesServer::RemoveWatchRequest{ m_pServer, token };
+	QueueUserAPC(CReadChangesServer::RemoveWatchProc, m_hThread, (ULONG_PTR)pRequest);
+}
+
 void CReadDirectoryChanges::Push(UINT32 token, DWORD dwAction, CStringW& wstrFilename)
 {
 	m_Notifications.push( TDirectoryChangeNotification(token, dwAction, wstrFilename) );
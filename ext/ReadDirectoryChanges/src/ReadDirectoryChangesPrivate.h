@@ -67,6 +67,8 @@ public:
 		m_hDirectory = nullptr;
 	}
 
+	UINT32 GetToken() const { return m_token; }
+
 	CReadChangesServer* m_pServer;
 
 protected:
@@ -137,6 +139,21 @@ public:
 		pRequest->m_pServer->AddDirectory(pRequest);
 	}
 
+	// Identifies directories to stop monitoring. Allocated by the caller of QueueUserAPC.
+	struct RemoveWatchRequest
+	{
+		CReadChangesServer* pServer;
+		UINT32 token;
+	};
+
+	// Called by QueueUserAPC to stop monitoring directories for a token.
+	static void CALLBACK RemoveWatchProc(__in  ULONG_PTR arg)
+	{
+		RemoveWatchRequest* pRequest = (RemoveWatchRequest*)arg;
+		pRequest->pServer->RemoveWatch(pRequest->token);
+		delete pRequest;
+	}
+
 	CReadDirectoryChanges* m_pBase;
 
 	volatile DWORD m_nOutstandingRequests;
@@ -162,6 +179,21 @@ protected:
 		else
 			delete pBlock;
 	}
+
+	void RemoveWatch( UINT32 token )
+	{
+		for (auto it = m_pBlocks.begin(); it != m_pBlocks.end(); )
+		{
+			if ((*it)->GetToken() == token)
+			{
+				// Request object will delete itself once the read is aborted.
+				(*it)->RequestTermination();
+				it = m_pBlocks.erase(it);
+			}
+			else
+				++it;
+		}
+	}
 	
 	void RequestTermination()
 	{
@@ -0,0 +1,163 @@
+#include "stdafx.h"
+#include "AheadBehindCache.h"
+
+/*static*/ std::string AheadBehindCache::MakeKey(const git_oid* local, const git_oid* upstream)
+{
+	std::string key(reinterpret_cast<const char*>(local->id), GIT_OID_RAWSZ);
+	key.append(reinterpret_cast<const char*>(upstream->id), GIT_OID_RAWSZ);
+	return key;
+}
+
+/*static*/ bool AheadBehindCache::CountNewCommits(
+	size_t& newCommits,
+	size_t& newCommitsNotInOther,
+	git_repository* repository,
+	const git_oid* tip,
+	const git_oid* previousTip,
+	const git_oid* other)
+{
+	auto countCommits = [repository, tip, previousTip](size_t& count, const git_oid* hiddenTip)
+	{
+		count = 0;
+		auto revwalk = MakeUniqueGitRevwalk(nullptr);
+		if (git_revwalk_new(&revwalk.get(), repository) != GIT_OK
+			|| git_revwalk_push(revwalk.get(), tip) != GIT_OK
+			|| git_revwalk_hide(revwalk.get(), previousTip) != GIT_OK
+			|| (hiddenTip != nullptr && git_revwalk_hide(revwalk.get(), hiddenTip) != GIT_OK))
+		{
+			return false;
+		}
+
+		git_oid commit;
+		while (git_revwalk_next(&commit, revwalk.get()) == GIT_OK)
+		{
+			if (++count > MaximumIncrementalCommits)
+				return false;
+		}
+		return true;
+	};
+
+	return countCommits(newCommits, nullptr) && countCommits(newCommitsNotInOther, other);
+}
+
+/*static*/ bool AheadBehindCache::Advance(
+	size_t& thisSide,
+	size_t& otherSide,
+	git_repository* repository,
+	const git_oid* tip,
+	const git_oid* previousTip,
+	const git_oid* other)
+{
+	if (git_oid_equal(tip, previousTip))
+		return true;
+
+	if (git_graph_descendant_of(repository, tip, previousTip) != 1)
+		return false;
+
+	size_t newCommits;
+	size_t newCommitsNotInOther;
+	if (!AheadBehindCache::CountNewCommits(newCommits, newCommitsNotInOther, repository, tip, previousTip, other))
+		return false;
+
+	auto newCommitsInOther = newCommits - newCommitsNotInOther;
+	if (newCommitsInOther > otherSide)
+		return false;
+
+	thisSide += newCommitsNotInOther;
+	otherSide -= newCommitsInOther;
+	return true;
+}
+
+/*static*/ bool AheadBehindCache::TryComputeIncrementally(AheadBehind& result, const AheadBehind& previous, git_repository* repository)
+{
+	auto aheadBy = previous.AheadBy;
+	auto behindBy = previous.BehindBy;
+
+	// Advance local against the previous upstream, then upstream against the new local.
+	if (!AheadBehindCache::Advance(aheadBy, behindBy, repository, &result.Local, &previous.Local, &previous.Upstream))
+		return false;
+	if (!AheadBehindCache::Advance(behindBy, aheadBy, repository, &result.Upstream, &previous.Upstream, &result.Local))
+		return false;
+
+	result.AheadBy = aheadBy;
+	result.BehindBy = behindBy;
+	return true;
+}
+
+void AheadBehindCache::Store(const std::string& repositoryPath, const AheadBehind& result)
+{
+	auto key = MakeKey(&result.Local, &result.Upstream);
+
+	WriteLock writeLock(m_mutex);
+	m_lastByRepository[repositoryPath] = result;
+
+	auto existingEntry = m_entriesByKey.find(key);
+	if (existingEntry != m_entriesByKey.end())
+	{
+		m_entries.splice(m_entries.begin(), m_entries, existingEntry->second);
+		return;
+	}
+
+	m_entries.push_front(result);
+	m_entriesByKey[key] = m_entries.begin();
+	if (m_entries.size() > MaximumEntries)
+	{
+		m_entriesByKey.erase(MakeKey(&m_entries.back().Local, &m_entries.back().Upstream));
+		m_entries.pop_back();
+	}
+}
+
+int AheadBehindCache::GetAheadBehind(
+	size_t& aheadBy,
+	size_t& behindBy,
+	const std::string& repositoryPath,
+	git_repository* repository,
+	const git_oid* local,
+	const git_oid* upstream)
+{
+	auto key = MakeKey(local, upstream);
+	auto hasPrevious = false;
+	AheadBehind previous;
+	{
+		WriteLock writeLock(m_mutex);
+		auto entry = m_entriesByKey.find(key);
+		if (entry != m_entriesByKey.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, entry->second);
+			aheadBy = entry->second->AheadBy;
+			behindBy = entry->second->BehindBy;
+			m_lastByRepository[repositoryPath] = *entry->second;
+			return GIT_OK;
+		}
+
+		auto last = m_lastByRepository.find(repositoryPath);
+		if (last != m_lastByRepository.end())
+		{
+			hasPrevious = true;
+			previous = last->second;
+		}
+	}
+
+	AheadBehind result;
+	result.Local = *local;
+	result.Upstream = *upstream;
+
+	if (hasPrevious && AheadBehindCache::TryComputeIncrementally(result, previous, repository))
+	{
+		Log("AheadBehindCache.GetAheadBehind.Incremental", Severity::Verbose)
+			<< R"(Updated ahead/behind from previous commit pair. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "aheadBy": )" << result.AheadBy
+			<< R"(, "behindBy": )" << result.BehindBy << R"( })";
+	}
+	else
+	{
+		auto errorCode = git_graph_ahead_behind(&result.AheadBy, &result.BehindBy, repository, local, upstream);
+		if (errorCode != GIT_OK)
+			return errorCode;
+	}
+
+	Store(repositoryPath, result);
+	aheadBy = result.AheadBy;
+	behindBy = result.BehindBy;
+	return GIT_OK;
+}
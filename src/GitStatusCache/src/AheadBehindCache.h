@@ -0,0 +1,94 @@
+#pragma once
+#include <list>
+
+/**
+* LRU memo of ahead/behind counts keyed by (local, upstream) commit pair. When either side
+* fast-forwards from the last pair computed for a repository, counts are updated by walking
+* only the new commits instead of the whole history.
+* This class is thread-safe.
+*/
+class AheadBehindCache : boost::noncopyable
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	/**
+	* Ahead/behind counts for a commit pair.
+	*/
+	struct AheadBehind
+	{
+		git_oid Local;
+		git_oid Upstream;
+		size_t AheadBy;
+		size_t BehindBy;
+	};
+
+	/**
+	* Maximum number of commit pairs retained.
+	*/
+	static const size_t MaximumEntries = 1024;
+
+	/**
+	* Walks with more new commits than this fall back to a full ahead/behind computation.
+	*/
+	static const size_t MaximumIncrementalCommits = 10000;
+
+	std::list<AheadBehind> m_entries;
+	std::unordered_map<std::string, std::list<AheadBehind>::iterator> m_entriesByKey;
+	std::unordered_map<std::string, AheadBehind> m_lastByRepository;
+	boost::shared_mutex m_mutex;
+
+	/**
+	* Builds lookup key for commit pair.
+	*/
+	static std::string MakeKey(const git_oid* local, const git_oid* upstream);
+
+	/**
+	* Counts commits reachable from tip but not from previous tip, and how many of those are
+	* also not reachable from other.
+	*/
+	static bool CountNewCommits(
+		size_t& newCommits,
+		size_t& newCommitsNotInOther,
+		git_repository* repository,
+		const git_oid* tip,
+		const git_oid* previousTip,
+		const git_oid* other);
+
+	/**
+	* Updates counts after one side fast-forwarded from previous tip to tip. Commits new to
+	* this side are either also reachable from the other side (reducing the other side's count)
+	* or are not (increasing this side's count).
+	*/
+	static bool Advance(
+		size_t& thisSide,
+		size_t& otherSide,
+		git_repository* repository,
+		const git_oid* tip,
+		const git_oid* previousTip,
+		const git_oid* other);
+
+	/**
+	* Attempts to derive counts from the last pair computed for the repository.
+	*/
+	static bool TryComputeIncrementally(AheadBehind& result, const AheadBehind& previous, git_repository* repository);
+
+	/**
+	* Records counts for pair and marks it most recently used.
+	*/
+	void Store(const std::string& repositoryPath, const AheadBehind& result);
+
+public:
+	/**
+	* Retrieves number of commits local is ahead of and behind upstream.
+	* Returns libgit2 error code on failure.
+	*/
+	int GetAheadBehind(
+		size_t& aheadBy,
+		size_t& behindBy,
+		const std::string& repositoryPath,
+		git_repository* repository,
+		const git_oid* local,
+		const git_oid* upstream);
+};
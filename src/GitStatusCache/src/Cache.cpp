@@ -1,110 +1,968 @@
-#include "stdafx.h"
-#include "Cache.h"
-
-std::tuple<bool, Git::Status> Cache::GetStatus(const std::string& repositoryPath)
-{
-	auto foundResultInCache = false;
-	std::tuple<bool, Git::Status> cachedStatus;
-
-	{
-		ReadLock readLock(m_cacheMutex);
-		auto cacheEntry = m_cache.find(repositoryPath);
-		if (cacheEntry != m_cache.end())
-		{
-			foundResultInCache = true;
-			cachedStatus = cacheEntry->second;
-		}
-	}
-
-	if (foundResultInCache)
-	{
-		++m_cacheHits;
-		Log("Cache.GetStatus.CacheHit", Severity::Info)
-			<< R"(Found git status in cache. { "repositoryPath": ")" << repositoryPath << R"(" })";
-		return cachedStatus;
-	}
-
-	++m_cacheMisses;
-	Log("Cache.GetStatus.CacheMiss", Severity::Warning)
-		<< R"(Failed to find git status in cache. { "repositoryPath": ")" << repositoryPath << R"(" })";
-
-	auto status = m_git.GetStatus(repositoryPath);
-
-	{
-		WriteLock writeLock(m_cacheMutex);
-		m_cache[repositoryPath] = status;
-	}
-
-	return status;
-}
-
-void Cache::PrimeCacheEntry(const std::string& repositoryPath)
-{
-	++m_cacheTotalPrimeRequests;
-	{
-		ReadLock readLock(m_cacheMutex);
-		auto cacheEntry = m_cache.find(repositoryPath);
-		if (cacheEntry != m_cache.end())
-			return;
-	}
-
-	++m_cacheEffectivePrimeRequests;
-	Log("Cache.PrimeCacheEntry", Severity::Info)
-		<< R"(Priming cache entry. { "repositoryPath": ")" << repositoryPath << R"(" })";
-
-	auto status = m_git.GetStatus(repositoryPath);
-
-	{
-		WriteLock writeLock(m_cacheMutex);
-		m_cache[repositoryPath] = status;
-	}
-}
-
-bool Cache::InvalidateCacheEntry(const std::string& repositoryPath)
-{
-	++m_cacheTotalInvalidationRequests;
-	bool invalidatedCacheEntry = false;
-	{
-		UpgradableLock readLock(m_cacheMutex);
-		auto cacheEntry = m_cache.find(repositoryPath);
-		if (cacheEntry != m_cache.end())
-		{
-			UpgradedLock writeLock(readLock);
-			cacheEntry = m_cache.find(repositoryPath);
-			if (cacheEntry != m_cache.end())
-			{
-				m_cache.erase(cacheEntry);
-				invalidatedCacheEntry = true;
-			}
-		}
-	}
-
-	if (invalidatedCacheEntry)
-		++m_cacheEffectiveInvalidationRequests;
-	return invalidatedCacheEntry;
-}
-
-void Cache::InvalidateAllCacheEntries()
-{
-	++m_cacheInvalidateAllRequests;
-	{
-		WriteLock writeLock(m_cacheMutex);
-		m_cache.clear();
-	}
-
-	Log("Cache.InvalidateAllCacheEntries.", Severity::Warning)
-		<< R"(Invalidated all git status information in cache.)";
-}
-
-CacheStatistics Cache::GetCacheStatistics()
-{
-	CacheStatistics statistics;
-	statistics.CacheHits = m_cacheHits;
-	statistics.CacheMisses = m_cacheMisses;
-	statistics.CacheEffectivePrimeRequests = m_cacheEffectivePrimeRequests;
-	statistics.CacheTotalPrimeRequests = m_cacheTotalPrimeRequests;
-	statistics.CacheEffectiveInvalidationRequests = m_cacheEffectiveInvalidationRequests;
-	statistics.CacheTotalInvalidationRequests = m_cacheTotalInvalidationRequests;
-	statistics.CacheInvalidateAllRequests = m_cacheInvalidateAllRequests;
-	return statistics;
-}
+#include "stdafx.h"
+#include "Cache.h"
+#include <malloc.h>
+#include <boost/algorithm/string.hpp>
+
+size_t CountIndexChanges(const FileStatus& files)
+{
+	return files.GetCount(FileStatus::IndexAdded)
+		+ files.GetCount(FileStatus::IndexModified)
+		+ files.GetCount(FileStatus::IndexDeleted)
+		+ files.GetCount(FileStatus::IndexTypeChange)
+		+ files.GetCount(FileStatus::IndexRenamed);
+}
+
+size_t CountWorkingChanges(const FileStatus& files)
+{
+	return files.GetCount(FileStatus::WorkingAdded)
+		+ files.GetCount(FileStatus::WorkingModified)
+		+ files.GetCount(FileStatus::WorkingDeleted)
+		+ files.GetCount(FileStatus::WorkingTypeChange)
+		+ files.GetCount(FileStatus::WorkingRenamed)
+		+ files.GetCount(FileStatus::WorkingUnreadable);
+}
+
+bool IsSubmoduleModified(const Git::Submodule& submodule)
+{
+	return submodule.HasNewCommits || submodule.IndexChanges != 0 || submodule.WorkingChanges != 0 || submodule.Conflicted != 0;
+}
+
+uint64_t GetCurrentFileTime()
+{
+	FILETIME now;
+	::GetSystemTimeAsFileTime(&now);
+	return (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+}
+
+uint64_t GetHeapSize(const std::string& value)
+{
+	// Short strings are stored inline and only account for the size of the string itself.
+	auto capacity = value.capacity() + 1;
+	return capacity > sizeof(std::string) ? capacity : 0;
+}
+
+uint64_t GetSizeInBytes(const Git::Status& status)
+{
+	auto size = uint64_t{ sizeof(Git::Status) }
+		+ GetHeapSize(status.RepositoryPath)
+		+ GetHeapSize(status.CommonDirectory)
+		+ GetHeapSize(status.WorkingDirectory)
+		+ GetHeapSize(status.State)
+		+ GetHeapSize(status.Branch)
+		+ GetHeapSize(status.HeadSha1Id)
+		+ GetHeapSize(status.Upstream)
+		+ status.Files.GetSizeInBytes()
+		+ status.Stashes.capacity() * sizeof(Git::Stash)
+		+ status.Submodules.capacity() * sizeof(Git::Submodule);
+
+	for (const auto& stash : status.Stashes)
+		size += GetHeapSize(stash.Sha1Id) + GetHeapSize(stash.Message);
+
+	for (const auto& submodule : status.Submodules)
+	{
+		size += GetHeapSize(submodule.Path)
+			+ GetHeapSize(submodule.WorkingDirectory)
+			+ GetHeapSize(submodule.RepositoryPath)
+			+ GetHeapSize(submodule.IndexSha1Id)
+			+ GetHeapSize(submodule.Branch)
+			+ GetHeapSize(submodule.HeadSha1Id);
+	}
+
+	return size;
+}
+
+std::string NormalizeRepositoryPath(std::string path)
+{
+	std::replace(path.begin(), path.end(), '\\', '/');
+	if (!path.empty() && path.back() != '/')
+		path.push_back('/');
+	return path;
+}
+
+Cache::Cache(const GitSettings& gitSettings)
+	: m_git(gitSettings)
+	, m_submoduleThreadCount(gitSettings.ParallelStatusThreads != 0
+		? gitSettings.ParallelStatusThreads
+		: (std::max)(std::thread::hardware_concurrency(), 1u))
+	, m_maximumCacheBytes(static_cast<uint64_t>(gitSettings.CacheMemoryBudgetInMegabytes) * 1024 * 1024)
+{
+	for (const auto& pinnedRepository : gitSettings.PinnedRepositories)
+		m_pinnedRepositories.push_back(NormalizeRepositoryPath(pinnedRepository));
+}
+
+/*static*/ void* Cache::operator new(size_t size)
+{
+	auto cache = ::_aligned_malloc(size, alignof(Cache));
+	if (cache == nullptr)
+		throw std::bad_alloc();
+	return cache;
+}
+
+/*static*/ void Cache::operator delete(void* cache)
+{
+	::_aligned_free(cache);
+}
+
+Cache::CacheShard& Cache::GetShard(const std::string& repositoryPath)
+{
+	return m_shards[std::hash<std::string>()(repositoryPath) % ShardCount];
+}
+
+std::shared_ptr<Cache::CacheEntry> Cache::FindCacheEntry(const std::string& repositoryPath)
+{
+	auto& shard = Cache::GetShard(repositoryPath);
+	ReadLock readLock(shard.Mutex);
+	auto cacheEntry = shard.Entries.find(repositoryPath);
+	return cacheEntry != shard.Entries.end() ? cacheEntry->second : nullptr;
+}
+
+std::shared_ptr<Cache::CacheEntry> Cache::GetOrAddCacheEntry(const std::string& repositoryPath)
+{
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	if (cacheEntry != nullptr)
+		return cacheEntry;
+
+	auto& shard = Cache::GetShard(repositoryPath);
+	WriteLock writeLock(shard.Mutex);
+	auto& newCacheEntry = shard.Entries[repositoryPath];
+	if (newCacheEntry == nullptr)
+	{
+		newCacheEntry = std::make_shared<CacheEntry>();
+		newCacheEntry->Pinned = Cache::IsPinned(repositoryPath);
+	}
+	return newCacheEntry;
+}
+
+/*static*/ void Cache::TouchCacheEntry(CacheEntry& cacheEntry)
+{
+	// Clock rather than a shared counter so hits on different entries don't contend.
+	cacheEntry.LastAccess = static_cast<uint64_t>(Clock::now().time_since_epoch().count());
+}
+
+bool Cache::IsPinned(const std::string& repositoryPath) const
+{
+	// Pins may name the working directory of a repository or its repository directory.
+	for (const auto& pinnedRepository : m_pinnedRepositories)
+	{
+		if (boost::iequals(repositoryPath, pinnedRepository) || boost::iequals(repositoryPath, pinnedRepository + ".git/"))
+			return true;
+	}
+	return false;
+}
+
+/*static*/ uint64_t Cache::GetSizeInBytes(const Snapshot& snapshot)
+{
+	auto size = uint64_t{ sizeof(Snapshot) };
+	if (snapshot.Status != nullptr)
+		size += ::GetSizeInBytes(*snapshot.Status);
+
+	// Each rendered status is a hash node holding the key, the value, and a link.
+	for (const auto& renderedStatus : snapshot.RenderedStatuses)
+		size += sizeof(renderedStatus) + sizeof(void*) + GetHeapSize(renderedStatus.first) + GetHeapSize(renderedStatus.second);
+	size += snapshot.RenderedStatuses.bucket_count() * sizeof(void*);
+
+	return size;
+}
+
+void Cache::PublishSnapshot(CacheEntry& cacheEntry, const std::string& repositoryPath, const std::shared_ptr<const Snapshot>& snapshot)
+{
+	std::atomic_store(&cacheEntry.CurrentSnapshot, snapshot);
+	if (cacheEntry.Evicted)
+		return;
+
+	// Pooled indexes and untracked directories are released with the entry, so they count
+	// toward its share of the budget.
+	auto sizeInBytes = sizeof(CacheEntry) + repositoryPath.size() + Cache::GetSizeInBytes(*snapshot)
+		+ m_git.GetRetainedSizeInBytes(repositoryPath);
+	m_cacheBytes += sizeInBytes;
+	m_cacheBytes -= cacheEntry.SizeInBytes;
+	cacheEntry.SizeInBytes = sizeInBytes;
+}
+
+void Cache::EvictCacheEntries(const std::string& retainedRepositoryPath)
+{
+	if (m_maximumCacheBytes == 0 || m_cacheBytes <= m_maximumCacheBytes)
+		return;
+
+	// Concurrent evictions would pick the same victims.
+	std::unique_lock<std::mutex> evictionLock(m_evictionMutex, std::try_to_lock);
+	if (!evictionLock.owns_lock())
+		return;
+
+	std::vector<std::pair<uint64_t, std::string>> candidates;
+	for (auto& shard : m_shards)
+	{
+		ReadLock readLock(shard.Mutex);
+		for (const auto& cacheEntry : shard.Entries)
+		{
+			if (!cacheEntry.second->Pinned && cacheEntry.first != retainedRepositoryPath)
+				candidates.emplace_back(cacheEntry.second->LastAccess.load(), cacheEntry.first);
+		}
+	}
+
+	// Submodules are summarized in their parents' status and stay cached with them.
+	std::vector<std::string> parentRepositoryPaths;
+	for (auto candidate = candidates.begin(); candidate != candidates.end();)
+	{
+		parentRepositoryPaths.clear();
+		{
+			ReadLock readLock(m_submoduleParentsMutex);
+			auto parents = m_submoduleParents.find(candidate->second);
+			if (parents != m_submoduleParents.end())
+				parentRepositoryPaths.assign(parents->second.begin(), parents->second.end());
+		}
+
+		if (std::any_of(
+			parentRepositoryPaths.begin(),
+			parentRepositoryPaths.end(),
+			[this](const std::string& parentRepositoryPath) { return FindCacheEntry(parentRepositoryPath) != nullptr; }))
+		{
+			candidate = candidates.erase(candidate);
+		}
+		else
+		{
+			++candidate;
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	for (const auto& candidate : candidates)
+	{
+		if (m_cacheBytes <= m_maximumCacheBytes)
+			break;
+		Cache::EvictCacheEntry(candidate.second);
+	}
+
+	if (m_cacheBytes > m_maximumCacheBytes)
+	{
+		Log("Cache.EvictCacheEntries.OverBudget", Severity::Warning)
+			<< R"(Cache exceeds memory budget after evicting every eligible entry. { "cacheBytes": )" << m_cacheBytes
+			<< R"(, "maximumCacheBytes": )" << m_maximumCacheBytes << R"( })";
+	}
+}
+
+bool Cache::EvictCacheEntry(const std::string& repositoryPath)
+{
+	std::shared_ptr<CacheEntry> cacheEntry;
+	{
+		auto& shard = Cache::GetShard(repositoryPath);
+		WriteLock writeLock(shard.Mutex);
+		auto iterator = shard.Entries.find(repositoryPath);
+		if (iterator == shard.Entries.end())
+			return false;
+		cacheEntry = iterator->second;
+		shard.Entries.erase(iterator);
+	}
+
+	uint64_t sizeInBytes = 0;
+	{
+		// Computations still in progress publish to the removed entry without counting it.
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		cacheEntry->Evicted = true;
+		sizeInBytes = cacheEntry->SizeInBytes;
+		m_cacheBytes -= sizeInBytes;
+		cacheEntry->SizeInBytes = 0;
+	}
+
+	{
+		WriteLock writeLock(m_submoduleParentsMutex);
+		m_submoduleParents.erase(repositoryPath);
+		for (auto parents = m_submoduleParents.begin(); parents != m_submoduleParents.end();)
+		{
+			parents->second.erase(repositoryPath);
+			if (parents->second.empty())
+				parents = m_submoduleParents.erase(parents);
+			else
+				++parents;
+		}
+	}
+
+	m_git.EvictRepository(repositoryPath);
+
+	++m_cacheEvictions;
+	Log("Cache.EvictCacheEntry", Severity::Info)
+		<< R"(Evicted least recently used repository. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "sizeInBytes": )" << sizeInBytes
+		<< R"(, "cacheBytes": )" << m_cacheBytes << R"( })";
+
+	ReadLock readLock(m_onEvictedCallbackMutex);
+	if (m_onEvictedCallback != nullptr)
+		m_onEvictedCallback(repositoryPath);
+	return true;
+}
+
+/*static*/ std::shared_ptr<const Cache::Snapshot> Cache::GetUsableSnapshot(const CacheEntry& cacheEntry, uint32_t components)
+{
+	auto snapshot = std::atomic_load(&cacheEntry.CurrentSnapshot);
+	if (snapshot == nullptr || snapshot->Generation != cacheEntry.Generation)
+		return nullptr;
+
+	if (snapshot->Succeeded && (snapshot->Status->Components & components) != components)
+		return nullptr;
+
+	return snapshot;
+}
+
+/*static*/ std::shared_ptr<const Cache::Computation> Cache::FindJoinableComputation(
+	const CacheEntry& cacheEntry,
+	uint64_t generation,
+	uint32_t components)
+{
+	const auto& computation = cacheEntry.InProgress;
+	if (computation == nullptr || computation->Generation != generation || (computation->Components & components) != components)
+		return nullptr;
+	return computation;
+}
+
+std::shared_ptr<const Cache::Snapshot> Cache::ComputeStatus(const std::string& repositoryPath, uint32_t components, bool joinComputation)
+{
+	auto cacheEntry = GetOrAddCacheEntry(repositoryPath);
+	Cache::TouchCacheEntry(*cacheEntry);
+
+	// Read before any file so changes made while computing count as newer than the status.
+	auto computeStartTime = GetCurrentFileTime();
+	auto hasValidStatus = false;
+	auto canRecomputeIncrementally = false;
+	uint64_t generation = 0;
+	std::shared_ptr<const Git::Status> previousStatus;
+	std::unordered_set<std::string> dirtyPaths;
+	std::shared_ptr<const Computation> joinedComputation;
+	std::shared_ptr<const Computation> computation;
+	std::promise<std::shared_ptr<const Snapshot>> result;
+
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		generation = cacheEntry->Generation;
+		if (joinComputation)
+			joinedComputation = Cache::FindJoinableComputation(*cacheEntry, generation, components);
+		auto snapshot = joinedComputation == nullptr ? std::atomic_load(&cacheEntry->CurrentSnapshot) : nullptr;
+		// Restored status is never reused since the computation verifies it.
+		if (snapshot != nullptr && snapshot->Succeeded && !snapshot->Restored)
+		{
+			// Entries invalidated only because a submodule changed have nothing of their own
+			// to recompute.
+			hasValidStatus = snapshot->Generation == generation
+				|| (!cacheEntry->RequiresFullRecompute && cacheEntry->DirtyPaths.empty());
+			canRecomputeIncrementally = !hasValidStatus
+				&& !cacheEntry->RequiresFullRecompute
+				&& (snapshot->Status->Components & Git::FileStatusComponent) != 0
+				&& !cacheEntry->DirtyPaths.empty();
+			if (hasValidStatus || canRecomputeIncrementally)
+			{
+				previousStatus = snapshot->Status;
+				computeStartTime = (std::min)(computeStartTime, snapshot->ComputeStartTime);
+			}
+			if (canRecomputeIncrementally)
+				dirtyPaths = cacheEntry->DirtyPaths;
+		}
+
+		if (joinedComputation == nullptr)
+		{
+			// Incremental recomputes always include file status.
+			auto computedComponents = components | (hasValidStatus ? previousStatus->Components : 0);
+			if (canRecomputeIncrementally)
+				computedComponents |= Git::FileStatusComponent;
+			computation = std::make_shared<const Computation>(Computation{ generation, computedComponents, result.get_future().share() });
+
+			// Computation that wasn't joined stays joinable by callers that need its components.
+			if (Cache::FindJoinableComputation(*cacheEntry, generation, computedComponents) == nullptr)
+				cacheEntry->InProgress = computation;
+		}
+	}
+
+	if (joinedComputation != nullptr)
+	{
+		++m_cacheCoalescedComputations;
+		Log("Cache.ComputeStatus.JoinedComputation", Severity::Verbose)
+			<< R"(Waiting on status computation already in progress. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		try
+		{
+			return joinedComputation->Result.get();
+		}
+		catch (const std::exception& exception)
+		{
+			// Computation failed on the thread that started it. Its caller sees the original
+			// error, so compute here instead of failing a request that joined it.
+			Log("Cache.ComputeStatus.JoinedComputationAbandoned", Severity::Warning)
+				<< R"(Joined status computation was abandoned. Computing status instead. { "repositoryPath": ")" << repositoryPath
+				<< R"(", "exception": ")" << exception.what() << R"(" })";
+		}
+		return Cache::ComputeStatus(repositoryPath, components, false /*joinComputation*/);
+	}
+
+	// Callers waiting on the computation must not be left waiting if it fails unexpectedly.
+	auto abandonComputation = std::experimental::scope_guard([&cacheEntry, &computation, &result]()
+	{
+		{
+			std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+			if (cacheEntry->InProgress == computation)
+				cacheEntry->InProgress = nullptr;
+		}
+		result.set_exception(std::make_exception_ptr(std::runtime_error("Status computation was abandoned.")));
+	});
+
+	std::tuple<bool, Git::Status> status;
+	if (hasValidStatus)
+	{
+		// Nothing changed since the cached status was computed, so only missing components
+		// need to be retrieved.
+		auto missingComponents = components & ~previousStatus->Components;
+		if (missingComponents == 0)
+		{
+			status = std::make_tuple(true, *previousStatus);
+		}
+		else
+		{
+			status = m_git.GetStatus(repositoryPath, missingComponents);
+			if (std::get<0>(status))
+				Git::CopyStatusComponents(std::get<1>(status), *previousStatus, previousStatus->Components);
+		}
+	}
+	else if (canRecomputeIncrementally)
+	{
+		// Keeps file status up to date even if not requested since it's cheap to recompute
+		// for a few dirty paths and expensive to rebuild later.
+		++m_cacheIncrementalRecomputes;
+		status = m_git.GetStatus(repositoryPath, *previousStatus, dirtyPaths, components);
+	}
+	else
+	{
+		status = m_git.GetStatus(repositoryPath, components);
+	}
+
+	if (std::get<0>(status) && (std::get<1>(status).Components & Git::SubmoduleComponent) != 0)
+		SummarizeSubmodules(repositoryPath, std::get<1>(status));
+
+	auto snapshot = std::make_shared<Snapshot>();
+	snapshot->Succeeded = std::get<0>(status);
+	snapshot->Status = std::make_shared<const Git::Status>(std::move(std::get<1>(status)));
+	snapshot->Generation = generation;
+	snapshot->ComputeStartTime = computeStartTime;
+
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		// Changes reported while computing aren't reflected in the status. In that case leave
+		// the entry invalidated so the next request recomputes with every dirty path.
+		if (cacheEntry->Generation == generation)
+		{
+			Cache::PublishSnapshot(*cacheEntry, repositoryPath, snapshot);
+			cacheEntry->RequiresFullRecompute = false;
+			cacheEntry->DirtyPaths.clear();
+		}
+
+		if (cacheEntry->InProgress == computation)
+			cacheEntry->InProgress = nullptr;
+	}
+
+	abandonComputation.release();
+	result.set_value(snapshot);
+	Cache::EvictCacheEntries(repositoryPath);
+	return snapshot;
+}
+
+void Cache::SummarizeSubmodules(const std::string& repositoryPath, Git::Status& status)
+{
+	// Registered before submodule entries are read so changes to a submodule while summarizing
+	// invalidate the parent.
+	{
+		WriteLock writeLock(m_submoduleParentsMutex);
+		for (const auto& submodule : status.Submodules)
+		{
+			if (!submodule.RepositoryPath.empty())
+				m_submoduleParents[submodule.RepositoryPath].insert(repositoryPath);
+		}
+	}
+
+	std::vector<std::shared_ptr<const Snapshot>> snapshots(status.Submodules.size());
+	std::vector<size_t> uncachedSubmodules;
+	for (auto i = size_t{ 0 }; i < status.Submodules.size(); ++i)
+	{
+		const auto& submoduleRepositoryPath = status.Submodules[i].RepositoryPath;
+		if (submoduleRepositoryPath.empty())
+			continue;
+
+		auto cacheEntry = FindCacheEntry(submoduleRepositoryPath);
+		if (cacheEntry != nullptr)
+		{
+			Cache::TouchCacheEntry(*cacheEntry);
+			snapshots[i] = Cache::GetUsableSnapshot(*cacheEntry, SubmoduleSummaryComponents);
+		}
+
+		if (snapshots[i] == nullptr)
+			uncachedSubmodules.push_back(i);
+	}
+
+	// Workers take submodules from a shared queue so repositories with many submodules don't
+	// start a thread for each one.
+	std::atomic<size_t> nextSubmodule(0);
+	auto computeSubmodules = [this, &status, &snapshots, &uncachedSubmodules, &nextSubmodule]()
+	{
+		for (auto next = nextSubmodule++; next < uncachedSubmodules.size(); next = nextSubmodule++)
+		{
+			auto i = uncachedSubmodules[next];
+			const auto& submoduleRepositoryPath = status.Submodules[i].RepositoryPath;
+			try
+			{
+				snapshots[i] = GetSnapshot(submoduleRepositoryPath, SubmoduleSummaryComponents);
+			}
+			catch (const std::exception& exception)
+			{
+				Log("Cache.SummarizeSubmodules.FailedToComputeSubmodule", Severity::Error)
+					<< R"(Failed to compute status of submodule. { "repositoryPath": ")" << submoduleRepositoryPath
+					<< R"(", "exception": ")" << exception.what() << R"(" })";
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	{
+		auto joinWorkers = std::experimental::scope_guard([&workers]()
+		{
+			for (auto& worker : workers)
+				worker.join();
+		});
+
+		auto workerCount = (std::min)(uncachedSubmodules.size(), static_cast<size_t>(m_submoduleThreadCount));
+		for (auto i = size_t{ 1 }; i < workerCount; ++i)
+			workers.emplace_back(computeSubmodules);
+		computeSubmodules();
+	}
+
+	for (auto i = size_t{ 0 }; i < status.Submodules.size(); ++i)
+	{
+		const auto& snapshot = snapshots[i];
+		if (snapshot == nullptr || !snapshot->Succeeded)
+			continue;
+
+		auto& submodule = status.Submodules[i];
+		const auto& submoduleStatus = *snapshot->Status;
+		submodule.HasStatus = true;
+		submodule.Branch = submoduleStatus.Branch;
+		submodule.HeadSha1Id = submoduleStatus.HeadSha1Id;
+		submodule.HasNewCommits = !submodule.IndexSha1Id.empty() && submodule.HeadSha1Id != submodule.IndexSha1Id;
+		submodule.IndexChanges = CountIndexChanges(submoduleStatus.Files);
+		submodule.WorkingChanges = CountWorkingChanges(submoduleStatus.Files);
+		submodule.Conflicted = submoduleStatus.Files.GetCount(FileStatus::Conflicted);
+
+		// Modified nested submodules show up as modified paths in the submodule, like git status.
+		for (const auto& nestedSubmodule : submoduleStatus.Submodules)
+		{
+			if (IsSubmoduleModified(nestedSubmodule))
+				++submodule.WorkingChanges;
+		}
+	}
+
+	if (!workers.empty())
+	{
+		Log("Cache.SummarizeSubmodules", Severity::Verbose)
+			<< R"(Computed submodule status in parallel. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "submodules": )" << status.Submodules.size()
+			<< R"(, "computed": )" << workers.size() << R"( })";
+	}
+}
+
+/*static*/ bool Cache::AdvanceGeneration(CacheEntry& cacheEntry)
+{
+	auto snapshot = std::atomic_load(&cacheEntry.CurrentSnapshot);
+	auto wasValid = snapshot != nullptr && snapshot->Generation == cacheEntry.Generation;
+	if (wasValid)
+		cacheEntry.InvalidatedTime = Clock::now();
+	++cacheEntry.Generation;
+	return wasValid;
+}
+
+void Cache::InvalidateSubmoduleParents(const std::string& repositoryPath)
+{
+	std::vector<std::string> parentRepositoryPaths;
+	{
+		ReadLock readLock(m_submoduleParentsMutex);
+		auto parents = m_submoduleParents.find(repositoryPath);
+		if (parents == m_submoduleParents.end())
+			return;
+		parentRepositoryPaths.assign(parents->second.begin(), parents->second.end());
+	}
+
+	for (const auto& parentRepositoryPath : parentRepositoryPaths)
+	{
+		auto cacheEntry = FindCacheEntry(parentRepositoryPath);
+		if (cacheEntry != nullptr)
+		{
+			std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+			Cache::AdvanceGeneration(*cacheEntry);
+		}
+
+		Cache::InvalidateSubmoduleParents(parentRepositoryPath);
+	}
+}
+
+std::shared_ptr<const Cache::Snapshot> Cache::GetSnapshot(const std::string& repositoryPath, uint32_t components, bool joinComputation)
+{
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	auto snapshot = cacheEntry != nullptr ? Cache::GetUsableSnapshot(*cacheEntry, components) : nullptr;
+	if (snapshot != nullptr)
+	{
+		Cache::TouchCacheEntry(*cacheEntry);
+		++Cache::GetShard(repositoryPath).Hits;
+		Log("Cache.GetStatus.CacheHit", Severity::Info)
+			<< R"(Found git status in cache. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return snapshot;
+	}
+
+	++Cache::GetShard(repositoryPath).Misses;
+	Log("Cache.GetStatus.CacheMiss", Severity::Warning)
+		<< R"(Failed to find git status in cache. { "repositoryPath": ")" << repositoryPath << R"(" })";
+
+	return ComputeStatus(repositoryPath, components, joinComputation);
+}
+
+std::tuple<bool, std::shared_ptr<const Git::Status>> Cache::GetStatus(const std::string& repositoryPath, uint32_t components, bool joinComputation)
+{
+	auto snapshot = GetSnapshot(repositoryPath, components, joinComputation);
+	return std::make_tuple(snapshot->Succeeded, snapshot->Status);
+}
+
+std::shared_ptr<const Git::Status> Cache::GetStaleStatus(
+	const std::string& repositoryPath,
+	uint32_t components,
+	std::chrono::milliseconds maximumStaleness,
+	bool& isStale,
+	std::chrono::milliseconds& staleness)
+{
+	isStale = false;
+	staleness = std::chrono::milliseconds::zero();
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	if (cacheEntry == nullptr)
+		return nullptr;
+
+	Cache::TouchCacheEntry(*cacheEntry);
+	std::shared_ptr<const Snapshot> snapshot;
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		snapshot = std::atomic_load(&cacheEntry->CurrentSnapshot);
+		if (snapshot == nullptr || !snapshot->Succeeded || (snapshot->Status->Components & components) != components)
+			return nullptr;
+
+		if (snapshot->Generation == cacheEntry->Generation)
+			return snapshot->Status;
+
+		staleness = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - cacheEntry->InvalidatedTime);
+	}
+
+	if (staleness > maximumStaleness)
+		return nullptr;
+
+	isStale = true;
+
+	++m_cacheStaleHits;
+	Log("Cache.GetStaleStatus.StaleHit", Severity::Info)
+		<< R"(Found invalidated git status in cache. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "stalenessMs": )" << staleness.count() << R"( })";
+	return snapshot->Status;
+}
+
+std::tuple<bool, std::string> Cache::GetRenderedStatus(
+	const std::string& repositoryPath,
+	const std::string& key,
+	uint32_t components,
+	const std::function<std::string(const Git::Status&)>& render)
+{
+	auto snapshot = GetSnapshot(repositoryPath, components);
+	if (!snapshot->Succeeded)
+		return std::make_tuple(false, std::string());
+
+	auto renderedStatus = snapshot->RenderedStatuses.find(key);
+	if (renderedStatus != snapshot->RenderedStatuses.end())
+		return std::make_tuple(true, renderedStatus->second);
+
+	auto newRenderedStatus = render(*snapshot->Status);
+
+	// Publishes a copy of the snapshot with the rendered status added. Snapshot shares the
+	// status, so this only copies the other rendered forms.
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	if (cacheEntry != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		if (std::atomic_load(&cacheEntry->CurrentSnapshot) == snapshot)
+		{
+			auto newSnapshot = std::make_shared<Snapshot>(*snapshot);
+			if (newSnapshot->RenderedStatuses.size() >= MaximumRenderedStatuses)
+				newSnapshot->RenderedStatuses.clear();
+			newSnapshot->RenderedStatuses[key] = newRenderedStatus;
+			Cache::PublishSnapshot(*cacheEntry, repositoryPath, newSnapshot);
+		}
+	}
+
+	Cache::EvictCacheEntries(repositoryPath);
+	return std::make_tuple(true, std::move(newRenderedStatus));
+}
+
+void Cache::PrimeCacheEntry(const std::string& repositoryPath)
+{
+	++m_cacheTotalPrimeRequests;
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+
+	// Priming scheduled before the entry was evicted would add it back without monitoring,
+	// serving its status as current after the repository changed.
+	if (cacheEntry == nullptr)
+		return;
+
+	auto snapshot = Cache::GetUsableSnapshot(*cacheEntry, Git::AllComponents);
+	if (snapshot != nullptr && !snapshot->Restored)
+		return;
+
+	// A request computing the current status with every component already primes the entry.
+	// Progressive requests compute without the deferred components, which priming adds.
+	std::shared_ptr<const Computation> computation;
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		computation = Cache::FindJoinableComputation(*cacheEntry, cacheEntry->Generation, Git::AllComponents);
+	}
+
+	if (computation != nullptr)
+	{
+		++m_cacheCoalescedComputations;
+		computation->Result.wait();
+		return;
+	}
+
+	++m_cacheEffectivePrimeRequests;
+	Log("Cache.PrimeCacheEntry", Severity::Info)
+		<< R"(Priming cache entry. { "repositoryPath": ")" << repositoryPath << R"(" })";
+
+	ComputeStatus(repositoryPath, Git::AllComponents);
+}
+
+bool Cache::InvalidateCacheEntry(const std::string& repositoryPath)
+{
+	++Cache::GetShard(repositoryPath).TotalInvalidationRequests;
+	bool invalidatedCacheEntry = false;
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	if (cacheEntry != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		invalidatedCacheEntry = Cache::AdvanceGeneration(*cacheEntry);
+		cacheEntry->RequiresFullRecompute = true;
+		cacheEntry->DirtyPaths.clear();
+	}
+
+	// Parent may have summarized the submodule from a status that was never published, so
+	// parents are invalidated even if the entry already was.
+	Cache::InvalidateSubmoduleParents(repositoryPath);
+
+	if (invalidatedCacheEntry)
+		++Cache::GetShard(repositoryPath).EffectiveInvalidationRequests;
+	return invalidatedCacheEntry;
+}
+
+bool Cache::InvalidateCacheEntry(const std::string& repositoryPath, const std::string& dirtyPath)
+{
+	++Cache::GetShard(repositoryPath).TotalInvalidationRequests;
+	bool invalidatedCacheEntry = false;
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	if (cacheEntry != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		invalidatedCacheEntry = Cache::AdvanceGeneration(*cacheEntry);
+		if (!cacheEntry->RequiresFullRecompute)
+		{
+			cacheEntry->DirtyPaths.insert(dirtyPath);
+			if (cacheEntry->DirtyPaths.size() > MaximumDirtyPaths)
+			{
+				cacheEntry->RequiresFullRecompute = true;
+				cacheEntry->DirtyPaths.clear();
+			}
+		}
+	}
+
+	Cache::InvalidateSubmoduleParents(repositoryPath);
+
+	if (invalidatedCacheEntry)
+		++Cache::GetShard(repositoryPath).EffectiveInvalidationRequests;
+	return invalidatedCacheEntry;
+}
+
+std::tuple<bool, std::string> Cache::DiscoverRepository(const std::string& path)
+{
+	return m_git.DiscoverRepository(path);
+}
+
+void Cache::ReloadRepository(const std::string& repositoryPath)
+{
+	m_git.ReloadRepository(repositoryPath);
+}
+
+void Cache::InvalidateAllCacheEntries()
+{
+	++m_cacheInvalidateAllRequests;
+	for (auto& shard : m_shards)
+	{
+		std::unordered_map<std::string, std::shared_ptr<CacheEntry>> cache;
+		{
+			WriteLock writeLock(shard.Mutex);
+			shard.Entries.swap(cache);
+		}
+		for (auto& cacheEntry : cache)
+		{
+			std::lock_guard<std::mutex> lock(cacheEntry.second->Mutex);
+			cacheEntry.second->Evicted = true;
+			m_cacheBytes -= cacheEntry.second->SizeInBytes;
+			cacheEntry.second->SizeInBytes = 0;
+		}
+	}
+	{
+		WriteLock writeLock(m_submoduleParentsMutex);
+		m_submoduleParents.clear();
+	}
+
+	Log("Cache.InvalidateAllCacheEntries.", Severity::Warning)
+		<< R"(Invalidated all git status information in cache.)";
+}
+
+std::shared_ptr<const Git::Status> Cache::GetCachedStatus(const std::string& repositoryPath)
+{
+	auto cacheEntry = FindCacheEntry(repositoryPath);
+	if (cacheEntry == nullptr)
+		return nullptr;
+
+	auto snapshot = std::atomic_load(&cacheEntry->CurrentSnapshot);
+	if (snapshot == nullptr || !snapshot->Succeeded)
+		return nullptr;
+
+	return snapshot->Status;
+}
+
+std::vector<std::string> Cache::RevalidateCacheEntries(const HasChangedSinceCallback& hasChangedSince)
+{
+	++m_cacheRevalidations;
+
+	std::vector<std::tuple<uint64_t, std::string, std::shared_ptr<const Snapshot>>> candidates;
+	for (auto& shard : m_shards)
+	{
+		ReadLock readLock(shard.Mutex);
+		for (const auto& cacheEntry : shard.Entries)
+		{
+			auto snapshot = Cache::GetUsableSnapshot(*cacheEntry.second, 0);
+			if (snapshot != nullptr && snapshot->Succeeded)
+				candidates.emplace_back(cacheEntry.second->LastAccess.load(), cacheEntry.first, snapshot);
+		}
+	}
+
+	std::sort(
+		candidates.begin(),
+		candidates.end(),
+		[](const auto& left, const auto& right) { return std::get<0>(left) > std::get<0>(right); });
+
+	std::vector<std::string> invalidatedRepositoryPaths;
+	for (const auto& candidate : candidates)
+	{
+		const auto& repositoryPath = std::get<1>(candidate);
+		const auto& snapshot = std::get<2>(candidate);
+		if (!hasChangedSince(*snapshot->Status, snapshot->ComputeStartTime))
+			continue;
+
+		// Lost notifications may have included changes to the index or config.
+		Cache::ReloadRepository(repositoryPath);
+		if (Cache::InvalidateCacheEntry(repositoryPath))
+		{
+			++m_cacheRevalidatedChanges;
+			invalidatedRepositoryPaths.push_back(repositoryPath);
+		}
+	}
+
+	Log("Cache.RevalidateCacheEntries", Severity::Warning)
+		<< R"(Revalidated git status information in cache. { "revalidatedEntries": )" << candidates.size()
+		<< R"(, "invalidatedEntries": )" << invalidatedRepositoryPaths.size() << R"( })";
+
+	return invalidatedRepositoryPaths;
+}
+
+std::vector<Cache::CurrentStatus> Cache::GetCurrentStatuses()
+{
+	std::vector<CurrentStatus> statuses;
+	for (auto& shard : m_shards)
+	{
+		ReadLock readLock(shard.Mutex);
+		for (const auto& cacheEntry : shard.Entries)
+		{
+			auto snapshot = Cache::GetUsableSnapshot(*cacheEntry.second, Git::FileStatusComponent);
+			if (snapshot != nullptr && snapshot->Succeeded)
+				statuses.push_back(CurrentStatus{ snapshot->Status, snapshot->ComputeStartTime });
+		}
+	}
+	return statuses;
+}
+
+bool Cache::IsCurrentStatus(const std::shared_ptr<const Git::Status>& status)
+{
+	auto cacheEntry = FindCacheEntry(status->RepositoryPath);
+	if (cacheEntry == nullptr)
+		return false;
+
+	auto snapshot = Cache::GetUsableSnapshot(*cacheEntry, 0 /*components*/);
+	return snapshot != nullptr && snapshot->Status == status;
+}
+
+bool Cache::RestoreCacheEntry(const Git::Status& status, uint64_t computeStartTime)
+{
+	auto cacheEntry = GetOrAddCacheEntry(status.RepositoryPath);
+	{
+		std::lock_guard<std::mutex> lock(cacheEntry->Mutex);
+		if (std::atomic_load(&cacheEntry->CurrentSnapshot) != nullptr || cacheEntry->InProgress != nullptr)
+			return false;
+
+		auto snapshot = std::make_shared<Snapshot>();
+		snapshot->Succeeded = true;
+		snapshot->Restored = true;
+		snapshot->Status = std::make_shared<const Git::Status>(status);
+		snapshot->Generation = cacheEntry->Generation;
+		snapshot->ComputeStartTime = computeStartTime;
+		Cache::PublishSnapshot(*cacheEntry, status.RepositoryPath, snapshot);
+		cacheEntry->RequiresFullRecompute = false;
+		cacheEntry->DirtyPaths.clear();
+	}
+
+	++m_cacheRestoredEntries;
+	Log("Cache.RestoreCacheEntry", Severity::Info)
+		<< R"(Restored persisted git status. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+
+	Cache::EvictCacheEntries(status.RepositoryPath);
+	return true;
+}
+
+void Cache::AddCacheEntry(const std::string& repositoryPath)
+{
+	GetOrAddCacheEntry(repositoryPath);
+}
+
+void Cache::SetOnEvictedCallback(const OnEvictedCallback& onEvictedCallback)
+{
+	WriteLock writeLock(m_onEvictedCallbackMutex);
+	m_onEvictedCallback = onEvictedCallback;
+}
+
+CacheStatistics Cache::GetCacheStatistics()
+{
+	CacheStatistics statistics;
+	for (auto& shard : m_shards)
+	{
+		statistics.CacheHits += shard.Hits;
+		statistics.CacheMisses += shard.Misses;
+		statistics.CacheEffectiveInvalidationRequests += shard.EffectiveInvalidationRequests;
+		statistics.CacheTotalInvalidationRequests += shard.TotalInvalidationRequests;
+
+		ReadLock readLock(shard.Mutex);
+		statistics.CacheEntries += shard.Entries.size();
+	}
+	statistics.CacheEffectivePrimeRequests = m_cacheEffectivePrimeRequests;
+	statistics.CacheTotalPrimeRequests = m_cacheTotalPrimeRequests;
+	statistics.CacheInvalidateAllRequests = m_cacheInvalidateAllRequests;
+	statistics.CacheIncrementalRecomputes = m_cacheIncrementalRecomputes;
+	statistics.CacheCoalescedComputations = m_cacheCoalescedComputations;
+	statistics.CacheStaleHits = m_cacheStaleHits;
+	statistics.CacheEvictions = m_cacheEvictions;
+	statistics.CacheBytes = m_cacheBytes;
+	statistics.CacheRestoredEntries = m_cacheRestoredEntries;
+	statistics.CacheRevalidations = m_cacheRevalidations;
+	statistics.CacheRevalidatedChanges = m_cacheRevalidatedChanges;
+	return statistics;
+}
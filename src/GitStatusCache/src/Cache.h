@@ -1,55 +1,376 @@
-#pragma once
-#include "Git.h"
-#include "CacheStatistics.h"
-
-/**
-* Simple cache that retrieves and stores git status information.
-* This class is thread-safe.
-*/
-class Cache : boost::noncopyable
-{
-private:
-	using ReadLock = boost::shared_lock<boost::shared_mutex>;
-	using WriteLock = boost::unique_lock<boost::shared_mutex>;
-	using UpgradableLock = boost::upgrade_lock<boost::shared_mutex>;
-	using UpgradedLock = boost::upgrade_to_unique_lock<boost::shared_mutex>;
-
-	Git m_git;
-	std::unordered_map<std::string, std::tuple<bool, Git::Status>> m_cache;
-	boost::shared_mutex m_cacheMutex;
-
-	std::atomic<uint64_t> m_cacheHits = 0;
-	std::atomic<uint64_t> m_cacheMisses = 0;
-	std::atomic<uint64_t> m_cacheEffectivePrimeRequests = 0;
-	std::atomic<uint64_t> m_cacheTotalPrimeRequests = 0;
-	std::atomic<uint64_t> m_cacheEffectiveInvalidationRequests = 0;
-	std::atomic<uint64_t> m_cacheTotalInvalidationRequests = 0;
-	std::atomic<uint64_t> m_cacheInvalidateAllRequests = 0;
-
-public:
-	/**
-	* Retrieves current git status for repository at provided path.
-	* Returns from cache if present, otherwise queries git and adds to cache.
-	*/
-	std::tuple<bool, Git::Status> GetStatus(const std::string& repositoryPath);
-
-	/**
-	* Computes status and loads cache entry if it's not already present.
-	*/
-	void PrimeCacheEntry(const std::string& repositoryPath);
-
-	/**
-	* Invalidates cached git status for repository at provided path.
-	*/
-	bool InvalidateCacheEntry(const std::string& repositoryPath);
-
-	/**
-	* Invalidates all cached git status information.
-	*/
-	void InvalidateAllCacheEntries();
-
-	/**
-	 * Returns information about cache's performance.
-	 */
-	CacheStatistics GetCacheStatistics();
+#pragma once
+#include "Git.h"
+#include "CacheStatistics.h"
+#include <chrono>
+#include <future>
+
+/**
+* Simple cache that retrieves and stores git status information.
+* This class is thread-safe.
+*/
+class Cache : boost::noncopyable
+{
+public:
+	/**
+	* Callback for evicted repositories. Provides repository path.
+	*/
+	using OnEvictedCallback = std::function<void(const std::string&)>;
+
+	/**
+	* Callback that checks if a repository changed since the provided time. Provides cached
+	* status and the time its computation started as a FILETIME.
+	*/
+	using HasChangedSinceCallback = std::function<bool(const Git::Status&, uint64_t)>;
+
+	/**
+	* Current status of a cached repository and when its computation started as a FILETIME.
+	*/
+	struct CurrentStatus
+	{
+		std::shared_ptr<const Git::Status> Status;
+		uint64_t ComputeStartTime;
+	};
+
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	* Immutable status published to readers. Rendered forms of the status are replaced along
+	* with the snapshot. ComputeStartTime is when the oldest computation the status includes
+	* started, as a FILETIME. Changes made before it are reflected in the status. Restored
+	* snapshots were read from a previous run and are served until they're verified by a full
+	* recompute.
+	*/
+	struct Snapshot
+	{
+		bool Succeeded = false;
+		bool Restored = false;
+		std::shared_ptr<const Git::Status> Status;
+		uint64_t Generation = 0;
+		uint64_t ComputeStartTime = 0;
+		std::unordered_map<std::string, std::string> RenderedStatuses;
+	};
+
+	/**
+	* Status computation in progress for an entry. Result is the snapshot it computes.
+	*/
+	struct Computation
+	{
+		uint64_t Generation;
+		uint32_t Components;
+		std::shared_future<std::shared_ptr<const Snapshot>> Result;
+	};
+
+	/**
+	* Most recently computed status for a repository and the changes observed since.
+	* CurrentSnapshot is loaded and published atomically so readers never wait on writers. It
+	* is valid while its generation matches Generation. Mutex serializes writers and guards
+	* the remaining fields. InProgress is the latest computation started for the entry, which
+	* concurrent misses wait on instead of computing the same status again. InvalidatedTime
+	* is when the current snapshot was first invalidated. SizeInBytes is the entry's share of
+	* the cache's bytes, which evicted entries no longer count toward. LastAccess orders
+	* entries for eviction.
+	*/
+	struct CacheEntry
+	{
+		std::shared_ptr<const Snapshot> CurrentSnapshot;
+		std::atomic<uint64_t> Generation = 0;
+		std::mutex Mutex;
+		bool RequiresFullRecompute = true;
+		std::unordered_set<std::string> DirtyPaths;
+		std::shared_ptr<const Computation> InProgress;
+		Clock::time_point InvalidatedTime;
+		uint64_t SizeInBytes = 0;
+		bool Evicted = false;
+		bool Pinned = false;
+		std::atomic<uint64_t> LastAccess = 0;
+	};
+
+	/**
+	* Entries for repositories whose paths hash to the shard. Each repository's lookups and
+	* counters only touch its own shard, so requests for different repositories don't contend
+	* on a single lock or counter. Shards are aligned to cache lines so neighboring shards'
+	* locks and counters never share one.
+	*/
+	struct alignas(64) CacheShard
+	{
+		std::unordered_map<std::string, std::shared_ptr<CacheEntry>> Entries;
+		boost::shared_mutex Mutex;
+
+		std::atomic<uint64_t> Hits = 0;
+		std::atomic<uint64_t> Misses = 0;
+		std::atomic<uint64_t> EffectiveInvalidationRequests = 0;
+		std::atomic<uint64_t> TotalInvalidationRequests = 0;
+	};
+
+	/**
+	* Number of shards entries are spread across.
+	*/
+	static const size_t ShardCount = 64;
+
+	/**
+	* Number of dirty paths after which a full recompute is cheaper than an incremental one.
+	*/
+	static const size_t MaximumDirtyPaths = 1000;
+
+	/**
+	* Number of rendered forms of a status retained before they're discarded.
+	*/
+	static const size_t MaximumRenderedStatuses = 16;
+
+	/**
+	* Components retrieved for a submodule to summarize it in its parent's status.
+	*/
+	static const uint32_t SubmoduleSummaryComponents = Git::FileStatusComponent | Git::SubmoduleComponent;
+
+	Git m_git;
+	const uint32_t m_submoduleThreadCount;
+	CacheShard m_shards[ShardCount];
+
+	const uint64_t m_maximumCacheBytes;
+	std::vector<std::string> m_pinnedRepositories;
+	std::atomic<uint64_t> m_cacheBytes = 0;
+	std::mutex m_evictionMutex;
+	OnEvictedCallback m_onEvictedCallback;
+	boost::shared_mutex m_onEvictedCallbackMutex;
+
+	std::unordered_map<std::string, std::unordered_set<std::string>> m_submoduleParents;
+	boost::shared_mutex m_submoduleParentsMutex;
+
+	std::atomic<uint64_t> m_cacheEffectivePrimeRequests = 0;
+	std::atomic<uint64_t> m_cacheTotalPrimeRequests = 0;
+	std::atomic<uint64_t> m_cacheInvalidateAllRequests = 0;
+	std::atomic<uint64_t> m_cacheIncrementalRecomputes = 0;
+	std::atomic<uint64_t> m_cacheCoalescedComputations = 0;
+	std::atomic<uint64_t> m_cacheStaleHits = 0;
+	std::atomic<uint64_t> m_cacheEvictions = 0;
+	std::atomic<uint64_t> m_cacheRestoredEntries = 0;
+	std::atomic<uint64_t> m_cacheRevalidations = 0;
+	std::atomic<uint64_t> m_cacheRevalidatedChanges = 0;
+
+	/**
+	* Retrieves shard holding entry for repository at provided path.
+	*/
+	CacheShard& GetShard(const std::string& repositoryPath);
+
+	/**
+	* Retrieves entry for repository at provided path. Returns nullptr if it doesn't exist.
+	*/
+	std::shared_ptr<CacheEntry> FindCacheEntry(const std::string& repositoryPath);
+
+	/**
+	* Retrieves entry for repository at provided path, adding it if it doesn't exist.
+	*/
+	std::shared_ptr<CacheEntry> GetOrAddCacheEntry(const std::string& repositoryPath);
+
+	/**
+	* Records that entry was used so it's evicted after entries used less recently.
+	*/
+	static void TouchCacheEntry(CacheEntry& cacheEntry);
+
+	/**
+	* Checks if repository at provided path was pinned in settings.
+	*/
+	bool IsPinned(const std::string& repositoryPath) const;
+
+	/**
+	* Estimates bytes retained by snapshot, including its status and rendered forms.
+	*/
+	static uint64_t GetSizeInBytes(const Snapshot& snapshot);
+
+	/**
+	* Publishes snapshot to readers and updates the cache's bytes. Entry's mutex must be held.
+	*/
+	void PublishSnapshot(CacheEntry& cacheEntry, const std::string& repositoryPath, const std::shared_ptr<const Snapshot>& snapshot);
+
+	/**
+	* Evicts least recently used entries until the cache fits in its memory budget. Pinned
+	* entries, submodules of cached repositories, and the entry for the provided path are
+	* never evicted.
+	*/
+	void EvictCacheEntries(const std::string& retainedRepositoryPath);
+
+	/**
+	* Removes entry for repository at provided path and releases resources held for it.
+	*/
+	bool EvictCacheEntry(const std::string& repositoryPath);
+
+	/**
+	* Retrieves computation in progress for the entry that started at the provided generation
+	* and includes the provided components. Returns nullptr if there isn't one. Entry's mutex
+	* must be held.
+	*/
+	static std::shared_ptr<const Computation> FindJoinableComputation(const CacheEntry& cacheEntry, uint64_t generation, uint32_t components);
+
+	/**
+	* Computes status for an invalidated, missing, or incomplete entry and publishes it. Only
+	* requested components that aren't already cached are computed. File status is recomputed
+	* incrementally if possible. Waits on a computation already in progress for the same
+	* changes instead of starting another unless joinComputation is false.
+	*/
+	std::shared_ptr<const Snapshot> ComputeStatus(const std::string& repositoryPath, uint32_t components, bool joinComputation = true);
+
+	/**
+	* Fills in summaries of submodules in status from the submodules' own cache entries.
+	* Submodules without a usable entry are computed in parallel on at most as many threads
+	* as parallel status uses.
+	*/
+	void SummarizeSubmodules(const std::string& repositoryPath, Git::Status& status);
+
+	/**
+	* Advances entry's generation. Records when the snapshot was invalidated if it was valid
+	* until now. Returns true if it was valid. Entry's mutex must be held.
+	*/
+	static bool AdvanceGeneration(CacheEntry& cacheEntry);
+
+	/**
+	* Invalidates entries of repositories that contain repository at provided path as a
+	* submodule. Parents keep their own status and only re-summarize their submodules.
+	*/
+	void InvalidateSubmoduleParents(const std::string& repositoryPath);
+
+	/**
+	* Retrieves snapshot for repository at provided path that includes the provided components.
+	* Returns from cache if present, otherwise computes and publishes it.
+	*/
+	std::shared_ptr<const Snapshot> GetSnapshot(const std::string& repositoryPath, uint32_t components, bool joinComputation = true);
+
+	/**
+	* Retrieves entry's snapshot if it is valid and can service a request for the provided
+	* components. Returns nullptr otherwise.
+	*/
+	static std::shared_ptr<const Snapshot> GetUsableSnapshot(const CacheEntry& cacheEntry, uint32_t components);
+
+public:
+	Cache(const GitSettings& gitSettings);
+
+	/**
+	* Allocates caches aligned for their shards, which the default operator new doesn't
+	* guarantee for over-aligned types before C++17.
+	*/
+	static void* operator new(size_t size);
+	static void operator delete(void* cache);
+
+	/**
+	* Retrieves current git status for repository at provided path.
+	* Returns from cache if present, otherwise queries git and adds to cache.
+	* Components that weren't requested may be missing from the returned status.
+	* Returned status is shared with the cache and never modified. Concurrent misses wait on
+	* a single computation unless joinComputation is false, which callers that can't wait on
+	* a slower computation of more components use.
+	*/
+	std::tuple<bool, std::shared_ptr<const Git::Status>> GetStatus(
+		const std::string& repositoryPath,
+		uint32_t components = Git::AllComponents,
+		bool joinComputation = true);
+
+	/**
+	* Retrieves cached status for repository at provided path even if it was invalidated, as
+	* long as it includes the provided components and was invalidated no longer than
+	* maximumStaleness ago. Sets isStale if it was invalidated and staleness to how long ago
+	* that was. Never computes status. Returns nullptr if no such status is cached.
+	*/
+	std::shared_ptr<const Git::Status> GetStaleStatus(
+		const std::string& repositoryPath,
+		uint32_t components,
+		std::chrono::milliseconds maximumStaleness,
+		bool& isStale,
+		std::chrono::milliseconds& staleness);
+
+	/**
+	* Retrieves status last computed for repository at provided path, even if it was
+	* invalidated since. Never computes status. Returns nullptr if no status is cached.
+	*/
+	std::shared_ptr<const Git::Status> GetCachedStatus(const std::string& repositoryPath);
+
+	/**
+	* Retrieves status for repository at provided path rendered by the provided function.
+	* Rendered result is memoized by key until the cache entry is invalidated.
+	*/
+	std::tuple<bool, std::string> GetRenderedStatus(
+		const std::string& repositoryPath,
+		const std::string& key,
+		uint32_t components,
+		const std::function<std::string(const Git::Status&)>& render);
+
+	/**
+	* Computes status for repository's cache entry if it isn't current. Repositories without
+	* a cache entry aren't primed, since evicted repositories are no longer monitored.
+	*/
+	void PrimeCacheEntry(const std::string& repositoryPath);
+
+	/**
+	* Invalidates cached git status for repository at provided path.
+	* Next status for the repository will be fully recomputed.
+	*/
+	bool InvalidateCacheEntry(const std::string& repositoryPath);
+
+	/**
+	* Invalidates cached git status for repository at provided path due to a change to
+	* the provided path (relative to the working directory). Next status for the repository
+	* only recomputes file status for dirty paths.
+	*/
+	bool InvalidateCacheEntry(const std::string& repositoryPath, const std::string& dirtyPath);
+
+	/**
+	* Searches for repository containing provided path.
+	*/
+	std::tuple<bool, std::string> DiscoverRepository(const std::string& path);
+
+	/**
+	* Discards open handles for repository at provided path so config and index are reloaded.
+	*/
+	void ReloadRepository(const std::string& repositoryPath);
+
+	/**
+	* Invalidates all cached git status information.
+	*/
+	void InvalidateAllCacheEntries();
+
+	/**
+	* Checks every valid entry for changes that may have been missed, most recently used
+	* first, and invalidates entries whose repository changed. Used when file change
+	* notifications were lost instead of invalidating every entry. Returns paths of
+	* invalidated repositories, most recently used first.
+	*/
+	std::vector<std::string> RevalidateCacheEntries(const HasChangedSinceCallback& hasChangedSince);
+
+	/**
+	* Retrieves current statuses of cached repositories that include file status.
+	*/
+	std::vector<CurrentStatus> GetCurrentStatuses();
+
+	/**
+	* Checks if status is still the current status of its repository, meaning no change has
+	* been reported since it was retrieved.
+	*/
+	bool IsCurrentStatus(const std::shared_ptr<const Git::Status>& status);
+
+	/**
+	* Adds status restored from a previous run for repository that isn't cached yet. Status
+	* is served as current until the repository changes or it's verified, which priming the
+	* entry does by fully recomputing it. computeStartTime is when the status's computation
+	* started in the previous run as a FILETIME, so revalidation still catches changes made
+	* since. Returns false if the repository is already cached.
+	*/
+	bool RestoreCacheEntry(const Git::Status& status, uint64_t computeStartTime);
+
+	/**
+	* Adds an empty cache entry for repository if it isn't cached yet, so it's primed like a
+	* cached repository until it's evicted.
+	*/
+	void AddCacheEntry(const std::string& repositoryPath);
+
+	/**
+	* Registers callback invoked after a repository is evicted, which releases resources
+	* held elsewhere for the repository. Pass nullptr to unregister.
+	*/
+	void SetOnEvictedCallback(const OnEvictedCallback& onEvictedCallback);
+
+	/**
+	 * Returns information about cache's performance.
+	 */
+	CacheStatistics GetCacheStatistics();
 };
\ No newline at end of file
@@ -1,80 +1,533 @@
-#include "stdafx.h"
-#include "CacheInvalidator.h"
-#include "StringConverters.h"
-
-CacheInvalidator::CacheInvalidator(const std::shared_ptr<Cache>& cache)
-	: m_cache(cache)
-	, m_cachePrimer(m_cache)
-{
-	m_directoryMonitor = std::make_unique<DirectoryMonitor>(
-		[this](DirectoryMonitor::Token token, const boost::filesystem::path& path, DirectoryMonitor::FileAction action)
-		{
-			this->OnFileChanged(token, path, action);
-		},
-		[this] { m_cache->InvalidateAllCacheEntries(); });
-}
-
-void CacheInvalidator::MonitorRepositoryDirectories(const Git::Status& status)
-{
-	auto workingDirectory = status.WorkingDirectory;
-	if (!workingDirectory.empty())
-	{
-		auto token = m_directoryMonitor->AddDirectory(ConvertToUnicode(workingDirectory));
-		WriteLock writeLock(m_tokensToRepositoriesMutex);
-		m_tokensToRepositories[token] = status.RepositoryPath;
-	}
-
-	auto repositoryPath = status.RepositoryPath;
-	if (!repositoryPath.empty())
-	{
-		if (workingDirectory.empty() || repositoryPath.find(workingDirectory) != 0)
-		{
-			auto token = m_directoryMonitor->AddDirectory(ConvertToUnicode(repositoryPath));
-			WriteLock writeLock(m_tokensToRepositoriesMutex);
-			m_tokensToRepositories[token] = status.RepositoryPath;
-		}
-	}
-}
-
-void CacheInvalidator::OnFileChanged(DirectoryMonitor::Token token, const boost::filesystem::path& path, DirectoryMonitor::FileAction action)
-{
-	if (CacheInvalidator::ShouldIgnoreFileChange(path))
-	{
-		Log("CacheInvalidator.OnFileChanged.IgnoringFileChange", Severity::Spam)
-			<< R"(Ignoring file change. { "filePath": ")" << path.c_str() << R"(" })";
-		return;
-	}
-
-	std::string repositoryPath;
-	{
-		ReadLock readLock(m_tokensToRepositoriesMutex);
-		auto iterator = m_tokensToRepositories.find(token);
-		if (iterator == m_tokensToRepositories.end())
-		{
-			Log("CacheInvalidator.OnFileChanged.FailedToFindToken", Severity::Error)
-				<< R"(Failed to find token to repository mapping. { "token": )" << token << R"(" })";
-			throw std::logic_error("Failed to find token to repository mapping.");
-		}
-		repositoryPath = iterator->second;
-	}
-
-	auto invalidatedEntry = m_cache->InvalidateCacheEntry(repositoryPath);
-	if (invalidatedEntry)
-	{
-		Log("CacheInvalidator.OnFileChanged.InvalidatedCacheEntry", Severity::Info)
-			<< R"(Invalidated git status in cache for file change. { "token": )" << token
-			<< R"(, "repositoryPath": ")" << repositoryPath
-			<< R"(", "filePath": ")" << path.c_str() << R"(" })";
-	}
-
-	m_cachePrimer.SchedulePrimingForRepositoryPathInFiveSeconds(repositoryPath);
-}
-
-/*static*/ bool CacheInvalidator::ShouldIgnoreFileChange(const boost::filesystem::path& path)
-{
-	if (!path.has_filename())
-		return false;
-
-	auto filename = path.filename();
-	return filename.wstring() == L"index.lock" || filename.wstring() == L".git";
-}
\ No newline at end of file
+#include "stdafx.h"
+#include "CacheInvalidator.h"
+#include "StringConverters.h"
+
+uint64_t ConvertFileTimeToUint64(const FILETIME& fileTime)
+{
+	return (static_cast<uint64_t>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+}
+
+CacheInvalidator::CacheInvalidator(const std::shared_ptr<Cache>& cache, const std::shared_ptr<RepositoryDiscoveryCache>& discoveryCache)
+	: m_cache(cache)
+	, m_discoveryCache(discoveryCache)
+	, m_cachePrimer(m_cache)
+{
+	m_directoryMonitor = std::make_unique<DirectoryMonitor>(
+		[this](DirectoryMonitor::Token token, const boost::filesystem::path& path, DirectoryMonitor::FileAction action)
+		{
+			this->OnFileChanged(token, path, action);
+		},
+		[this]
+		{
+			this->OnEventsLost();
+		});
+
+	m_cache->SetOnEvictedCallback([this](const std::string& repositoryPath)
+	{
+		this->StopMonitoringRepository(repositoryPath);
+	});
+}
+
+CacheInvalidator::~CacheInvalidator()
+{
+	m_cache->SetOnEvictedCallback(nullptr);
+}
+
+void CacheInvalidator::MonitorRepositoryDirectories(const Git::Status& status)
+{
+	auto repository = MonitoredRepository{ status.RepositoryPath, status.WorkingDirectory, status.CommonDirectory };
+	repository.HasSubmoduleDirectories = (status.Components & Git::SubmoduleComponent) != 0;
+	for (const auto& submodule : status.Submodules)
+	{
+		if (submodule.RepositoryPath.empty())
+			continue;
+
+		repository.SubmoduleDirectories.push_back(submodule.WorkingDirectory);
+		repository.SubmoduleDirectories.push_back(submodule.RepositoryPath);
+
+		// Submodules of a submodule are only known from the submodule's own status, which
+		// is cached once it's summarized in its parent.
+		auto submoduleStatus = m_cache->GetCachedStatus(submodule.RepositoryPath);
+		if (submoduleStatus != nullptr)
+		{
+			CacheInvalidator::MonitorRepositoryDirectories(*submoduleStatus);
+		}
+		else
+		{
+			CacheInvalidator::MonitorRepositoryDirectories(
+				MonitoredRepository{ submodule.RepositoryPath, submodule.WorkingDirectory, submodule.RepositoryPath });
+		}
+	}
+
+	CacheInvalidator::MonitorRepositoryDirectories(repository);
+}
+
+void CacheInvalidator::MonitorRepositoryDirectories(const MonitoredRepository& repository)
+{
+	auto workingDirectory = repository.WorkingDirectory;
+	const auto& commonDirectory = repository.CommonDirectory;
+	if (!workingDirectory.empty())
+	{
+		auto token = m_directoryMonitor->AddDirectory(ConvertToUnicode(workingDirectory));
+		{
+			WriteLock writeLock(m_tokensToRepositoriesMutex);
+			CacheInvalidator::RegisterMonitoredRepository(token, repository);
+		}
+		if (!commonDirectory.empty() && commonDirectory.find(workingDirectory) == 0)
+			CacheInvalidator::MonitorCommonDirectory(token, repository);
+	}
+
+	// Linked worktrees keep their repository directory under the common directory, so watching
+	// the common directory covers them without a watch per worktree.
+	if (!commonDirectory.empty())
+	{
+		if (workingDirectory.empty() || commonDirectory.find(workingDirectory) != 0)
+		{
+			auto token = m_directoryMonitor->AddDirectory(ConvertToUnicode(commonDirectory));
+			{
+				WriteLock writeLock(m_tokensToRepositoriesMutex);
+				if (repository.RepositoryPath == commonDirectory)
+					CacheInvalidator::RegisterMonitoredRepository(token, repository);
+				else
+					m_tokensToRepositories.emplace(token, MonitoredRepository{ commonDirectory, std::string(), commonDirectory });
+			}
+			CacheInvalidator::MonitorCommonDirectory(token, repository);
+		}
+	}
+}
+
+void CacheInvalidator::RegisterMonitoredRepository(DirectoryMonitor::Token token, const MonitoredRepository& repository)
+{
+	auto& monitoredRepository = m_tokensToRepositories[token];
+	if (repository.HasSubmoduleDirectories || monitoredRepository.RepositoryPath != repository.RepositoryPath)
+	{
+		monitoredRepository = repository;
+		return;
+	}
+
+	auto submoduleDirectories = std::move(monitoredRepository.SubmoduleDirectories);
+	auto hasSubmoduleDirectories = monitoredRepository.HasSubmoduleDirectories;
+	monitoredRepository = repository;
+	monitoredRepository.SubmoduleDirectories = std::move(submoduleDirectories);
+	monitoredRepository.HasSubmoduleDirectories = hasSubmoduleDirectories;
+}
+
+void CacheInvalidator::MonitorCommonDirectory(DirectoryMonitor::Token token, const MonitoredRepository& repository)
+{
+	WriteLock writeLock(m_tokensToRepositoriesMutex);
+	auto commonDirectory = m_commonDirectories.emplace(repository.CommonDirectory, MonitoredCommonDirectory{ token });
+	commonDirectory.first->second.RepositoryPaths.insert(repository.RepositoryPath);
+}
+
+void CacheInvalidator::StopMonitoringRepository(const std::string& repositoryPath)
+{
+	std::vector<DirectoryMonitor::Token> tokens;
+	std::vector<std::string> workingDirectories;
+	{
+		WriteLock writeLock(m_tokensToRepositoriesMutex);
+		std::unordered_map<DirectoryMonitor::Token, MonitoredRepository> retainedTokens;
+		std::unordered_set<std::string> releasedCommonDirectories;
+		for (auto commonDirectory = m_commonDirectories.begin(); commonDirectory != m_commonDirectories.end();)
+		{
+			auto& repositoryPaths = commonDirectory->second.RepositoryPaths;
+			repositoryPaths.erase(repositoryPath);
+			if (!repositoryPaths.empty())
+			{
+				// Only the common directory matters to the worktrees still sharing the watch.
+				retainedTokens.emplace(
+					commonDirectory->second.Token,
+					MonitoredRepository{ *repositoryPaths.begin(), std::string(), commonDirectory->first });
+				++commonDirectory;
+				continue;
+			}
+
+			releasedCommonDirectories.insert(commonDirectory->first);
+			commonDirectory = m_commonDirectories.erase(commonDirectory);
+		}
+
+		// Common directories watched on their own are registered under the common directory.
+		for (auto monitoredRepository = m_tokensToRepositories.begin(); monitoredRepository != m_tokensToRepositories.end();)
+		{
+			const auto& monitoredRepositoryPath = monitoredRepository->second.RepositoryPath;
+			if (monitoredRepositoryPath != repositoryPath && releasedCommonDirectories.count(monitoredRepositoryPath) == 0)
+			{
+				++monitoredRepository;
+				continue;
+			}
+
+			if (monitoredRepositoryPath == repositoryPath && !monitoredRepository->second.WorkingDirectory.empty())
+				workingDirectories.push_back(monitoredRepository->second.WorkingDirectory);
+
+			auto retainedToken = retainedTokens.find(monitoredRepository->first);
+			if (retainedToken != retainedTokens.end())
+			{
+				if (monitoredRepositoryPath == repositoryPath)
+					monitoredRepository->second = retainedToken->second;
+				++monitoredRepository;
+			}
+			else
+			{
+				tokens.push_back(monitoredRepository->first);
+				monitoredRepository = m_tokensToRepositories.erase(monitoredRepository);
+			}
+		}
+	}
+
+	for (auto token : tokens)
+		m_directoryMonitor->RemoveWatch(token);
+	m_changeJournal.StopJournaling(repositoryPath);
+
+	// Discovery results pointing into the working directory would otherwise outlive the
+	// watches that invalidate them.
+	for (const auto& workingDirectory : workingDirectories)
+		m_discoveryCache->InvalidateDirectory(workingDirectory);
+
+	// Status computed after the eviction but before the watches were released would never be
+	// invalidated again. Invalidating it makes the next request recompute and monitor it.
+	m_cache->InvalidateCacheEntry(repositoryPath);
+
+	Log("CacheInvalidator.StopMonitoringRepository", Severity::Verbose)
+		<< R"(Released watches for evicted repository. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "watchesReleased": )" << tokens.size() << R"( })";
+}
+
+/*static*/ bool CacheInvalidator::HasDirectoryChangedSince(
+	const std::string& directory,
+	uint64_t time,
+	bool recursive,
+	const std::unordered_set<std::wstring>& skippedDirectories)
+{
+	// Removing an entry only updates the last write time of the directory that contained it.
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (::GetFileAttributesEx(ConvertToUnicode(directory).c_str(), GetFileExInfoStandard, &attributes) == FALSE
+		|| ConvertFileTimeToUint64(attributes.ftLastWriteTime) + LastWriteTimeToleranceInFileTimeUnits >= time)
+	{
+		return true;
+	}
+
+	std::vector<std::wstring> directories{ ConvertToUnicode(directory) };
+	while (!directories.empty())
+	{
+		auto currentDirectory = std::move(directories.back());
+		directories.pop_back();
+
+		WIN32_FIND_DATA findData;
+		auto findHandle = ::FindFirstFileEx(
+			(currentDirectory + L"*").c_str(),
+			FindExInfoBasic,
+			&findData,
+			FindExSearchNameMatch,
+			nullptr /*lpSearchFilter*/,
+			FIND_FIRST_EX_LARGE_FETCH);
+		if (findHandle == INVALID_HANDLE_VALUE)
+			return true;
+		auto closeFindHandle = std::experimental::scope_guard([findHandle]() { ::FindClose(findHandle); });
+
+		do
+		{
+			auto name = std::wstring(findData.cFileName);
+			if (name == L"." || name == L"..")
+				continue;
+
+			if (ConvertFileTimeToUint64(findData.ftLastWriteTime) + LastWriteTimeToleranceInFileTimeUnits >= time)
+				return true;
+
+			auto isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0
+				&& (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0;
+			if (!recursive || !isDirectory || name == L".git")
+				continue;
+
+			auto subdirectory = currentDirectory + name + L"/";
+			if (skippedDirectories.count(subdirectory) == 0)
+				directories.push_back(std::move(subdirectory));
+		} while (::FindNextFile(findHandle, &findData) != FALSE);
+	}
+
+	return false;
+}
+
+/*static*/ bool CacheInvalidator::HasChangedSince(const Git::Status& status, uint64_t time)
+{
+	// Covers HEAD, index, config, and packed-refs. Loose refs are only kept in the common
+	// directory, which linked worktrees share with the main worktree.
+	const auto& commonDirectory = status.CommonDirectory.empty() ? status.RepositoryPath : status.CommonDirectory;
+	if (CacheInvalidator::HasDirectoryChangedSince(status.RepositoryPath, time, false /*recursive*/)
+		|| (commonDirectory != status.RepositoryPath && CacheInvalidator::HasDirectoryChangedSince(commonDirectory, time, false /*recursive*/))
+		|| CacheInvalidator::HasDirectoryChangedSince(commonDirectory + "refs/", time, true /*recursive*/))
+	{
+		return true;
+	}
+
+	if (status.WorkingDirectory.empty())
+		return false;
+
+	// Submodules are revalidated through their own cache entries.
+	std::unordered_set<std::wstring> submoduleDirectories;
+	for (const auto& submodule : status.Submodules)
+	{
+		if (!submodule.WorkingDirectory.empty())
+			submoduleDirectories.insert(ConvertToUnicode(submodule.WorkingDirectory));
+	}
+
+	return CacheInvalidator::HasDirectoryChangedSince(status.WorkingDirectory, time, true /*recursive*/, submoduleDirectories);
+}
+
+void CacheInvalidator::OnEventsLost()
+{
+	// Only journaled changes and discovery results need to be discarded outright. Cached
+	// status is revalidated in the background so repositories that didn't change aren't
+	// recomputed all at once.
+	m_changeJournal.RecordAllChanged();
+	m_discoveryCache->Clear();
+	m_cachePrimer.ScheduleRevalidationNow(&CacheInvalidator::HasChangedSince);
+
+	Log("CacheInvalidator.OnEventsLost", Severity::Warning)
+		<< R"(File change notifications were lost. Scheduled revalidation of cached git status.)";
+}
+
+void CacheInvalidator::OnFileChanged(DirectoryMonitor::Token token, const boost::filesystem::path& path, DirectoryMonitor::FileAction action)
+{
+	if (ChangeJournal::IsCookie(path))
+	{
+		m_changeJournal.OnCookieObserved(path);
+		return;
+	}
+
+	InvalidateRepositoryDiscovery(path, action);
+
+	if (CacheInvalidator::ShouldIgnoreFileChange(path))
+	{
+		Log("CacheInvalidator.OnFileChanged.IgnoringFileChange", Severity::Spam)
+			<< R"(Ignoring file change. { "filePath": ")" << path.c_str() << R"(" })";
+		return;
+	}
+
+	MonitoredRepository repository;
+	{
+		ReadLock readLock(m_tokensToRepositoriesMutex);
+		auto iterator = m_tokensToRepositories.find(token);
+		if (iterator == m_tokensToRepositories.end())
+		{
+			// Notifications queued before a repository was evicted may arrive after its watches
+			// were released.
+			Log("CacheInvalidator.OnFileChanged.UnknownToken", Severity::Verbose)
+				<< R"(Ignoring file change for unmonitored token. { "token": )" << token << R"(, "filePath": ")" << path.c_str() << R"(" })";
+			return;
+		}
+		repository = iterator->second;
+	}
+
+	const auto& repositoryPath = repository.RepositoryPath;
+	auto changedPath = CacheInvalidator::GetWorkingDirectoryRelativePath(repository, path);
+	if (!changedPath.empty())
+		m_changeJournal.RecordChange(repositoryPath, changedPath);
+
+	// Submodules are invalidated through their own tokens. Their parents are invalidated by the
+	// cache without recomputing the parent's own status.
+	if (CacheInvalidator::IsInSubmodule(repository, path))
+	{
+		Log("CacheInvalidator.OnFileChanged.IgnoringSubmoduleChange", Severity::Spam)
+			<< R"(Ignoring file change inside submodule. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "filePath": ")" << path.c_str() << R"(" })";
+		return;
+	}
+
+	if (CacheInvalidator::IsInCommonDirectory(repository, path))
+	{
+		CacheInvalidator::OnCommonDirectoryChanged(token, repository.CommonDirectory, path);
+		return;
+	}
+
+	// Watches kept for the common directory after the working directory's repository was
+	// evicted still report changes to the working directory.
+	if (repository.WorkingDirectory.empty() && repository.RepositoryPath != repository.CommonDirectory)
+		return;
+
+	if (CacheInvalidator::RequiresRepositoryReload(repositoryPath, repository.CommonDirectory, path))
+		m_cache->ReloadRepository(repositoryPath);
+
+	auto dirtyPath = CacheInvalidator::GetIncrementallyRecomputablePath(repository, path);
+	auto invalidatedEntry = dirtyPath.empty()
+		? m_cache->InvalidateCacheEntry(repositoryPath)
+		: m_cache->InvalidateCacheEntry(repositoryPath, dirtyPath);
+	if (invalidatedEntry)
+	{
+		Log("CacheInvalidator.OnFileChanged.InvalidatedCacheEntry", Severity::Info)
+			<< R"(Invalidated git status in cache for file change. { "token": )" << token
+			<< R"(, "repositoryPath": ")" << repositoryPath
+			<< R"(", "filePath": ")" << path.c_str() << R"(" })";
+	}
+
+	m_cachePrimer.SchedulePrimingForRepositoryPathInFiveSeconds(repositoryPath);
+}
+
+/*static*/ bool CacheInvalidator::IsInCommonDirectory(const MonitoredRepository& repository, const boost::filesystem::path& path)
+{
+	const auto& commonDirectory = repository.CommonDirectory;
+	if (commonDirectory.empty())
+		return false;
+
+	auto changedPath = ConvertToUtf8(path.generic_wstring()) + "/";
+	return changedPath.compare(0, commonDirectory.size(), commonDirectory) == 0;
+}
+
+/*static*/ bool CacheInvalidator::IsWorktreeAffectedByChange(
+	const std::string& repositoryPath,
+	const std::string& commonDirectory,
+	const std::string& changedPath)
+{
+	static const char* const sharedPaths[] = { "refs", "packed-refs", "objects", "config", "logs/refs", "info", "shallow" };
+
+	auto isUnder = [&changedPath](const std::string& directory)
+	{
+		return changedPath == directory
+			|| (changedPath.size() > directory.size()
+				&& changedPath.compare(0, directory.size(), directory) == 0
+				&& changedPath[directory.size()] == '/');
+	};
+
+	for (const auto& sharedPath : sharedPaths)
+	{
+		if (isUnder(sharedPath))
+			return true;
+	}
+
+	if (isUnder("worktrees"))
+	{
+		auto worktreeDirectory = repositoryPath.substr((std::min)(commonDirectory.size(), repositoryPath.size()));
+		if (!worktreeDirectory.empty() && worktreeDirectory.back() == '/')
+			worktreeDirectory.pop_back();
+		return repositoryPath != commonDirectory && isUnder(worktreeDirectory);
+	}
+
+	return repositoryPath == commonDirectory;
+}
+
+void CacheInvalidator::OnCommonDirectoryChanged(DirectoryMonitor::Token token, const std::string& commonDirectory, const boost::filesystem::path& path)
+{
+	auto changedPath = ConvertToUtf8(path.generic_wstring());
+	changedPath = changedPath.size() > commonDirectory.size() ? changedPath.substr(commonDirectory.size()) : std::string();
+
+	// Submodules are invalidated through their own tokens.
+	if (changedPath == "modules" || changedPath.compare(0, 8, "modules/") == 0)
+		return;
+
+	std::vector<std::string> affectedRepositories;
+	{
+		ReadLock readLock(m_tokensToRepositoriesMutex);
+		auto monitoredCommonDirectory = m_commonDirectories.find(commonDirectory);
+		if (monitoredCommonDirectory == m_commonDirectories.end() || monitoredCommonDirectory->second.Token != token)
+			return;
+
+		for (const auto& repositoryPath : monitoredCommonDirectory->second.RepositoryPaths)
+		{
+			if (CacheInvalidator::IsWorktreeAffectedByChange(repositoryPath, commonDirectory, changedPath))
+				affectedRepositories.push_back(repositoryPath);
+		}
+	}
+
+	for (const auto& repositoryPath : affectedRepositories)
+	{
+		if (CacheInvalidator::RequiresRepositoryReload(repositoryPath, commonDirectory, path))
+			m_cache->ReloadRepository(repositoryPath);
+
+		if (m_cache->InvalidateCacheEntry(repositoryPath))
+		{
+			Log("CacheInvalidator.OnCommonDirectoryChanged.InvalidatedCacheEntry", Severity::Info)
+				<< R"(Invalidated git status in cache for file change. { "token": )" << token
+				<< R"(, "repositoryPath": ")" << repositoryPath
+				<< R"(", "commonDirectory": ")" << commonDirectory
+				<< R"(", "filePath": ")" << path.c_str() << R"(" })";
+		}
+
+		m_cachePrimer.SchedulePrimingForRepositoryPathInFiveSeconds(repositoryPath);
+	}
+}
+
+void CacheInvalidator::InvalidateRepositoryDiscovery(const boost::filesystem::path& path, DirectoryMonitor::FileAction action)
+{
+	// Creating or removing .git changes which repository owns its parent and everything below.
+	// Modifications are reported for nearly every git operation and don't change ownership.
+	auto createsOrRemoves = action == DirectoryMonitor::FileAction::Added
+		|| action == DirectoryMonitor::FileAction::Removed
+		|| action == DirectoryMonitor::FileAction::RenamedFrom
+		|| action == DirectoryMonitor::FileAction::RenamedTo;
+	if (createsOrRemoves && path.has_filename() && path.filename().wstring() == L".git")
+		m_discoveryCache->InvalidateDirectory(ConvertToUtf8(path.parent_path().wstring()));
+
+	// Removed or renamed directories may have contained repositories.
+	if (action == DirectoryMonitor::FileAction::Removed || action == DirectoryMonitor::FileAction::RenamedFrom)
+		m_discoveryCache->InvalidateDirectory(ConvertToUtf8(path.wstring()));
+}
+
+/*static*/ bool CacheInvalidator::ShouldIgnoreFileChange(const boost::filesystem::path& path)
+{
+	if (!path.has_filename())
+		return false;
+
+	auto filename = path.filename();
+	return filename.wstring() == L"index.lock" || filename.wstring() == L".git";
+}
+
+/*static*/ bool CacheInvalidator::IsInSubmodule(const MonitoredRepository& repository, const boost::filesystem::path& path)
+{
+	if (repository.SubmoduleDirectories.empty())
+		return false;
+
+	auto changedPath = ConvertToUtf8(path.generic_wstring()) + "/";
+	for (const auto& submoduleDirectory : repository.SubmoduleDirectories)
+	{
+		if (changedPath.compare(0, submoduleDirectory.size(), submoduleDirectory) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*static*/ std::string CacheInvalidator::GetWorkingDirectoryRelativePath(const MonitoredRepository& repository, const boost::filesystem::path& path)
+{
+	auto changedPath = ConvertToUtf8(path.generic_wstring());
+
+	const auto& repositoryPath = repository.RepositoryPath;
+	if (!repositoryPath.empty() && changedPath.compare(0, repositoryPath.size(), repositoryPath) == 0)
+		return std::string();
+
+	const auto& workingDirectory = repository.WorkingDirectory;
+	if (workingDirectory.empty() || changedPath.size() <= workingDirectory.size()
+		|| changedPath.compare(0, workingDirectory.size(), workingDirectory) != 0)
+	{
+		return std::string();
+	}
+
+	return changedPath.substr(workingDirectory.size());
+}
+
+/*static*/ std::string CacheInvalidator::GetIncrementallyRecomputablePath(const MonitoredRepository& repository, const boost::filesystem::path& path)
+{
+	// Changes to ignore rules can affect every untracked path below them.
+	if (path.filename().wstring() == L".gitignore")
+		return std::string();
+
+	// Changes to the repository directory (index, refs, HEAD) or outside the working directory
+	// can affect every path.
+	return CacheInvalidator::GetWorkingDirectoryRelativePath(repository, path);
+}
+
+/*static*/ bool CacheInvalidator::RequiresRepositoryReload(const std::string& repositoryPath, const std::string& commonDirectory, const boost::filesystem::path& path)
+{
+	auto changedPath = ConvertToUtf8(path.generic_wstring());
+	return changedPath == repositoryPath + "index"
+		|| changedPath == repositoryPath + "config"
+		|| (!commonDirectory.empty() && changedPath == commonDirectory + "config");
+}
+
+void CacheInvalidator::SchedulePriming(const std::string& repositoryPath)
+{
+	m_cachePrimer.SchedulePrimingForRepositoryPathNow(repositoryPath);
+}
+
+ChangeJournal::Changes CacheInvalidator::GetChangesSince(const Git::Status& status, const std::string& token)
+{
+	auto isSynchronized = m_changeJournal.Synchronize(status.RepositoryPath);
+	return m_changeJournal.GetChangesSince(status.RepositoryPath, token, isSynchronized);
+}
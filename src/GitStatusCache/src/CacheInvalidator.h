@@ -1,42 +1,189 @@
-#pragma once
-#include "DirectoryMonitor.h"
-#include "Cache.h"
-#include "CachePrimer.h"
-
-/**
-* Invalidates cache entries in response to file system changes.
-* This class is thread-safe.
-*/
-class CacheInvalidator
-{
-private:
-	using ReadLock = boost::shared_lock<boost::shared_mutex>;
-	using WriteLock = boost::unique_lock<boost::shared_mutex>;
-	using UpgradableLock = boost::upgrade_lock<boost::shared_mutex>;
-	using UpgradedLock = boost::upgrade_to_unique_lock<boost::shared_mutex>;
-
-	std::shared_ptr<Cache> m_cache;
-	CachePrimer m_cachePrimer;
-
-	std::unique_ptr<DirectoryMonitor> m_directoryMonitor;
-	std::unordered_map<DirectoryMonitor::Token, std::string> m_tokensToRepositories;
-	boost::shared_mutex m_tokensToRepositoriesMutex;
-
-	/**
-	* Checks if the file change can be safely ignored.
-	*/
-	static bool ShouldIgnoreFileChange(const boost::filesystem::path& path);
-
-	/**
-	* Handles file change notifications by invalidating cache entries and scheduling priming.
-	*/
-	void OnFileChanged(DirectoryMonitor::Token token, const boost::filesystem::path& path, DirectoryMonitor::FileAction action);
-
-public:
-	CacheInvalidator(const std::shared_ptr<Cache>& cache);
-
-	/**
-	* Registers working directory and repository directory for file change monitoring.
-	*/
-	void MonitorRepositoryDirectories(const Git::Status& status);
+#pragma once
+#include "DirectoryMonitor.h"
+#include "Cache.h"
+#include "CachePrimer.h"
+#include "ChangeJournal.h"
+#include "RepositoryDiscoveryCache.h"
+
+/**
+* Invalidates cache entries in response to file system changes.
+* This class is thread-safe.
+*/
+class CacheInvalidator
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+	using UpgradableLock = boost::upgrade_lock<boost::shared_mutex>;
+	using UpgradedLock = boost::upgrade_to_unique_lock<boost::shared_mutex>;
+
+	/**
+	* Margin by which a last write time may precede the start of a status computation and
+	* still count as a change. FAT volumes record last write times with two second precision
+	* and clocks of network shares can drift.
+	*/
+	static const uint64_t LastWriteTimeToleranceInFileTimeUnits = 2 * 10000000;
+
+	std::shared_ptr<Cache> m_cache;
+	std::shared_ptr<RepositoryDiscoveryCache> m_discoveryCache;
+	CachePrimer m_cachePrimer;
+	ChangeJournal m_changeJournal;
+
+	std::unique_ptr<DirectoryMonitor> m_directoryMonitor;
+	/**
+	* Repository associated with a monitored directory. Submodule directories are monitored
+	* separately under their own tokens. HasSubmoduleDirectories is false if the repository
+	* was registered from a status without submodules, which doesn't know them.
+	*/
+	struct MonitoredRepository
+	{
+		std::string RepositoryPath;
+		std::string WorkingDirectory;
+		std::string CommonDirectory;
+		std::vector<std::string> SubmoduleDirectories;
+		bool HasSubmoduleDirectories = false;
+	};
+
+	/**
+	* Repositories sharing a common directory. Linked worktrees share the common directory with
+	* the main worktree. Changes inside it are only handled when reported through Token, since
+	* overlapping watches can report the same change more than once.
+	*/
+	struct MonitoredCommonDirectory
+	{
+		DirectoryMonitor::Token Token;
+		std::unordered_set<std::string> RepositoryPaths;
+	};
+
+	std::unordered_map<DirectoryMonitor::Token, MonitoredRepository> m_tokensToRepositories;
+	std::unordered_map<std::string, MonitoredCommonDirectory> m_commonDirectories;
+	boost::shared_mutex m_tokensToRepositoriesMutex;
+
+	/**
+	* Registers working directory and common directory of a repository for file change monitoring.
+	*/
+	void MonitorRepositoryDirectories(const MonitoredRepository& repository);
+
+	/**
+	* Associates token with repository. Submodule directories already registered for the token
+	* are kept if the repository doesn't know its submodule directories. Mutex must be held.
+	*/
+	void RegisterMonitoredRepository(DirectoryMonitor::Token token, const MonitoredRepository& repository);
+
+	/**
+	* Records that changes reported through token cover the common directory, unless another
+	* token already does.
+	*/
+	void MonitorCommonDirectory(DirectoryMonitor::Token token, const MonitoredRepository& repository);
+
+	/**
+	* Releases watches, journaled changes, and discovery results for a repository evicted from
+	* the cache. Watches on a common directory are kept for other cached worktrees sharing it.
+	*/
+	void StopMonitoringRepository(const std::string& repositoryPath);
+
+	/**
+	* Checks if the file change is inside the working directory or repository directory of one
+	* of the repository's submodules.
+	*/
+	static bool IsInSubmodule(const MonitoredRepository& repository, const boost::filesystem::path& path);
+
+	/**
+	* Checks if the file change is inside the repository's common directory.
+	*/
+	static bool IsInCommonDirectory(const MonitoredRepository& repository, const boost::filesystem::path& path);
+
+	/**
+	* Checks if a change to a path relative to the common directory affects the repository.
+	* References, objects, and config are shared by every worktree. Everything else belongs
+	* to the main worktree, or to the linked worktree whose directory is under worktrees/.
+	*/
+	static bool IsWorktreeAffectedByChange(
+		const std::string& repositoryPath,
+		const std::string& commonDirectory,
+		const std::string& changedPath);
+
+	/**
+	* Invalidates every repository sharing the common directory that's affected by the change.
+	*/
+	void OnCommonDirectoryChanged(DirectoryMonitor::Token token, const std::string& commonDirectory, const boost::filesystem::path& path);
+
+	/**
+	* Discards repository discovery results that may be affected by the file change.
+	*/
+	void InvalidateRepositoryDiscovery(const boost::filesystem::path& path, DirectoryMonitor::FileAction action);
+
+	/**
+	* Checks if the file change can be safely ignored.
+	*/
+	static bool ShouldIgnoreFileChange(const boost::filesystem::path& path);
+
+	/**
+	* Returns path relative to the working directory if the change is inside the working
+	* directory and outside the repository directory. Otherwise returns empty string.
+	*/
+	static std::string GetWorkingDirectoryRelativePath(const MonitoredRepository& repository, const boost::filesystem::path& path);
+
+	/**
+	* Returns path relative to the working directory if the change can be handled by recomputing
+	* only the changed path. Returns empty string if the change requires a full recompute.
+	*/
+	static std::string GetIncrementallyRecomputablePath(const MonitoredRepository& repository, const boost::filesystem::path& path);
+
+	/**
+	* Checks if the file change requires reopening repository handles (config or index changed).
+	*/
+	static bool RequiresRepositoryReload(const std::string& repositoryPath, const std::string& commonDirectory, const boost::filesystem::path& path);
+
+	/**
+	* Checks if anything in the directory was written since the provided time. Recurses into
+	* subdirectories other than .git and skipped directories if recursive is true. Treats
+	* directories that can't be read as changed.
+	*/
+	static bool HasDirectoryChangedSince(
+		const std::string& directory,
+		uint64_t time,
+		bool recursive,
+		const std::unordered_set<std::wstring>& skippedDirectories = std::unordered_set<std::wstring>());
+
+	/**
+	* Checks if the repository may have changed since the provided time without relying on
+	* file change notifications. Compares last write times of the repository directory, refs,
+	* and every file and directory in the working directory outside submodules. Enumerating
+	* a directory returns last write times of its files without opening them.
+	*/
+	static bool HasChangedSince(const Git::Status& status, uint64_t time);
+
+	/**
+	* Handles lost file change notifications by revalidating every cached repository.
+	*/
+	void OnEventsLost();
+
+	/**
+	* Handles file change notifications by invalidating cache entries and scheduling priming.
+	*/
+	void OnFileChanged(DirectoryMonitor::Token token, const boost::filesystem::path& path, DirectoryMonitor::FileAction action);
+
+public:
+	CacheInvalidator(const std::shared_ptr<Cache>& cache, const std::shared_ptr<RepositoryDiscoveryCache>& discoveryCache);
+	~CacheInvalidator();
+
+	/**
+	* Registers working directory and repository directory for file change monitoring. Also
+	* registers directories of checked out submodules, including submodules of submodules
+	* known from their cached status. Worktrees sharing a common directory share a single
+	* watch on it.
+	*/
+	void MonitorRepositoryDirectories(const Git::Status& status);
+
+	/**
+	* Primes cache entry for repository in the background as soon as possible.
+	*/
+	void SchedulePriming(const std::string& repositoryPath);
+
+	/**
+	* Retrieves paths in the working directory changed since token. Repository directories
+	* must already be monitored.
+	*/
+	ChangeJournal::Changes GetChangesSince(const Git::Status& status, const std::string& token);
 };
\ No newline at end of file
@@ -1,12 +1,21 @@
-#pragma once
-
-struct CacheStatistics
-{
-	uint64_t CacheHits = 0;
-	uint64_t CacheMisses = 0;
-	uint64_t CacheEffectivePrimeRequests = 0;
-	uint64_t CacheTotalPrimeRequests = 0;
-	uint64_t CacheEffectiveInvalidationRequests = 0;
-	uint64_t CacheTotalInvalidationRequests = 0;
-	uint64_t CacheInvalidateAllRequests = 0;
+#pragma once
+
+struct CacheStatistics
+{
+	uint64_t CacheHits = 0;
+	uint64_t CacheMisses = 0;
+	uint64_t CacheEffectivePrimeRequests = 0;
+	uint64_t CacheTotalPrimeRequests = 0;
+	uint64_t CacheEffectiveInvalidationRequests = 0;
+	uint64_t CacheTotalInvalidationRequests = 0;
+	uint64_t CacheInvalidateAllRequests = 0;
+	uint64_t CacheIncrementalRecomputes = 0;
+	uint64_t CacheCoalescedComputations = 0;
+	uint64_t CacheStaleHits = 0;
+	uint64_t CacheEvictions = 0;
+	uint64_t CacheBytes = 0;
+	uint64_t CacheEntries = 0;
+	uint64_t CacheRestoredEntries = 0;
+	uint64_t CacheRevalidations = 0;
+	uint64_t CacheRevalidatedChanges = 0;
 };
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "ChangeJournal.h"
+#include "StringConverters.h"
+
+/*static*/ const std::string ChangeJournal::TokenPrefix = "GitStatusCache:";
+/*static*/ const std::string ChangeJournal::CookiePrefix = "fsmonitor--gitstatuscache-cookie-";
+
+ChangeJournal::ChangeJournal()
+	: m_instanceId(std::to_string(::GetCurrentProcessId()) + "-" + std::to_string(::GetTickCount64()))
+{
+}
+
+std::string ChangeJournal::MakeToken(uint64_t sequence) const
+{
+	return TokenPrefix + m_instanceId + ":" + std::to_string(sequence);
+}
+
+bool ChangeJournal::ParseToken(const std::string& token, uint64_t& sequence) const
+{
+	auto instancePrefix = TokenPrefix + m_instanceId + ":";
+	if (token.size() <= instancePrefix.size() || token.compare(0, instancePrefix.size(), instancePrefix) != 0)
+		return false;
+
+	try
+	{
+		size_t parsedCharacters = 0;
+		auto sequenceString = token.substr(instancePrefix.size());
+		sequence = std::stoull(sequenceString, &parsedCharacters);
+		return parsedCharacters == sequenceString.size();
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+/*static*/ bool ChangeJournal::IsCookie(const boost::filesystem::path& path)
+{
+	if (!path.has_filename())
+		return false;
+
+	auto filename = ConvertToUtf8(path.filename().wstring());
+	return filename.compare(0, CookiePrefix.size(), CookiePrefix) == 0;
+}
+
+void ChangeJournal::OnCookieObserved(const boost::filesystem::path& path)
+{
+	auto filename = ConvertToUtf8(path.filename().wstring());
+	{
+		std::lock_guard<std::mutex> lock(m_pendingCookiesMutex);
+		if (m_pendingCookies.erase(filename) == 0)
+			return;
+	}
+	m_cookieObserved.notify_all();
+}
+
+bool ChangeJournal::Synchronize(const std::string& repositoryPath)
+{
+	auto cookieName = CookiePrefix + m_instanceId + "-" + std::to_string(++m_nextCookie);
+	auto cookiePath = boost::filesystem::path(ConvertToUnicode(repositoryPath));
+	cookiePath.append(ConvertToUnicode(cookieName));
+
+	{
+		std::lock_guard<std::mutex> lock(m_pendingCookiesMutex);
+		m_pendingCookies.insert(cookieName);
+	}
+
+	auto cookie = MakeUniqueHandle(::CreateFile(
+		cookiePath.wstring().c_str(),
+		GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr /*lpSecurityAttributes*/,
+		CREATE_NEW,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+		nullptr /*hTemplateFile*/));
+
+	std::unique_lock<std::mutex> lock(m_pendingCookiesMutex);
+	auto isObserved = false;
+	if (cookie != INVALID_HANDLE_VALUE)
+	{
+		isObserved = m_cookieObserved.wait_for(
+			lock,
+			std::chrono::milliseconds(CookieTimeoutInMilliseconds),
+			[this, &cookieName] { return m_pendingCookies.find(cookieName) == m_pendingCookies.end(); });
+	}
+	m_pendingCookies.erase(cookieName);
+
+	if (!isObserved)
+	{
+		Log("ChangeJournal.Synchronize.Failed", Severity::Warning)
+			<< R"(Failed to observe cookie file. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "cookieCreated": )" << (cookie != INVALID_HANDLE_VALUE ? "true" : "false") << R"( })";
+	}
+
+	return isObserved;
+}
+
+void ChangeJournal::RecordChange(const std::string& repositoryPath, const std::string& path)
+{
+	WriteLock writeLock(m_journalsMutex);
+	auto journal = m_journals.find(repositoryPath);
+	if (journal == m_journals.end())
+		return;
+
+	auto& changes = journal->second.Changes;
+	changes.emplace_back(++m_sequence, path);
+	if (changes.size() > MaximumChangesPerRepository)
+	{
+		auto firstRetained = changes.begin() + changes.size() / 2;
+		journal->second.OldestSequence = (firstRetained - 1)->first;
+		changes.erase(changes.begin(), firstRetained);
+
+		Log("ChangeJournal.RecordChange.DroppedChanges", Severity::Info)
+			<< R"(Dropped oldest changes from journal. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "oldestSequence": )" << journal->second.OldestSequence << R"( })";
+	}
+}
+
+void ChangeJournal::RecordAllChanged()
+{
+	WriteLock writeLock(m_journalsMutex);
+	++m_sequence;
+	for (auto& journal : m_journals)
+	{
+		journal.second.OldestSequence = m_sequence;
+		journal.second.Changes.clear();
+	}
+}
+
+void ChangeJournal::StopJournaling(const std::string& repositoryPath)
+{
+	WriteLock writeLock(m_journalsMutex);
+	m_journals.erase(repositoryPath);
+}
+
+ChangeJournal::Changes ChangeJournal::GetChangesSince(const std::string& repositoryPath, const std::string& token, bool isSynchronized)
+{
+	Changes changes;
+	uint64_t sequence = 0;
+	auto isTokenValid = ParseToken(token, sequence);
+
+	WriteLock writeLock(m_journalsMutex);
+	if (!isSynchronized)
+	{
+		changes.Token = TokenPrefix + "unsynchronized";
+		return changes;
+	}
+
+	auto journal = m_journals.find(repositoryPath);
+	if (journal == m_journals.end())
+	{
+		Log("ChangeJournal.GetChangesSince.StartJournal", Severity::Info)
+			<< R"(Started journaling changes. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		m_journals[repositoryPath].OldestSequence = m_sequence;
+		changes.Token = MakeToken(m_sequence);
+		return changes;
+	}
+
+	changes.Token = MakeToken(m_sequence);
+	if (!isTokenValid || sequence < journal->second.OldestSequence || sequence > m_sequence)
+		return changes;
+
+	const auto& recordedChanges = journal->second.Changes;
+	auto firstChange = std::upper_bound(
+		recordedChanges.begin(),
+		recordedChanges.end(),
+		sequence,
+		[](uint64_t value, const std::pair<uint64_t, std::string>& change) { return value < change.first; });
+
+	std::unordered_set<std::string> uniquePaths;
+	for (auto change = firstChange; change != recordedChanges.end(); ++change)
+	{
+		if (uniquePaths.insert(change->second).second)
+			changes.Paths.push_back(change->second);
+	}
+
+	changes.AllChanged = false;
+	return changes;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <condition_variable>
+
+/**
+* Records paths changed in working directories so clients such as git's fsmonitor hook can
+* ask for changes since a previously returned token. Only repositories that have been
+* queried at least once are journaled.
+* This class is thread-safe.
+*/
+class ChangeJournal : boost::noncopyable
+{
+public:
+	/**
+	* Paths changed since a token. If AllChanged is set the token couldn't be honored
+	* and the client must assume every path changed.
+	*/
+	struct Changes
+	{
+		bool AllChanged = true;
+		std::string Token;
+		std::vector<std::string> Paths;
+	};
+
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	/**
+	* Changes recorded for a repository. Tokens older than OldestSequence can't be honored
+	* because changes after them were dropped or lost.
+	*/
+	struct RepositoryJournal
+	{
+		uint64_t OldestSequence = 0;
+		std::vector<std::pair<uint64_t, std::string>> Changes;
+	};
+
+	/**
+	* Number of changes retained per repository before the oldest half is dropped.
+	*/
+	static const size_t MaximumChangesPerRepository = 100000;
+
+	/**
+	* Time to wait for the directory monitor to report a cookie file.
+	*/
+	static const uint32_t CookieTimeoutInMilliseconds = 1000;
+
+	/**
+	* Prefix of tokens issued by the journal.
+	*/
+	static const std::string TokenPrefix;
+
+	/**
+	* Prefix of cookie files created in the repository directory by Synchronize.
+	*/
+	static const std::string CookiePrefix;
+
+	const std::string m_instanceId;
+	uint64_t m_sequence = 0;
+	std::unordered_map<std::string, RepositoryJournal> m_journals;
+	boost::shared_mutex m_journalsMutex;
+
+	std::atomic<uint64_t> m_nextCookie = 0;
+	std::unordered_set<std::string> m_pendingCookies;
+	std::mutex m_pendingCookiesMutex;
+	std::condition_variable m_cookieObserved;
+
+	/**
+	* Builds token for sequence number.
+	*/
+	std::string MakeToken(uint64_t sequence) const;
+
+	/**
+	* Extracts sequence number from token. Fails for tokens issued by other instances.
+	*/
+	bool ParseToken(const std::string& token, uint64_t& sequence) const;
+
+public:
+	ChangeJournal();
+
+	/**
+	* Checks if path is a cookie file created by Synchronize.
+	*/
+	static bool IsCookie(const boost::filesystem::path& path);
+
+	/**
+	* Signals threads waiting in Synchronize that the directory monitor reported the cookie.
+	*/
+	void OnCookieObserved(const boost::filesystem::path& path);
+
+	/**
+	* Waits until changes made before this call have been reported by the directory monitor.
+	* Creates a cookie file in the repository directory and waits for its notification.
+	*/
+	bool Synchronize(const std::string& repositoryPath);
+
+	/**
+	* Records change to path relative to working directory.
+	*/
+	void RecordChange(const std::string& repositoryPath, const std::string& path);
+
+	/**
+	* Records that changes may have been missed for all repositories.
+	*/
+	void RecordAllChanged();
+
+	/**
+	* Discards changes recorded for repository that's no longer monitored. Tokens previously
+	* issued for it are no longer honored.
+	*/
+	void StopJournaling(const std::string& repositoryPath);
+
+	/**
+	* Retrieves paths changed since token and a new token. Starts journaling the repository if
+	* needed. If the directory monitor couldn't be synchronized the returned token is never honored.
+	*/
+	Changes GetChangesSince(const std::string& repositoryPath, const std::string& token, bool isSynchronized);
+};
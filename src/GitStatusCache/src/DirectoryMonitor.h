@@ -1,69 +1,76 @@
-#pragma once
-
-#include <boost/thread/shared_mutex.hpp>
-#include <ReadDirectoryChanges.h>
-
-/**
- * Monitors directories for changes and provides notifications by callback.
- */
-class DirectoryMonitor : boost::noncopyable
-{
-public:
-	/**
-	 * Action that triggered change notification.
-	 */
-	enum FileAction
-	{
-		Unknown,
-		Added,
-		Removed,
-		Modified,
-		RenamedFrom,
-		RenamedTo
-	};
-
-	/**
-	* Identifies AddDirectory call. Passed back with file change notifications.
-	*/
-	using Token = uint32_t;
-
-	/**
-	 * Callback for change notifications. Provides path and change action.
-	 */
-	using OnChangeCallback = std::function<void(Token, const boost::filesystem::path&, FileAction)>;
-
-	/**
-	 * Callback for events lost notification. Notifications may be lost if changes
-	 * occur more rapidly than they are processed.
-	 */
-	using OnEventsLostCallback = std::function<void(void)>;
-
-private:
-	HANDLE m_stopNotificationThread = INVALID_HANDLE_VALUE;
-	std::thread m_notificationThread;
-
-	OnChangeCallback m_onChangeCallback;
-	OnEventsLostCallback m_onEventsLostCallback;
-
-	CReadDirectoryChanges m_readDirectoryChanges;
-
-	std::unordered_map<std::wstring, Token> m_directories;
-	boost::shared_mutex m_directoriesMutex;
-
-	void WaitForNotifications();
-
-public:
-	/**
-	 * Constructor. Callbacks will always be invoked on the same thread.
-	 * @param onChangeCallback Callback for change notification.
-	 * @param onEventsLostCallback Callback for lost events notification.
-	 */
-	DirectoryMonitor(const OnChangeCallback& onChangeCallback, const OnEventsLostCallback& onEventsLostCallback);
-	~DirectoryMonitor();
-
-	/**
-	 * Registers a directory for change notifications.
-	 * This method is thread-safe.
-	 */
-	Token AddDirectory(const std::wstring& directory);
+#pragma once
+
+#include <boost/thread/shared_mutex.hpp>
+#include <ReadDirectoryChanges.h>
+
+/**
+ * Monitors directories for changes and provides notifications by callback.
+ */
+class DirectoryMonitor : boost::noncopyable
+{
+public:
+	/**
+	 * Action that triggered change notification.
+	 */
+	enum FileAction
+	{
+		Unknown,
+		Added,
+		Removed,
+		Modified,
+		RenamedFrom,
+		RenamedTo
+	};
+
+	/**
+	* Identifies AddDirectory call. Passed back with file change notifications.
+	*/
+	using Token = uint32_t;
+
+	/**
+	 * Callback for change notifications. Provides path and change action.
+	 */
+	using OnChangeCallback = std::function<void(Token, const boost::filesystem::path&, FileAction)>;
+
+	/**
+	 * Callback for events lost notification. Notifications may be lost if changes
+	 * occur more rapidly than they are processed.
+	 */
+	using OnEventsLostCallback = std::function<void(void)>;
+
+private:
+	HANDLE m_stopNotificationThread = INVALID_HANDLE_VALUE;
+	std::thread m_notificationThread;
+
+	OnChangeCallback m_onChangeCallback;
+	OnEventsLostCallback m_onEventsLostCallback;
+
+	CReadDirectoryChanges m_readDirectoryChanges;
+
+	std::unordered_map<std::wstring, Token> m_directories;
+	boost::shared_mutex m_directoriesMutex;
+
+	void WaitForNotifications();
+
+public:
+	/**
+	 * Constructor. Callbacks will always be invoked on the same thread.
+	 * @param onChangeCallback Callback for change notification.
+	 * @param onEventsLostCallback Callback for lost events notification.
+	 */
+	DirectoryMonitor(const OnChangeCallback& onChangeCallback, const OnEventsLostCallback& onEventsLostCallback);
+	~DirectoryMonitor();
+
+	/**
+	 * Registers a directory for change notifications.
+	 * This method is thread-safe.
+	 */
+	Token AddDirectory(const std::wstring& directory);
+
+	/**
+	 * Stops change notifications for a directory registered by AddDirectory. Notifications
+	 * already queued for the token may still be delivered.
+	 * This method is thread-safe.
+	 */
+	void RemoveWatch(Token token);
 };
\ No newline at end of file
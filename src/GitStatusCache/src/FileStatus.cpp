@@ -0,0 +1,111 @@
+#include "stdafx.h"
+#include "FileStatus.h"
+
+size_t GetArenaSize(const std::vector<std::string>& paths)
+{
+	auto size = size_t{ 0 };
+	for (const auto& path : paths)
+		size += path.size();
+	return size;
+}
+
+size_t GetArenaSize(const std::vector<std::pair<std::string, std::string>>& renames)
+{
+	auto size = size_t{ 0 };
+	for (const auto& rename : renames)
+		size += rename.first.size() + rename.second.size();
+	return size;
+}
+
+FileStatus::FileStatus(const Lists& lists)
+{
+	m_arena.reserve(
+		GetArenaSize(lists.IndexAdded)
+		+ GetArenaSize(lists.IndexModified)
+		+ GetArenaSize(lists.IndexDeleted)
+		+ GetArenaSize(lists.IndexTypeChange)
+		+ GetArenaSize(lists.IndexRenamed)
+		+ GetArenaSize(lists.WorkingAdded)
+		+ GetArenaSize(lists.WorkingModified)
+		+ GetArenaSize(lists.WorkingDeleted)
+		+ GetArenaSize(lists.WorkingTypeChange)
+		+ GetArenaSize(lists.WorkingUnreadable)
+		+ GetArenaSize(lists.WorkingRenamed)
+		+ GetArenaSize(lists.Ignored)
+		+ GetArenaSize(lists.Conflicted));
+	m_entries.reserve(
+		lists.IndexAdded.size()
+		+ lists.IndexModified.size()
+		+ lists.IndexDeleted.size()
+		+ lists.IndexTypeChange.size()
+		+ 2 * lists.IndexRenamed.size()
+		+ lists.WorkingAdded.size()
+		+ lists.WorkingModified.size()
+		+ lists.WorkingDeleted.size()
+		+ lists.WorkingTypeChange.size()
+		+ lists.WorkingUnreadable.size()
+		+ 2 * lists.WorkingRenamed.size()
+		+ lists.Ignored.size()
+		+ lists.Conflicted.size());
+
+	// Categories must be appended in enum order.
+	Append(IndexAdded, lists.IndexAdded);
+	Append(IndexModified, lists.IndexModified);
+	Append(IndexDeleted, lists.IndexDeleted);
+	Append(IndexTypeChange, lists.IndexTypeChange);
+	Append(IndexRenamed, lists.IndexRenamed);
+	Append(WorkingAdded, lists.WorkingAdded);
+	Append(WorkingModified, lists.WorkingModified);
+	Append(WorkingDeleted, lists.WorkingDeleted);
+	Append(WorkingTypeChange, lists.WorkingTypeChange);
+	Append(WorkingUnreadable, lists.WorkingUnreadable);
+	Append(WorkingRenamed, lists.WorkingRenamed);
+	Append(Ignored, lists.Ignored);
+	Append(Conflicted, lists.Conflicted);
+}
+
+void FileStatus::Append(const std::string& path)
+{
+	m_entries.push_back(Entry{ static_cast<uint32_t>(m_arena.size()), static_cast<uint32_t>(path.size()) });
+	m_arena.append(path);
+}
+
+void FileStatus::Append(Category category, const std::vector<std::string>& paths)
+{
+	m_categoryStart[category] = static_cast<uint32_t>(m_entries.size());
+	for (const auto& path : paths)
+		Append(path);
+	m_categoryStart[category + 1] = static_cast<uint32_t>(m_entries.size());
+}
+
+void FileStatus::Append(Category category, const std::vector<std::pair<std::string, std::string>>& renames)
+{
+	m_categoryStart[category] = static_cast<uint32_t>(m_entries.size());
+	for (const auto& rename : renames)
+	{
+		Append(rename.first);
+		Append(rename.second);
+	}
+	m_categoryStart[category + 1] = static_cast<uint32_t>(m_entries.size());
+}
+
+FileStatus::PathRange FileStatus::GetPaths(Category category) const
+{
+	return PathRange(this, m_categoryStart[category], m_categoryStart[category + 1]);
+}
+
+FileStatus::RenameRange FileStatus::GetRenames(Category category) const
+{
+	return RenameRange(this, m_categoryStart[category], m_categoryStart[category + 1]);
+}
+
+size_t FileStatus::GetCount(Category category) const
+{
+	auto count = static_cast<size_t>(m_categoryStart[category + 1] - m_categoryStart[category]);
+	return (category == IndexRenamed || category == WorkingRenamed) ? count / 2 : count;
+}
+
+size_t FileStatus::GetSizeInBytes() const
+{
+	return m_arena.capacity() + m_entries.capacity() * sizeof(Entry);
+}
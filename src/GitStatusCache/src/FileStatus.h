@@ -0,0 +1,170 @@
+#pragma once
+#include <boost/utility/string_ref.hpp>
+
+/**
+ * Immutable file status packed into a single string arena. Each path is an offset and length
+ * into the arena and each category is a contiguous range of paths, so copying file status
+ * copies two flat buffers no matter how many files changed. Renames are stored as two
+ * consecutive paths, old then new.
+ */
+class FileStatus
+{
+public:
+	enum Category : uint32_t
+	{
+		IndexAdded,
+		IndexModified,
+		IndexDeleted,
+		IndexTypeChange,
+		IndexRenamed,
+		WorkingAdded,
+		WorkingModified,
+		WorkingDeleted,
+		WorkingTypeChange,
+		WorkingUnreadable,
+		WorkingRenamed,
+		Ignored,
+		Conflicted,
+		CategoryCount
+	};
+
+	/**
+	 * Mutable file status used while status is computed. Packed into FileStatus once complete.
+	 */
+	struct Lists
+	{
+		std::vector<std::string> IndexAdded;
+		std::vector<std::string> IndexModified;
+		std::vector<std::string> IndexDeleted;
+		std::vector<std::string> IndexTypeChange;
+		std::vector<std::pair<std::string, std::string>> IndexRenamed;
+
+		std::vector<std::string> WorkingAdded;
+		std::vector<std::string> WorkingModified;
+		std::vector<std::string> WorkingDeleted;
+		std::vector<std::string> WorkingTypeChange;
+		std::vector<std::string> WorkingUnreadable;
+		std::vector<std::pair<std::string, std::string>> WorkingRenamed;
+
+		std::vector<std::string> Ignored;
+		std::vector<std::string> Conflicted;
+	};
+
+private:
+	struct Entry
+	{
+		uint32_t Offset;
+		uint32_t Length;
+	};
+
+	std::string m_arena;
+	std::vector<Entry> m_entries;
+	uint32_t m_categoryStart[CategoryCount + 1] = {};
+
+	boost::string_ref GetPath(size_t entryIndex) const
+	{
+		const auto& entry = m_entries[entryIndex];
+		return boost::string_ref(m_arena.data() + entry.Offset, entry.Length);
+	}
+
+	void Append(const std::string& path);
+	void Append(Category category, const std::vector<std::string>& paths);
+	void Append(Category category, const std::vector<std::pair<std::string, std::string>>& renames);
+
+public:
+	/**
+	 * Paths in a single category. Paths point into the arena and are only valid while the
+	 * file status they came from is alive.
+	 */
+	class PathRange
+	{
+	private:
+		const FileStatus* m_fileStatus;
+		size_t m_begin;
+		size_t m_end;
+
+	public:
+		class Iterator
+		{
+		private:
+			const FileStatus* m_fileStatus;
+			size_t m_index;
+
+		public:
+			Iterator(const FileStatus* fileStatus, size_t index) : m_fileStatus(fileStatus), m_index(index) { }
+			boost::string_ref operator*() const { return m_fileStatus->GetPath(m_index); }
+			Iterator& operator++() { ++m_index; return *this; }
+			bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+			bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+		};
+
+		PathRange(const FileStatus* fileStatus, size_t begin, size_t end) : m_fileStatus(fileStatus), m_begin(begin), m_end(end) { }
+		Iterator begin() const { return Iterator(m_fileStatus, m_begin); }
+		Iterator end() const { return Iterator(m_fileStatus, m_end); }
+		size_t size() const { return m_end - m_begin; }
+		bool empty() const { return m_begin == m_end; }
+		boost::string_ref operator[](size_t index) const { return m_fileStatus->GetPath(m_begin + index); }
+	};
+
+	/**
+	 * Renames in a single category as old and new path pairs.
+	 */
+	class RenameRange
+	{
+	private:
+		const FileStatus* m_fileStatus;
+		size_t m_begin;
+		size_t m_end;
+
+	public:
+		class Iterator
+		{
+		private:
+			const FileStatus* m_fileStatus;
+			size_t m_index;
+
+		public:
+			Iterator(const FileStatus* fileStatus, size_t index) : m_fileStatus(fileStatus), m_index(index) { }
+			std::pair<boost::string_ref, boost::string_ref> operator*() const
+			{
+				return std::make_pair(m_fileStatus->GetPath(m_index), m_fileStatus->GetPath(m_index + 1));
+			}
+			Iterator& operator++() { m_index += 2; return *this; }
+			bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+			bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+		};
+
+		RenameRange(const FileStatus* fileStatus, size_t begin, size_t end) : m_fileStatus(fileStatus), m_begin(begin), m_end(end) { }
+		Iterator begin() const { return Iterator(m_fileStatus, m_begin); }
+		Iterator end() const { return Iterator(m_fileStatus, m_end); }
+		size_t size() const { return (m_end - m_begin) / 2; }
+		bool empty() const { return m_begin == m_end; }
+	};
+
+	FileStatus() = default;
+
+	/**
+	 * Packs lists into a single arena.
+	 */
+	explicit FileStatus(const Lists& lists);
+
+	/**
+	 * Retrieves paths in a category. Must not be called for rename categories.
+	 */
+	PathRange GetPaths(Category category) const;
+
+	/**
+	 * Retrieves renames in IndexRenamed or WorkingRenamed.
+	 */
+	RenameRange GetRenames(Category category) const;
+
+	/**
+	 * Retrieves number of paths or renames in a category.
+	 */
+	size_t GetCount(Category category) const;
+
+	/**
+	 * Retrieves size in bytes of the arena and path entries.
+	 */
+	size_t GetSizeInBytes() const;
+};
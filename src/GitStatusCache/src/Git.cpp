@@ -1,586 +1,1235 @@
-#include "stdafx.h"
-#include "Git.h"
-#include "StringConverters.h"
-#include <boost/filesystem/operations.hpp>
-#include <iostream>
-#include <fstream>
-
-std::string ReadFirstLineInFile(const boost::filesystem::path& path)
-{
-	if (!boost::filesystem::exists(path))
-		return std::string();
-
-	auto fileStream = std::ifstream(path.c_str());
-	if (!fileStream.good())
-		return std::string();
-
-	std::string firstLine;
-	std::getline(fileStream, firstLine);
-	return firstLine;
-}
-
-std::string ConvertErrorCodeToString(git_error_code errorCode)
-{
-	switch (errorCode)
-	{
-	default:
-		return "Unknown";
-	case GIT_OK:
-		return "Success";
-	case GIT_ERROR:
-		return "Generic Error";
-	case GIT_ENOTFOUND:
-		return "Requested object could not be found";
-	case GIT_EEXISTS:
-		return "Object exists preventing operation";
-	case GIT_EAMBIGUOUS:
-		return "More than one object matches";
-	case GIT_EBUFS:
-		return "Output buffer too short";
-	case GIT_EUSER:
-		return "User generated error";
-	case GIT_EBAREREPO:
-		return "Operation not allowed on bare repository";
-	case GIT_EUNBORNBRANCH:
-		return "HEAD refers to branch with no commits";
-	case GIT_EUNMERGED:
-		return "Merge in progress prevented operation";
-	case GIT_ENONFASTFORWARD:
-		return "Reference not fast-forwardable";
-	case GIT_EINVALIDSPEC:
-		return "Invalid name/ref spec";
-	case GIT_ECONFLICT:
-		return "Checkout conflicts prevented operation";
-	case GIT_ELOCKED:
-		return "Lock file prevented operation";
-	case GIT_EMODIFIED:
-		return "Reference value does not match expected";
-	case GIT_EAUTH:
-		return "Authentication error";
-	case GIT_ECERTIFICATE:
-		return "Invalid certificate";
-	case GIT_EAPPLIED:
-		return "Patch or merge already applied";
-	case GIT_EPEEL:
-		return "Peel operation is not possible";
-	case GIT_EEOF:
-		return "Unexpected end of file";
-	case GIT_EINVALID:
-		return "Invalid operation or input";
-	case GIT_EUNCOMMITTED:
-		return "Prevented due to uncommitted changes";
-	case GIT_PASSTHROUGH:
-		return "Passthrough";
-	case GIT_ITEROVER:
-		return "Iteration complete";
-	}
-}
-
-Git::Git()
-{
-	git_libgit2_init();
-}
-
-Git::~Git()
-{
-	git_libgit2_shutdown();
-}
-
-bool Git::DiscoverRepository(Git::Status& status, const std::string& path)
-{
-	status.RepositoryPath = std::string();
-
-	auto repositoryPath = MakeUniqueGitBuffer(git_buf{ 0 });
-	auto result = git_repository_discover(
-		&repositoryPath.get(),
-		path.c_str(),
-		true /*across_fs*/,
-		nullptr /*ceiling_dirs*/);
-
-	if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetRefStatus.FailedToDiscoverRepository", Severity::Warning)
-			<< R"(Failed to open repository. { "path: ")" << path
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	status.RepositoryPath = std::string(repositoryPath.get().ptr, repositoryPath.get().size);
-	return true;
-}
-
-bool Git::GetWorkingDirectory(Git::Status& status, UniqueGitRepository& repository)
-{
-	status.WorkingDirectory = std::string();
-
-	auto path = git_repository_workdir(repository.get());
-	if (path == NULL)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetWorkingDirectory.FailedToFindWorkingDirectory", Severity::Warning)
-			<< R"(Failed to find working directory for repository. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	status.WorkingDirectory = std::string(path);
-	return true;
-}
-
-bool Git::GetRepositoryState(Git::Status& status, UniqueGitRepository& repository)
-{
-	status.State = std::string();
-
-	auto state = git_repository_state(repository.get());
-	switch (state)
-	{
-	default:
-		Log("Git.GetRepositoryState.UnknownResult", Severity::Error)
-			<< R"(Encountered unknown repository state. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "state": ")" << state << R"(" })";
-		return false;
-	case GIT_REPOSITORY_STATE_NONE:
-		if (git_repository_head_detached(repository.get()))
-			status.State = std::string("DETACHED");
-		return true;
-	case GIT_REPOSITORY_STATE_MERGE:
-		status.State = std::string("MERGING");
-		return true;
-	case GIT_REPOSITORY_STATE_REVERT:
-		status.State = std::string("REVERTING");
-		return true;
-	case GIT_REPOSITORY_STATE_CHERRYPICK:
-		status.State = std::string("CHERRY-PICKING");
-		return true;
-	case GIT_REPOSITORY_STATE_BISECT:
-		status.State = std::string("BISECTING");
-		return true;
-	case GIT_REPOSITORY_STATE_REBASE:
-		status.State = std::string("REBASE");
-		return true;
-	case GIT_REPOSITORY_STATE_REBASE_INTERACTIVE:
-		status.State = std::string("REBASE-i");
-		return true;
-	case GIT_REPOSITORY_STATE_REBASE_MERGE:
-		status.State = std::string("REBASE-m");
-		return true;
-	case GIT_REPOSITORY_STATE_APPLY_MAILBOX:
-		status.State = std::string("AM");
-		return true;
-	case GIT_REPOSITORY_STATE_APPLY_MAILBOX_OR_REBASE:
-		status.State = std::string("AM/REBASE");
-		return true;
-	}
-}
-
-bool Git::SetBranchToCurrentCommit(Git::Status& status)
-{
-	auto path = boost::filesystem::path(ConvertToUnicode(status.RepositoryPath));
-	path.append(L"HEAD");
-	auto commit = ReadFirstLineInFile(path);
-
-	if (!commit.empty())
-	{
-		status.Branch = commit.substr(0, 7);
-		return true;
-	}
-
-	return false;
-}
-
-bool Git::SetBranchFromHeadName(Git::Status& status, const boost::filesystem::path& path)
-{
-	auto headName = ReadFirstLineInFile(path);
-	const auto patternToStrip = std::string("refs/heads/");
-	if (headName.size() > patternToStrip.size() && headName.find(patternToStrip) == 0)
-	{
-		status.Branch = headName.substr(patternToStrip.size());
-		return true;
-	}
-
-	return false;
-}
-
-bool Git::SetBranchFromRebaseApplyHeadName(Git::Status& status)
-{
-	auto path = boost::filesystem::path(ConvertToUnicode(status.RepositoryPath));
-	path.append(L"rebase-apply/head-name");
-	return SetBranchFromHeadName(status, path);
-}
-
-bool Git::SetBranchFromRebaseMergeHeadName(Git::Status& status)
-{
-	auto path = boost::filesystem::path(ConvertToUnicode(status.RepositoryPath));
-	path.append(L"rebase-merge/head-name");
-	return SetBranchFromHeadName(status, path);
-}
-
-bool Git::GetRefStatus(Git::Status& status, UniqueGitRepository& repository)
-{
-	status.Branch = std::string();
-	status.Upstream = std::string();
-	status.UpstreamGone = false;
-	status.AheadBy = 0;
-	status.BehindBy = 0;
-
-	auto head = MakeUniqueGitReference(nullptr);
-	auto result = git_repository_head(&head.get(), repository.get());
-	if (result == GIT_EUNBORNBRANCH)
-	{
-		Log("Git.GetRefStatus.UnbornBranch", Severity::Verbose)
-			<< R"(Current branch is unborn. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
-		status.Branch = std::string("UNBORN");
-		return true;
-	}
-	else if (result == GIT_ENOTFOUND)
-	{
-		Log("Git.GetRefStatus.HeadMissing", Severity::Warning)
-			<< R"(HEAD is missing. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
-		return false;
-	}
-	else if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetRefStatus.FailedToFindHead", Severity::Error)
-			<< R"(Failed to find HEAD. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	status.Branch = std::string(git_reference_shorthand(head.get()));
-	if (status.Branch == "HEAD")
-	{
-		if (status.State == "DETACHED")
-		{
-			SetBranchToCurrentCommit(status);
-		}
-		else
-		{
-			if (!SetBranchFromRebaseApplyHeadName(status))
-				SetBranchFromRebaseMergeHeadName(status);
-		}
-
-		return true;
-	}
-
-	auto upstream = MakeUniqueGitReference(nullptr);
-	result = git_branch_upstream(&upstream.get(), head.get());
-	if (result == GIT_ENOTFOUND)
-	{
-		auto upstreamBranchName = git_buf{ 0 };
-		auto upstreamBranchResult = git_branch_upstream_name(
-			&upstreamBranchName,
-			git_reference_owner(head.get()),
-			git_reference_name(head.get()));
-
-		auto canBuildUpstream = false;
-		if (upstreamBranchResult == GIT_OK)
-		{
-			Log("Git.GetRefStatus.UpstreamGone", Severity::Spam)
-				<< R"(Branch has a configured upstream that is gone. { "repositoryPath": ")" << status.RepositoryPath
-				<< R"(", "localBranch": ")" << status.Branch << R"(" })";
-			status.UpstreamGone = true;
-			canBuildUpstream = upstreamBranchName.ptr != nullptr && upstreamBranchName.size != 0;
-		}
-
-		if (canBuildUpstream)
-		{
-			const auto patternToRemove = std::string("refs/remotes/");
-			auto upstreamName = std::string(upstreamBranchName.ptr);
-			auto patternPosition = upstreamName.find(patternToRemove);
-			if (patternPosition == 0 && upstreamName.size() > patternToRemove.size())
-			{
-				upstreamName.erase(patternPosition, patternToRemove.size());
-			}
-			status.Upstream = upstreamName;
-		}
-		else
-		{
-			Log("Git.GetRefStatus.NoUpstream", Severity::Spam)
-				<< R"(Branch does not have a remote tracking reference. { "repositoryPath": ")" << status.RepositoryPath
-				<< R"(", "localBranch": ")" << status.Branch << R"(" })";
-		}
-
-		return true;
-	}
-	else if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetRefStatus.FailedToFindUpstream", Severity::Error)
-			<< R"(Failed to find remote tracking reference. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "localBranch": ")" << status.Branch
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	status.Upstream = std::string(git_reference_shorthand(upstream.get()));
-
-	auto localTarget = git_reference_target(head.get());
-	if (localTarget == nullptr)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetRefStatus.FailedToRetrieveLocalBranchGitReferenceTarget", Severity::Error)
-			<< R"(Failed to retrieve git_oid for local target. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "localBranch": ")" << status.Branch
-			<< R"(", "upstreamBranch": ")" << status.Upstream
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	auto upstreamTarget = git_reference_target(upstream.get());
-	if (upstreamTarget == nullptr)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetRefStatus.FailedToRetrieveRemoteBranchGitReferenceTarget", Severity::Error)
-			<< R"(Failed to retrieve git_oid for upstream target. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "localBranch": ")" << status.Branch
-			<< R"(", "upstreamBranch": ")" << status.Upstream
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	size_t aheadBy, behindBy;
-	result = git_graph_ahead_behind(&aheadBy, &behindBy, repository.get(), localTarget, upstreamTarget);
-	if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetRefStatus.FailedToRetrieveAheadBehind", Severity::Error)
-			<< R"(Failed to retrieve ahead/behind information. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "localBranch": ")" << status.Branch
-			<< R"(", "upstreamBranch": ")" << status.Upstream
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	status.AheadBy = aheadBy;
-	status.BehindBy = behindBy;
-	return true;
-}
-
-bool Git::GetFileStatus(Git::Status& status, UniqueGitRepository& repository)
-{
-	git_status_options statusOptions = GIT_STATUS_OPTIONS_INIT;
-	statusOptions.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
-	statusOptions.flags =
-		GIT_STATUS_OPT_INCLUDE_UNTRACKED
-		| GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX
-		| GIT_STATUS_OPT_SORT_CASE_SENSITIVELY
-		| GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
-
-	auto statusList = MakeUniqueGitStatusList(nullptr);
-	auto result = git_status_list_new(&statusList.get(), repository.get(), &statusOptions);
-	if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetGitStatus.FailedToCreateStatusList", Severity::Error)
-			<< R"(Failed to create status list. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	for (auto i = size_t{ 0 }; i < git_status_list_entrycount(statusList.get()); ++i)
-	{
-		auto entry = git_status_byindex(statusList.get(), i);
-
-		static const auto indexFlags =
-			GIT_STATUS_INDEX_NEW
-			| GIT_STATUS_INDEX_MODIFIED
-			| GIT_STATUS_INDEX_DELETED
-			| GIT_STATUS_INDEX_RENAMED
-			| GIT_STATUS_INDEX_TYPECHANGE;
-		if ((entry->status & indexFlags) != 0)
-		{
-			auto hasOldPath = entry->head_to_index->old_file.path != nullptr;
-			auto hasNewPath = entry->head_to_index->new_file.path != nullptr;
-			auto oldPath = hasOldPath ? entry->head_to_index->old_file.path : std::string();
-			auto newPath = hasNewPath ? entry->head_to_index->new_file.path : std::string();
-
-			std::string path;
-			if (hasOldPath && hasNewPath && oldPath == newPath)
-				path = oldPath;
-			else
-				path = hasOldPath ? oldPath : newPath;
-
-			if ((entry->status & GIT_STATUS_INDEX_NEW) == GIT_STATUS_INDEX_NEW)
-				status.IndexAdded.push_back(path);
-			if ((entry->status & GIT_STATUS_INDEX_MODIFIED) == GIT_STATUS_INDEX_MODIFIED)
-				status.IndexModified.push_back(path);
-			if ((entry->status & GIT_STATUS_INDEX_DELETED) == GIT_STATUS_INDEX_DELETED)
-				status.IndexDeleted.push_back(path);
-			if ((entry->status & GIT_STATUS_INDEX_RENAMED) == GIT_STATUS_INDEX_RENAMED)
-				status.IndexRenamed.emplace_back(std::make_pair(oldPath, newPath));
-			if ((entry->status & GIT_STATUS_INDEX_TYPECHANGE) == GIT_STATUS_INDEX_TYPECHANGE)
-				status.IndexTypeChange.push_back(path);
-		}
-
-		static const auto workingFlags =
-			GIT_STATUS_WT_NEW
-			| GIT_STATUS_WT_MODIFIED
-			| GIT_STATUS_WT_DELETED
-			| GIT_STATUS_WT_TYPECHANGE
-			| GIT_STATUS_WT_RENAMED
-			| GIT_STATUS_WT_UNREADABLE;
-		if ((entry->status & workingFlags) != 0)
-		{
-			auto hasOldPath = entry->index_to_workdir->old_file.path != nullptr;
-			auto hasNewPath = entry->index_to_workdir->new_file.path != nullptr;
-			auto oldPath = hasOldPath ? entry->index_to_workdir->old_file.path : std::string();
-			auto newPath = hasNewPath ? entry->index_to_workdir->new_file.path : std::string();
-
-			std::string path;
-			if (hasOldPath && hasNewPath && oldPath == newPath)
-				path = oldPath;
-			else
-				path = hasOldPath ? oldPath : newPath;
-
-			if ((entry->status & GIT_STATUS_WT_NEW) == GIT_STATUS_WT_NEW)
-				status.WorkingAdded.push_back(path);
-			if ((entry->status & GIT_STATUS_WT_MODIFIED) == GIT_STATUS_WT_MODIFIED)
-				status.WorkingModified.push_back(path);
-			if ((entry->status & GIT_STATUS_WT_DELETED) == GIT_STATUS_WT_DELETED)
-				status.WorkingDeleted.push_back(path);
-			if ((entry->status & GIT_STATUS_WT_TYPECHANGE) == GIT_STATUS_WT_TYPECHANGE)
-				status.WorkingTypeChange.push_back(path);
-			if ((entry->status & GIT_STATUS_WT_RENAMED) == GIT_STATUS_WT_RENAMED)
-				status.WorkingRenamed.emplace_back(std::make_pair(oldPath, newPath));
-			if ((entry->status & GIT_STATUS_WT_UNREADABLE) == GIT_STATUS_WT_UNREADABLE)
-				status.WorkingUnreadable.push_back(path);
-		}
-
-		static const auto conflictIgnoreFlags = GIT_STATUS_IGNORED | GIT_STATUS_CONFLICTED;
-		if ((entry->status & conflictIgnoreFlags) != 0)
-		{
-			// libgit2 reports a subset of conflicts as two separate status entries with identical paths.
-			// One entry contains index_to_workdir and the other contains head_to_index.
-			auto hasOldPath = false;
-			auto hasNewPath = false;
-			auto oldPath = std::string();
-			auto newPath = std::string();
-			if (entry->index_to_workdir != nullptr)
-			{
-				hasOldPath = entry->index_to_workdir->old_file.path != nullptr;
-				hasNewPath = entry->index_to_workdir->new_file.path != nullptr;
-				oldPath = hasOldPath ? entry->index_to_workdir->old_file.path : std::string();
-				newPath = hasNewPath ? entry->index_to_workdir->new_file.path : std::string();
-			}
-			else if (entry->head_to_index != nullptr)
-			{
-				hasOldPath = entry->head_to_index->old_file.path != nullptr;
-				hasNewPath = entry->head_to_index->new_file.path != nullptr;
-				oldPath = hasOldPath ? entry->head_to_index->old_file.path : std::string();
-				newPath = hasNewPath ? entry->head_to_index->new_file.path : std::string();
-			}
-
-			std::string path;
-			if (hasOldPath && hasNewPath && oldPath == newPath)
-				path = oldPath;
-			else
-				path = hasOldPath ? oldPath : newPath;
-
-			if ((entry->status & GIT_STATUS_IGNORED) == GIT_STATUS_IGNORED)
-			{
-				if (std::find(status.Ignored.begin(), status.Ignored.end(), path) == status.Ignored.end())
-					status.Ignored.push_back(path);
-			}
-			if ((entry->status & GIT_STATUS_CONFLICTED) == GIT_STATUS_CONFLICTED)
-			{
-				if (std::find(status.Conflicted.begin(), status.Conflicted.end(), path) == status.Conflicted.end())
-					status.Conflicted.push_back(path);
-			}
-		}
-	}
-
-	return true;
-}
-
-bool Git::GetStashList(Status& status, UniqueGitRepository& repository)
-{
-	std::vector<Stash> stashes;
-	auto result = git_stash_foreach(
-		repository.get(),
-		[](size_t index, const char* message, const git_oid *stash_id, void *payload)
-		{
-			if (payload == nullptr)
-				return -1;
-
-			char hashBuffer[40] = { 0 };
-			Stash stash;
-			stash.Sha1Id = std::string(git_oid_tostr(hashBuffer, _countof(hashBuffer), stash_id));
-			stash.Index = index;
-			stash.Message = std::string(message);
-
-			auto payloadAsStashes = reinterpret_cast<std::vector<Stash>*>(payload);
-			payloadAsStashes->emplace_back(std::move(stash));
-			return 0;
-		},
-		&stashes);
-
-	if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetStashList.FailedToRetrieveStashList", Severity::Error)
-			<< R"(Failed to retrieve stash list. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return false;
-	}
-
-	status.Stashes = std::move(stashes);
-	return true;
-}
-
-std::tuple<bool, std::string> Git::DiscoverRepository(const std::string& path)
-{
-	Git::Status status;
-	return Git::DiscoverRepository(status, path)
-		? std::make_tuple(true, std::move(status.RepositoryPath))
-		: std::make_tuple(false, std::string());
-}
-
-std::tuple<bool, Git::Status> Git::GetStatus(const std::string& path)
-{
-	Git::Status status;
-	if (!Git::DiscoverRepository(status, path))
-	{
-		return std::make_tuple(false, Git::Status());
-	}
-
-	auto repository = MakeUniqueGitRepository(nullptr);
-	auto result = git_repository_open_ext(
-		&repository.get(),
-		status.RepositoryPath.c_str(),
-		GIT_REPOSITORY_OPEN_NO_SEARCH,
-		nullptr);
-
-	if (result != GIT_OK)
-	{
-		auto lastError = giterr_last();
-		Log("Git.GetGitStatus.FailedToOpenRepository", Severity::Error)
-			<< R"(Failed to open repository. { "repositoryPath": ")" << status.RepositoryPath
-			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
-			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
-		return std::make_tuple(false, Git::Status());
-	}
-
-	if (git_repository_is_bare(repository.get()))
-	{
-		Log("Git.GetGitStatus.BareRepository", Severity::Warning)
-			<< R"(Aborting due to bare repository. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
-		return std::make_tuple(false, Git::Status());
-	}
-
-	Git::GetWorkingDirectory(status, repository);
-	Git::GetRepositoryState(status, repository);
-	Git::GetRefStatus(status, repository);
-	Git::GetStashList(status, repository);
-	if (!Git::GetFileStatus(status, repository))
-		return std::make_tuple(false, Git::Status());
-
-	return std::make_tuple(true, std::move(status));
-}
+#include "stdafx.h"
+#include "Git.h"
+#include "StringConverters.h"
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <iostream>
+#include <fstream>
+
+std::string ReadFirstLineInFile(const boost::filesystem::path& path)
+{
+	if (!boost::filesystem::exists(path))
+		return std::string();
+
+	auto fileStream = std::ifstream(path.c_str());
+	if (!fileStream.good())
+		return std::string();
+
+	std::string firstLine;
+	std::getline(fileStream, firstLine);
+	return firstLine;
+}
+
+std::string ConvertOidToString(const git_oid* oid)
+{
+	char hashBuffer[GIT_OID_HEXSZ + 1] = { 0 };
+	return std::string(git_oid_tostr(hashBuffer, _countof(hashBuffer), oid));
+}
+
+std::string ConvertErrorCodeToString(git_error_code errorCode)
+{
+	switch (errorCode)
+	{
+	default:
+		return "Unknown";
+	case GIT_OK:
+		return "Success";
+	case GIT_ERROR:
+		return "Generic Error";
+	case GIT_ENOTFOUND:
+		return "Requested object could not be found";
+	case GIT_EEXISTS:
+		return "Object exists preventing operation";
+	case GIT_EAMBIGUOUS:
+		return "More than one object matches";
+	case GIT_EBUFS:
+		return "Output buffer too short";
+	case GIT_EUSER:
+		return "User generated error";
+	case GIT_EBAREREPO:
+		return "Operation not allowed on bare repository";
+	case GIT_EUNBORNBRANCH:
+		return "HEAD refers to branch with no commits";
+	case GIT_EUNMERGED:
+		return "Merge in progress prevented operation";
+	case GIT_ENONFASTFORWARD:
+		return "Reference not fast-forwardable";
+	case GIT_EINVALIDSPEC:
+		return "Invalid name/ref spec";
+	case GIT_ECONFLICT:
+		return "Checkout conflicts prevented operation";
+	case GIT_ELOCKED:
+		return "Lock file prevented operation";
+	case GIT_EMODIFIED:
+		return "Reference value does not match expected";
+	case GIT_EAUTH:
+		return "Authentication error";
+	case GIT_ECERTIFICATE:
+		return "Invalid certificate";
+	case GIT_EAPPLIED:
+		return "Patch or merge already applied";
+	case GIT_EPEEL:
+		return "Peel operation is not possible";
+	case GIT_EEOF:
+		return "Unexpected end of file";
+	case GIT_EINVALID:
+		return "Invalid operation or input";
+	case GIT_EUNCOMMITTED:
+		return "Prevented due to uncommitted changes";
+	case GIT_PASSTHROUGH:
+		return "Passthrough";
+	case GIT_ITEROVER:
+		return "Iteration complete";
+	}
+}
+
+template <typename T>
+void AppendVector(std::vector<T>& values, std::vector<T>&& valuesToAppend)
+{
+	std::move(valuesToAppend.begin(), valuesToAppend.end(), std::back_inserter(values));
+}
+
+template <typename T>
+void SortVector(std::vector<T>& values)
+{
+	std::sort(values.begin(), values.end());
+}
+
+template <typename T>
+void SortAndRemoveDuplicates(std::vector<T>& values)
+{
+	std::sort(values.begin(), values.end());
+	values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+uint32_t GetParallelStatusThreadCount(const GitSettings& settings)
+{
+	if (!settings.EnableParallelStatus)
+		return 1;
+	if (settings.ParallelStatusThreads != 0)
+		return settings.ParallelStatusThreads;
+	return (std::max)(std::thread::hardware_concurrency(), 1u);
+}
+
+Git::Git()
+	: Git(GitSettings())
+{
+}
+
+Git::Git(const GitSettings& settings)
+	: m_settings(settings)
+	, m_repositoryPool(settings.EnableParallelStatus ? GetParallelStatusThreadCount(settings) + 1 : 1)
+{
+	git_libgit2_init();
+
+	if (settings.EnableIndexRefresh)
+	{
+		auto threadCount = settings.ParallelStatusThreads != 0
+			? settings.ParallelStatusThreads
+			: (std::max)(std::thread::hardware_concurrency(), 1u);
+		m_indexRefresher = std::make_unique<IndexRefresher>(threadCount);
+	}
+}
+
+Git::~Git()
+{
+	m_indexRefresher.reset();
+	m_repositoryPool.Clear();
+	git_libgit2_shutdown();
+}
+
+bool Git::DiscoverRepository(Git::Status& status, const std::string& path)
+{
+	status.RepositoryPath = std::string();
+
+	auto repositoryPath = MakeUniqueGitBuffer(git_buf{ 0 });
+	auto result = git_repository_discover(
+		&repositoryPath.get(),
+		path.c_str(),
+		true /*across_fs*/,
+		nullptr /*ceiling_dirs*/);
+
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetRefStatus.FailedToDiscoverRepository", Severity::Warning)
+			<< R"(Failed to open repository. { "path: ")" << path
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	status.RepositoryPath = std::string(repositoryPath.get().ptr, repositoryPath.get().size);
+	return true;
+}
+
+bool Git::GetWorkingDirectory(Git::Status& status, UniqueGitRepository& repository)
+{
+	status.WorkingDirectory = std::string();
+
+	auto path = git_repository_workdir(repository.get());
+	if (path == NULL)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetWorkingDirectory.FailedToFindWorkingDirectory", Severity::Warning)
+			<< R"(Failed to find working directory for repository. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	status.WorkingDirectory = std::string(path);
+	return true;
+}
+
+bool Git::GetCommonDirectory(Git::Status& status, UniqueGitRepository& repository)
+{
+	status.CommonDirectory = status.RepositoryPath;
+
+	auto path = git_repository_commondir(repository.get());
+	if (path == NULL)
+	{
+		Log("Git.GetCommonDirectory.FailedToFindCommonDirectory", Severity::Warning)
+			<< R"(Failed to find common directory for repository. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+		return false;
+	}
+
+	status.CommonDirectory = std::string(path);
+	return true;
+}
+
+bool Git::GetRepositoryState(Git::Status& status, UniqueGitRepository& repository)
+{
+	status.State = std::string();
+
+	auto state = git_repository_state(repository.get());
+	switch (state)
+	{
+	default:
+		Log("Git.GetRepositoryState.UnknownResult", Severity::Error)
+			<< R"(Encountered unknown repository state. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "state": ")" << state << R"(" })";
+		return false;
+	case GIT_REPOSITORY_STATE_NONE:
+		if (git_repository_head_detached(repository.get()))
+			status.State = std::string("DETACHED");
+		return true;
+	case GIT_REPOSITORY_STATE_MERGE:
+		status.State = std::string("MERGING");
+		return true;
+	case GIT_REPOSITORY_STATE_REVERT:
+		status.State = std::string("REVERTING");
+		return true;
+	case GIT_REPOSITORY_STATE_CHERRYPICK:
+		status.State = std::string("CHERRY-PICKING");
+		return true;
+	case GIT_REPOSITORY_STATE_BISECT:
+		status.State = std::string("BISECTING");
+		return true;
+	case GIT_REPOSITORY_STATE_REBASE:
+		status.State = std::string("REBASE");
+		return true;
+	case GIT_REPOSITORY_STATE_REBASE_INTERACTIVE:
+		status.State = std::string("REBASE-i");
+		return true;
+	case GIT_REPOSITORY_STATE_REBASE_MERGE:
+		status.State = std::string("REBASE-m");
+		return true;
+	case GIT_REPOSITORY_STATE_APPLY_MAILBOX:
+		status.State = std::string("AM");
+		return true;
+	case GIT_REPOSITORY_STATE_APPLY_MAILBOX_OR_REBASE:
+		status.State = std::string("AM/REBASE");
+		return true;
+	}
+}
+
+bool Git::SetBranchToCurrentCommit(Git::Status& status)
+{
+	auto path = boost::filesystem::path(ConvertToUnicode(status.RepositoryPath));
+	path.append(L"HEAD");
+	auto commit = ReadFirstLineInFile(path);
+
+	if (!commit.empty())
+	{
+		status.Branch = commit.substr(0, 7);
+		return true;
+	}
+
+	return false;
+}
+
+bool Git::SetBranchFromHeadName(Git::Status& status, const boost::filesystem::path& path)
+{
+	auto headName = ReadFirstLineInFile(path);
+	const auto patternToStrip = std::string("refs/heads/");
+	if (headName.size() > patternToStrip.size() && headName.find(patternToStrip) == 0)
+	{
+		status.Branch = headName.substr(patternToStrip.size());
+		return true;
+	}
+
+	return false;
+}
+
+bool Git::SetBranchFromRebaseApplyHeadName(Git::Status& status)
+{
+	auto path = boost::filesystem::path(ConvertToUnicode(status.RepositoryPath));
+	path.append(L"rebase-apply/head-name");
+	return SetBranchFromHeadName(status, path);
+}
+
+bool Git::SetBranchFromRebaseMergeHeadName(Git::Status& status)
+{
+	auto path = boost::filesystem::path(ConvertToUnicode(status.RepositoryPath));
+	path.append(L"rebase-merge/head-name");
+	return SetBranchFromHeadName(status, path);
+}
+
+bool Git::GetRefStatus(Git::Status& status, UniqueGitRepository& repository, bool includeAheadBehind)
+{
+	status.Branch = std::string();
+	status.HeadSha1Id = std::string();
+	status.Upstream = std::string();
+	status.UpstreamGone = false;
+	status.AheadBy = 0;
+	status.BehindBy = 0;
+
+	std::string headName;
+	git_oid localTarget;
+	if (!m_refResolver.ReadHead(status.RepositoryPath, headName, localTarget))
+	{
+		Log("Git.GetRefStatus.HeadMissing", Severity::Warning)
+			<< R"(HEAD is missing. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+		return false;
+	}
+
+	if (headName.empty())
+	{
+		status.Branch = std::string("HEAD");
+		status.HeadSha1Id = ConvertOidToString(&localTarget);
+		if (status.State == "DETACHED")
+		{
+			SetBranchToCurrentCommit(status);
+		}
+		else
+		{
+			if (!SetBranchFromRebaseApplyHeadName(status))
+				SetBranchFromRebaseMergeHeadName(status);
+		}
+
+		return true;
+	}
+
+	if (!m_refResolver.ResolveReference(status.RepositoryPath, status.CommonDirectory, headName, localTarget))
+	{
+		Log("Git.GetRefStatus.UnbornBranch", Severity::Verbose)
+			<< R"(Current branch is unborn. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+		status.Branch = std::string("UNBORN");
+		return true;
+	}
+
+	status.Branch = RefResolver::GetShorthand(headName);
+	status.HeadSha1Id = ConvertOidToString(&localTarget);
+
+	auto upstreamBranchName = MakeUniqueGitBuffer(git_buf{ 0 });
+	auto result = git_branch_upstream_name(&upstreamBranchName.get(), repository.get(), headName.c_str());
+	if (result == GIT_ENOTFOUND)
+	{
+		Log("Git.GetRefStatus.NoUpstream", Severity::Spam)
+			<< R"(Branch does not have a remote tracking reference. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "localBranch": ")" << status.Branch << R"(" })";
+		return true;
+	}
+	else if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetRefStatus.FailedToFindUpstream", Severity::Error)
+			<< R"(Failed to find remote tracking reference. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "localBranch": ")" << status.Branch
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	auto upstreamName = upstreamBranchName.get().ptr != nullptr
+		? std::string(upstreamBranchName.get().ptr, upstreamBranchName.get().size)
+		: std::string();
+	if (upstreamName.empty())
+	{
+		Log("Git.GetRefStatus.NoUpstream", Severity::Spam)
+			<< R"(Branch does not have a remote tracking reference. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "localBranch": ")" << status.Branch << R"(" })";
+		return true;
+	}
+
+	git_oid upstreamTarget;
+	if (!m_refResolver.ResolveReference(status.RepositoryPath, status.CommonDirectory, upstreamName, upstreamTarget))
+	{
+		Log("Git.GetRefStatus.UpstreamGone", Severity::Spam)
+			<< R"(Branch has a configured upstream that is gone. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "localBranch": ")" << status.Branch << R"(" })";
+		status.UpstreamGone = true;
+
+		const auto patternToRemove = std::string("refs/remotes/");
+		auto patternPosition = upstreamName.find(patternToRemove);
+		if (patternPosition == 0 && upstreamName.size() > patternToRemove.size())
+		{
+			upstreamName.erase(patternPosition, patternToRemove.size());
+		}
+		status.Upstream = upstreamName;
+		return true;
+	}
+
+	status.Upstream = RefResolver::GetShorthand(upstreamName);
+	if (!includeAheadBehind)
+		return true;
+
+	// Worktrees share history, so incremental walks are tracked per common directory.
+	size_t aheadBy, behindBy;
+	result = m_aheadBehindCache.GetAheadBehind(aheadBy, behindBy, status.CommonDirectory, repository.get(), &localTarget, &upstreamTarget);
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetRefStatus.FailedToRetrieveAheadBehind", Severity::Error)
+			<< R"(Failed to retrieve ahead/behind information. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "localBranch": ")" << status.Branch
+			<< R"(", "upstreamBranch": ")" << status.Upstream
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	status.AheadBy = aheadBy;
+	status.BehindBy = behindBy;
+	return true;
+}
+
+bool Git::GetFileStatus(
+	Git::Status& status,
+	FileStatus::Lists& files,
+	UniqueGitRepository& repository,
+	const std::vector<std::string>& pathspec,
+	git_status_show_t show,
+	bool includeUntracked)
+{
+	git_status_options statusOptions = GIT_STATUS_OPTIONS_INIT;
+	statusOptions.show = show;
+	statusOptions.flags =
+		GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX
+		| GIT_STATUS_OPT_SORT_CASE_SENSITIVELY
+		| GIT_STATUS_OPT_EXCLUDE_SUBMODULES
+		| GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+	if (includeUntracked)
+		statusOptions.flags |= GIT_STATUS_OPT_INCLUDE_UNTRACKED;
+
+	std::vector<char*> pathspecStrings;
+	for (const auto& path : pathspec)
+		pathspecStrings.push_back(const_cast<char*>(path.c_str()));
+	statusOptions.pathspec.strings = pathspecStrings.data();
+	statusOptions.pathspec.count = pathspecStrings.size();
+
+	auto statusList = MakeUniqueGitStatusList(nullptr);
+	auto result = git_status_list_new(&statusList.get(), repository.get(), &statusOptions);
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetGitStatus.FailedToCreateStatusList", Severity::Error)
+			<< R"(Failed to create status list. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	std::unordered_set<std::string> ignoredPaths(files.Ignored.begin(), files.Ignored.end());
+	std::unordered_set<std::string> conflictedPaths(files.Conflicted.begin(), files.Conflicted.end());
+	for (auto i = size_t{ 0 }; i < git_status_list_entrycount(statusList.get()); ++i)
+	{
+		auto entry = git_status_byindex(statusList.get(), i);
+
+		static const auto indexFlags =
+			GIT_STATUS_INDEX_NEW
+			| GIT_STATUS_INDEX_MODIFIED
+			| GIT_STATUS_INDEX_DELETED
+			| GIT_STATUS_INDEX_RENAMED
+			| GIT_STATUS_INDEX_TYPECHANGE;
+		if ((entry->status & indexFlags) != 0)
+		{
+			auto hasOldPath = entry->head_to_index->old_file.path != nullptr;
+			auto hasNewPath = entry->head_to_index->new_file.path != nullptr;
+			auto oldPath = hasOldPath ? entry->head_to_index->old_file.path : std::string();
+			auto newPath = hasNewPath ? entry->head_to_index->new_file.path : std::string();
+
+			std::string path;
+			if (hasOldPath && hasNewPath && oldPath == newPath)
+				path = oldPath;
+			else
+				path = hasOldPath ? oldPath : newPath;
+
+			if ((entry->status & GIT_STATUS_INDEX_NEW) == GIT_STATUS_INDEX_NEW)
+				files.IndexAdded.push_back(path);
+			if ((entry->status & GIT_STATUS_INDEX_MODIFIED) == GIT_STATUS_INDEX_MODIFIED)
+				files.IndexModified.push_back(path);
+			if ((entry->status & GIT_STATUS_INDEX_DELETED) == GIT_STATUS_INDEX_DELETED)
+				files.IndexDeleted.push_back(path);
+			if ((entry->status & GIT_STATUS_INDEX_RENAMED) == GIT_STATUS_INDEX_RENAMED)
+				files.IndexRenamed.emplace_back(std::make_pair(oldPath, newPath));
+			if ((entry->status & GIT_STATUS_INDEX_TYPECHANGE) == GIT_STATUS_INDEX_TYPECHANGE)
+				files.IndexTypeChange.push_back(path);
+		}
+
+		static const auto workingFlags =
+			GIT_STATUS_WT_NEW
+			| GIT_STATUS_WT_MODIFIED
+			| GIT_STATUS_WT_DELETED
+			| GIT_STATUS_WT_TYPECHANGE
+			| GIT_STATUS_WT_RENAMED
+			| GIT_STATUS_WT_UNREADABLE;
+		if ((entry->status & workingFlags) != 0)
+		{
+			auto hasOldPath = entry->index_to_workdir->old_file.path != nullptr;
+			auto hasNewPath = entry->index_to_workdir->new_file.path != nullptr;
+			auto oldPath = hasOldPath ? entry->index_to_workdir->old_file.path : std::string();
+			auto newPath = hasNewPath ? entry->index_to_workdir->new_file.path : std::string();
+
+			std::string path;
+			if (hasOldPath && hasNewPath && oldPath == newPath)
+				path = oldPath;
+			else
+				path = hasOldPath ? oldPath : newPath;
+
+			if ((entry->status & GIT_STATUS_WT_NEW) == GIT_STATUS_WT_NEW)
+				files.WorkingAdded.push_back(path);
+			if ((entry->status & GIT_STATUS_WT_MODIFIED) == GIT_STATUS_WT_MODIFIED)
+				files.WorkingModified.push_back(path);
+			if ((entry->status & GIT_STATUS_WT_DELETED) == GIT_STATUS_WT_DELETED)
+				files.WorkingDeleted.push_back(path);
+			if ((entry->status & GIT_STATUS_WT_TYPECHANGE) == GIT_STATUS_WT_TYPECHANGE)
+				files.WorkingTypeChange.push_back(path);
+			if ((entry->status & GIT_STATUS_WT_RENAMED) == GIT_STATUS_WT_RENAMED)
+				files.WorkingRenamed.emplace_back(std::make_pair(oldPath, newPath));
+			if ((entry->status & GIT_STATUS_WT_UNREADABLE) == GIT_STATUS_WT_UNREADABLE)
+				files.WorkingUnreadable.push_back(path);
+		}
+
+		static const auto conflictIgnoreFlags = GIT_STATUS_IGNORED | GIT_STATUS_CONFLICTED;
+		if ((entry->status & conflictIgnoreFlags) != 0)
+		{
+			// libgit2 reports a subset of conflicts as two separate status entries with identical paths.
+			// One entry contains index_to_workdir and the other contains head_to_index.
+			auto hasOldPath = false;
+			auto hasNewPath = false;
+			auto oldPath = std::string();
+			auto newPath = std::string();
+			if (entry->index_to_workdir != nullptr)
+			{
+				hasOldPath = entry->index_to_workdir->old_file.path != nullptr;
+				hasNewPath = entry->index_to_workdir->new_file.path != nullptr;
+				oldPath = hasOldPath ? entry->index_to_workdir->old_file.path : std::string();
+				newPath = hasNewPath ? entry->index_to_workdir->new_file.path : std::string();
+			}
+			else if (entry->head_to_index != nullptr)
+			{
+				hasOldPath = entry->head_to_index->old_file.path != nullptr;
+				hasNewPath = entry->head_to_index->new_file.path != nullptr;
+				oldPath = hasOldPath ? entry->head_to_index->old_file.path : std::string();
+				newPath = hasNewPath ? entry->head_to_index->new_file.path : std::string();
+			}
+
+			std::string path;
+			if (hasOldPath && hasNewPath && oldPath == newPath)
+				path = oldPath;
+			else
+				path = hasOldPath ? oldPath : newPath;
+
+			if (path.empty())
+				continue;
+
+			if ((entry->status & GIT_STATUS_IGNORED) == GIT_STATUS_IGNORED)
+			{
+				if (ignoredPaths.insert(path).second)
+					files.Ignored.push_back(path);
+			}
+			if ((entry->status & GIT_STATUS_CONFLICTED) == GIT_STATUS_CONFLICTED)
+			{
+				if (conflictedPaths.insert(path).second)
+					files.Conflicted.push_back(path);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Git::GetFullFileStatus(Git::Status& status, UniqueGitRepository& repository)
+{
+	FileStatus::Lists files;
+	std::vector<std::string> untrackedPaths;
+	if (m_settings.EnableUntrackedCache
+		&& m_untrackedCache.GetUntrackedPaths(untrackedPaths, status.RepositoryPath, status.WorkingDirectory, repository))
+	{
+		if (!Git::GetFullFileStatus(status, files, repository, false /*includeUntracked*/))
+			return false;
+
+		AppendVector(files.WorkingAdded, std::move(untrackedPaths));
+		std::sort(files.WorkingAdded.begin(), files.WorkingAdded.end());
+	}
+	else if (!Git::GetFullFileStatus(status, files, repository, true /*includeUntracked*/))
+	{
+		return false;
+	}
+
+	status.Files = FileStatus(files);
+
+	// Incremental statuses only stat dirty paths, so only full statuses pay for stale stat data.
+	if (m_indexRefresher != nullptr)
+		m_indexRefresher->ScheduleRefresh(status.RepositoryPath);
+	return true;
+}
+
+bool Git::GetFullFileStatus(Git::Status& status, FileStatus::Lists& files, UniqueGitRepository& repository, bool includeUntracked)
+{
+	auto threadCount = GetParallelStatusThreadCount(m_settings);
+	if (threadCount > 1)
+		return Git::GetFileStatusInParallel(status, files, repository, threadCount, includeUntracked);
+
+	return Git::GetFileStatus(status, files, repository, std::vector<std::string>(), GIT_STATUS_SHOW_INDEX_AND_WORKDIR, includeUntracked);
+}
+
+std::vector<std::vector<std::string>> Git::PartitionWorkingTree(
+	Git::Status& status,
+	UniqueGitRepository& repository,
+	uint32_t threadCount)
+{
+	auto index = MakeUniqueGitIndex(nullptr);
+	auto result = git_repository_index(&index.get(), repository.get());
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.PartitionWorkingTree.FailedToOpenIndex", Severity::Warning)
+			<< R"(Failed to open index. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return std::vector<std::vector<std::string>>();
+	}
+
+	auto indexEntryCount = git_index_entrycount(index.get());
+	if (indexEntryCount < m_settings.ParallelStatusMinimumIndexEntries)
+		return std::vector<std::vector<std::string>>();
+
+	// Names that differ only by case are the same subtree if the repository ignores case.
+	// Otherwise both partitions would report it.
+	auto ignoreCase = (git_index_caps(index.get()) & GIT_INDEXCAP_IGNORE_CASE) != 0;
+	auto getSubtreeKey = [ignoreCase](const std::string& name)
+	{
+		return ignoreCase ? boost::algorithm::to_lower_copy(name) : name;
+	};
+
+	std::unordered_map<std::string, std::pair<std::string, size_t>> weights;
+	for (auto i = size_t{ 0 }; i < indexEntryCount; ++i)
+	{
+		auto path = std::string(git_index_get_byindex(index.get(), i)->path);
+		auto name = path.substr(0, path.find('/'));
+		++weights.emplace(getSubtreeKey(name), std::make_pair(name, size_t{ 0 })).first->second.second;
+	}
+
+	// Untracked top-level entries aren't in the index but must still be covered by a subtree.
+	auto workingDirectory = boost::filesystem::path(ConvertToUnicode(status.WorkingDirectory));
+	auto errorCode = boost::system::error_code();
+	for (auto iterator = boost::filesystem::directory_iterator(workingDirectory, errorCode);
+		!errorCode && iterator != boost::filesystem::directory_iterator();
+		iterator.increment(errorCode))
+	{
+		auto name = ConvertToUtf8(iterator->path().filename().wstring());
+		if (name != ".git")
+			weights.emplace(getSubtreeKey(name), std::make_pair(name, size_t{ 0 }));
+	}
+
+	if (errorCode)
+	{
+		Log("Git.PartitionWorkingTree.FailedToEnumerateWorkingDirectory", Severity::Warning)
+			<< R"(Failed to enumerate working directory. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "error": ")" << errorCode.message() << R"(" })";
+		return std::vector<std::vector<std::string>>();
+	}
+
+	std::vector<std::pair<size_t, std::string>> subtrees;
+	for (auto& weight : weights)
+	{
+		// libgit2 won't match paths below a pathspec entry with wildcard characters.
+		const auto& name = weight.second.first;
+		if (name.find_first_of("*?[") != std::string::npos)
+		{
+			Log("Git.PartitionWorkingTree.WildcardInSubtree", Severity::Verbose)
+				<< R"(Top-level entry can't be matched by a pathspec. Computing status serially. { "repositoryPath": ")" << status.RepositoryPath
+				<< R"(", "name": ")" << name << R"(" })";
+			return std::vector<std::vector<std::string>>();
+		}
+		subtrees.emplace_back(std::make_pair((std::max)(weight.second.second, size_t{ 1 }), name));
+	}
+	std::sort(subtrees.begin(), subtrees.end(), std::greater<std::pair<size_t, std::string>>());
+
+	auto partitionCount = (std::min)(static_cast<size_t>(threadCount), subtrees.size());
+	std::vector<size_t> partitionWeights(partitionCount, 0);
+	std::vector<std::vector<std::string>> partitions(partitionCount);
+	for (auto& subtree : subtrees)
+	{
+		auto lightestPartition = std::min_element(partitionWeights.begin(), partitionWeights.end()) - partitionWeights.begin();
+		partitionWeights[lightestPartition] += subtree.first;
+		partitions[lightestPartition].emplace_back(std::move(subtree.second));
+	}
+
+	return partitions;
+}
+
+bool Git::GetFileStatusInParallel(Git::Status& status, FileStatus::Lists& files, UniqueGitRepository& repository, uint32_t threadCount, bool includeUntracked)
+{
+	auto partitions = Git::PartitionWorkingTree(status, repository, threadCount);
+	if (partitions.size() < 2)
+		return Git::GetFileStatus(status, files, repository, std::vector<std::string>(), GIT_STATUS_SHOW_INDEX_AND_WORKDIR, includeUntracked);
+
+	std::vector<Git::Status> partialStatuses(partitions.size());
+	std::vector<FileStatus::Lists> partialFiles(partitions.size());
+	std::unique_ptr<bool[]> partialResults(new bool[partitions.size()]());
+	auto indexResult = false;
+	std::vector<std::thread> workers;
+	{
+		// Workers must be joined even if a worker can't be started or index status throws.
+		auto joinWorkers = std::experimental::scope_guard([&workers]()
+		{
+			for (auto& worker : workers)
+				worker.join();
+		});
+
+		for (auto i = size_t{ 0 }; i < partitions.size(); ++i)
+		{
+			workers.emplace_back([this, i, includeUntracked, &status, &partitions, &partialStatuses, &partialFiles, &partialResults]()
+			{
+				// Exceptions escaping the thread would terminate the process. Failed partitions fail
+				// the whole status instead.
+				try
+				{
+					auto& partialStatus = partialStatuses[i];
+					partialStatus.RepositoryPath = status.RepositoryPath;
+
+					auto lease = m_repositoryPool.Checkout(status.RepositoryPath);
+					auto& workerRepository = lease.Get();
+					if (!Git::OpenRepository(partialStatus, workerRepository))
+						return;
+
+					partialResults[i] = Git::GetFileStatus(partialStatus, partialFiles[i], workerRepository, partitions[i], GIT_STATUS_SHOW_WORKDIR_ONLY, includeUntracked);
+				}
+				catch (const std::exception& exception)
+				{
+					Log("Git.GetFileStatusInParallel.WorkerFailed", Severity::Error)
+						<< R"(Failed to compute status for partition. { "repositoryPath": ")" << status.RepositoryPath
+						<< R"(", "exception": ")" << exception.what() << R"(" })";
+					partialResults[i] = false;
+				}
+			});
+		}
+
+		// Index to HEAD comparison doesn't walk the working tree. Computing it for the whole
+		// repository keeps rename detection across subtrees intact.
+		indexResult = Git::GetFileStatus(status, files, repository, std::vector<std::string>(), GIT_STATUS_SHOW_INDEX_ONLY);
+	}
+
+	if (!indexResult)
+		return false;
+
+	for (auto i = size_t{ 0 }; i < partitions.size(); ++i)
+	{
+		if (!partialResults[i])
+			return false;
+		Git::AppendFileStatus(files, std::move(partialFiles[i]));
+	}
+
+	Git::SortFileStatus(files);
+
+	Log("Git.GetFileStatusInParallel", Severity::Verbose)
+		<< R"(Computed working tree status in parallel. { "repositoryPath": ")" << status.RepositoryPath
+		<< R"(", "threads": )" << partitions.size() << R"( })";
+	return true;
+}
+
+bool Git::GetStashList(Status& status, UniqueGitRepository& repository)
+{
+	CachedStashList stashList;
+	auto result = git_reference_name_to_id(&stashList.StashId, repository.get(), "refs/stash");
+	if (result == GIT_ENOTFOUND)
+	{
+		status.Stashes.clear();
+		return true;
+	}
+	else if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetStashList.FailedToResolveStashReference", Severity::Error)
+			<< R"(Failed to resolve stash reference. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	// Stashes are shared by all worktrees, so the list is cached per common directory.
+	auto reflogPath = boost::filesystem::path(ConvertToUnicode(status.CommonDirectory));
+	reflogPath.append(L"logs/refs/stash");
+	boost::system::error_code errorCode;
+	auto reflogSize = boost::filesystem::file_size(reflogPath, errorCode);
+	stashList.ReflogSize = errorCode ? 0 : reflogSize;
+	auto reflogLastWriteTime = boost::filesystem::last_write_time(reflogPath, errorCode);
+	stashList.ReflogLastWriteTime = errorCode ? 0 : reflogLastWriteTime;
+
+	{
+		ReadLock readLock(m_stashListCacheMutex);
+		auto cachedStashList = m_stashListCache.find(status.CommonDirectory);
+		if (cachedStashList != m_stashListCache.end()
+			&& git_oid_equal(&cachedStashList->second.StashId, &stashList.StashId)
+			&& cachedStashList->second.ReflogSize == stashList.ReflogSize
+			&& cachedStashList->second.ReflogLastWriteTime == stashList.ReflogLastWriteTime)
+		{
+			status.Stashes = cachedStashList->second.Stashes;
+			return true;
+		}
+	}
+
+	if (!Git::ReadStashList(stashList.Stashes, status, repository))
+		return false;
+
+	status.Stashes = stashList.Stashes;
+	{
+		WriteLock writeLock(m_stashListCacheMutex);
+		m_stashListCache[status.CommonDirectory] = std::move(stashList);
+	}
+	return true;
+}
+
+bool Git::ReadStashList(std::vector<Stash>& stashes, Status& status, UniqueGitRepository& repository)
+{
+	stashes.clear();
+	auto result = git_stash_foreach(
+		repository.get(),
+		[](size_t index, const char* message, const git_oid *stash_id, void *payload)
+		{
+			if (payload == nullptr)
+				return -1;
+
+			char hashBuffer[40] = { 0 };
+			Stash stash;
+			stash.Sha1Id = std::string(git_oid_tostr(hashBuffer, _countof(hashBuffer), stash_id));
+			stash.Index = index;
+			stash.Message = std::string(message);
+
+			auto payloadAsStashes = reinterpret_cast<std::vector<Stash>*>(payload);
+			payloadAsStashes->emplace_back(std::move(stash));
+			return 0;
+		},
+		&stashes);
+
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetStashList.FailedToRetrieveStashList", Severity::Error)
+			<< R"(Failed to retrieve stash list. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	return true;
+}
+
+bool IsPathCoveredByPathspec(boost::string_ref path, const std::vector<std::string>& pathspec)
+{
+	// Untracked directories are reported with a trailing slash.
+	auto length = path.size();
+	if (length != 0 && path[length - 1] == '/')
+		--length;
+
+	for (const auto& pathspecEntry : pathspec)
+	{
+		if (length < pathspecEntry.size() || path.substr(0, pathspecEntry.size()) != pathspecEntry)
+			continue;
+		if (length == pathspecEntry.size() || path[pathspecEntry.size()] == '/')
+			return true;
+	}
+
+	return false;
+}
+
+void MergePaths(
+	std::vector<std::string>& paths,
+	const FileStatus::PathRange& previousPaths,
+	std::vector<std::string>&& recomputedPaths,
+	const std::vector<std::string>& pathspec)
+{
+	paths.clear();
+	for (auto path : previousPaths)
+	{
+		if (!IsPathCoveredByPathspec(path, pathspec))
+			paths.emplace_back(path.data(), path.size());
+	}
+
+	auto recomputedStart = paths.size();
+	std::move(recomputedPaths.begin(), recomputedPaths.end(), std::back_inserter(paths));
+	auto middle = paths.begin() + recomputedStart;
+	if (std::is_sorted(paths.begin(), middle) && std::is_sorted(middle, paths.end()))
+		std::inplace_merge(paths.begin(), middle, paths.end());
+	else
+		std::sort(paths.begin(), paths.end());
+}
+
+void MergeRenames(
+	std::vector<std::pair<std::string, std::string>>& renames,
+	const FileStatus::RenameRange& previousRenames,
+	std::vector<std::pair<std::string, std::string>>&& recomputedRenames,
+	const std::vector<std::string>& pathspec)
+{
+	renames.clear();
+	for (auto rename : previousRenames)
+	{
+		if (!IsPathCoveredByPathspec(rename.first, pathspec) && !IsPathCoveredByPathspec(rename.second, pathspec))
+			renames.emplace_back(rename.first.to_string(), rename.second.to_string());
+	}
+
+	std::move(recomputedRenames.begin(), recomputedRenames.end(), std::back_inserter(renames));
+	std::sort(renames.begin(), renames.end());
+}
+
+/*static*/ std::vector<std::string> Git::BuildDirtyPathspec(const Git::Status& previousStatus, const std::unordered_set<std::string>& dirtyPaths)
+{
+	std::vector<std::string> untrackedDirectories;
+	for (auto path : previousStatus.Files.GetPaths(FileStatus::WorkingAdded))
+	{
+		if (!path.empty() && path.back() == '/')
+			untrackedDirectories.emplace_back(path.data(), path.size() - 1);
+	}
+
+	// A rename is only reported if both of its sides are recomputed together.
+	std::vector<std::string> expandedPaths(dirtyPaths.begin(), dirtyPaths.end());
+	for (auto category : { FileStatus::IndexRenamed, FileStatus::WorkingRenamed })
+	{
+		for (auto rename : previousStatus.Files.GetRenames(category))
+		{
+			auto isOldPathDirty = IsPathCoveredByPathspec(rename.first, expandedPaths);
+			auto isNewPathDirty = IsPathCoveredByPathspec(rename.second, expandedPaths);
+			if (isOldPathDirty && !isNewPathDirty)
+				expandedPaths.push_back(rename.second.to_string());
+			else if (isNewPathDirty && !isOldPathDirty)
+				expandedPaths.push_back(rename.first.to_string());
+		}
+	}
+
+	std::vector<std::string> widenedPaths;
+	for (const auto& path : expandedPaths)
+	{
+		// libgit2 reports untracked directories as a single entry, so changes inside
+		// them must be recomputed for the whole directory to produce the same entry.
+		auto widenedPath = path;
+		for (const auto& untrackedDirectory : untrackedDirectories)
+		{
+			if (IsPathCoveredByPathspec(path, std::vector<std::string>{ untrackedDirectory }))
+			{
+				widenedPath = untrackedDirectory;
+				break;
+			}
+		}
+
+		// Pathspecs are matched literally, but libgit2 won't match paths below an entry with
+		// wildcard characters. Such entries are widened to a directory without them.
+		auto wildcard = widenedPath.find_first_of("*?[");
+		if (wildcard != std::string::npos)
+		{
+			auto separator = widenedPath.rfind('/', wildcard);
+			if (separator == std::string::npos)
+				return std::vector<std::string>();
+			widenedPath.resize(separator);
+		}
+
+		widenedPaths.emplace_back(std::move(widenedPath));
+	}
+
+	std::sort(widenedPaths.begin(), widenedPaths.end());
+
+	std::vector<std::string> pathspec;
+	for (const auto& path : widenedPaths)
+	{
+		if (pathspec.empty() || !IsPathCoveredByPathspec(path, std::vector<std::string>{ pathspec.back() }))
+			pathspec.push_back(path);
+	}
+
+	return pathspec;
+}
+
+/*static*/ void Git::MergeFileStatus(
+	FileStatus::Lists& files,
+	const FileStatus& previousFiles,
+	FileStatus::Lists&& recomputedFiles,
+	const std::vector<std::string>& pathspec)
+{
+	MergePaths(files.IndexAdded, previousFiles.GetPaths(FileStatus::IndexAdded), std::move(recomputedFiles.IndexAdded), pathspec);
+	MergePaths(files.IndexModified, previousFiles.GetPaths(FileStatus::IndexModified), std::move(recomputedFiles.IndexModified), pathspec);
+	MergePaths(files.IndexDeleted, previousFiles.GetPaths(FileStatus::IndexDeleted), std::move(recomputedFiles.IndexDeleted), pathspec);
+	MergePaths(files.IndexTypeChange, previousFiles.GetPaths(FileStatus::IndexTypeChange), std::move(recomputedFiles.IndexTypeChange), pathspec);
+	MergeRenames(files.IndexRenamed, previousFiles.GetRenames(FileStatus::IndexRenamed), std::move(recomputedFiles.IndexRenamed), pathspec);
+
+	MergePaths(files.WorkingAdded, previousFiles.GetPaths(FileStatus::WorkingAdded), std::move(recomputedFiles.WorkingAdded), pathspec);
+	MergePaths(files.WorkingModified, previousFiles.GetPaths(FileStatus::WorkingModified), std::move(recomputedFiles.WorkingModified), pathspec);
+	MergePaths(files.WorkingDeleted, previousFiles.GetPaths(FileStatus::WorkingDeleted), std::move(recomputedFiles.WorkingDeleted), pathspec);
+	MergePaths(files.WorkingTypeChange, previousFiles.GetPaths(FileStatus::WorkingTypeChange), std::move(recomputedFiles.WorkingTypeChange), pathspec);
+	MergePaths(files.WorkingUnreadable, previousFiles.GetPaths(FileStatus::WorkingUnreadable), std::move(recomputedFiles.WorkingUnreadable), pathspec);
+	MergeRenames(files.WorkingRenamed, previousFiles.GetRenames(FileStatus::WorkingRenamed), std::move(recomputedFiles.WorkingRenamed), pathspec);
+
+	MergePaths(files.Ignored, previousFiles.GetPaths(FileStatus::Ignored), std::move(recomputedFiles.Ignored), pathspec);
+	MergePaths(files.Conflicted, previousFiles.GetPaths(FileStatus::Conflicted), std::move(recomputedFiles.Conflicted), pathspec);
+}
+
+/*static*/ void Git::AppendFileStatus(FileStatus::Lists& files, FileStatus::Lists&& partialFiles)
+{
+	AppendVector(files.IndexAdded, std::move(partialFiles.IndexAdded));
+	AppendVector(files.IndexModified, std::move(partialFiles.IndexModified));
+	AppendVector(files.IndexDeleted, std::move(partialFiles.IndexDeleted));
+	AppendVector(files.IndexTypeChange, std::move(partialFiles.IndexTypeChange));
+	AppendVector(files.IndexRenamed, std::move(partialFiles.IndexRenamed));
+
+	AppendVector(files.WorkingAdded, std::move(partialFiles.WorkingAdded));
+	AppendVector(files.WorkingModified, std::move(partialFiles.WorkingModified));
+	AppendVector(files.WorkingDeleted, std::move(partialFiles.WorkingDeleted));
+	AppendVector(files.WorkingTypeChange, std::move(partialFiles.WorkingTypeChange));
+	AppendVector(files.WorkingUnreadable, std::move(partialFiles.WorkingUnreadable));
+	AppendVector(files.WorkingRenamed, std::move(partialFiles.WorkingRenamed));
+
+	AppendVector(files.Ignored, std::move(partialFiles.Ignored));
+	AppendVector(files.Conflicted, std::move(partialFiles.Conflicted));
+}
+
+/*static*/ void Git::SortFileStatus(FileStatus::Lists& files)
+{
+	SortVector(files.IndexAdded);
+	SortVector(files.IndexModified);
+	SortVector(files.IndexDeleted);
+	SortVector(files.IndexTypeChange);
+	SortVector(files.IndexRenamed);
+
+	SortVector(files.WorkingAdded);
+	SortVector(files.WorkingModified);
+	SortVector(files.WorkingDeleted);
+	SortVector(files.WorkingTypeChange);
+	SortVector(files.WorkingUnreadable);
+	SortVector(files.WorkingRenamed);
+
+	SortAndRemoveDuplicates(files.Ignored);
+	SortAndRemoveDuplicates(files.Conflicted);
+}
+
+bool Git::GetSubmodules(Git::Status& status, UniqueGitRepository& repository)
+{
+	status.Submodules.clear();
+	auto result = git_submodule_foreach(
+		repository.get(),
+		[](git_submodule* submodule, const char* /*name*/, void* payload)
+		{
+			if (payload == nullptr)
+				return -1;
+
+			Git::Submodule submoduleToAdd;
+			submoduleToAdd.Path = std::string(git_submodule_path(submodule));
+			auto indexId = git_submodule_index_id(submodule);
+			if (indexId != nullptr)
+				submoduleToAdd.IndexSha1Id = ConvertOidToString(indexId);
+
+			auto payloadAsSubmodules = reinterpret_cast<std::vector<Git::Submodule>*>(payload);
+			payloadAsSubmodules->emplace_back(std::move(submoduleToAdd));
+			return 0;
+		},
+		&status.Submodules);
+
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetSubmodules.FailedToListSubmodules", Severity::Warning)
+			<< R"(Failed to list submodules. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		status.Submodules.clear();
+		return false;
+	}
+
+	for (auto& submodule : status.Submodules)
+	{
+		submodule.WorkingDirectory = status.WorkingDirectory + submodule.Path + "/";
+
+		// Discovery finds the parent repository if the submodule isn't checked out.
+		Git::Status submoduleStatus;
+		if (Git::DiscoverRepository(submoduleStatus, submodule.WorkingDirectory)
+			&& submoduleStatus.RepositoryPath != status.RepositoryPath)
+		{
+			submodule.RepositoryPath = std::move(submoduleStatus.RepositoryPath);
+		}
+	}
+
+	return true;
+}
+
+bool Git::OpenRepository(Git::Status& status, UniqueGitRepository& repository)
+{
+	if (repository.get() != nullptr)
+		return true;
+
+	auto result = git_repository_open_ext(
+		&repository.get(),
+		status.RepositoryPath.c_str(),
+		GIT_REPOSITORY_OPEN_NO_SEARCH,
+		nullptr);
+
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("Git.GetGitStatus.FailedToOpenRepository", Severity::Error)
+			<< R"(Failed to open repository. { "repositoryPath": ")" << status.RepositoryPath
+			<< R"(", "result": ")" << ConvertErrorCodeToString(static_cast<git_error_code>(result))
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	Log("Git.GetGitStatus.OpenedRepository", Severity::Verbose)
+		<< R"(Opened repository handle. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+
+	if (git_repository_is_bare(repository.get()))
+	{
+		Log("Git.GetGitStatus.BareRepository", Severity::Warning)
+			<< R"(Aborting due to bare repository. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+		repository.reset(nullptr);
+		return false;
+	}
+
+	return true;
+}
+
+std::tuple<bool, std::string> Git::DiscoverRepository(const std::string& path)
+{
+	Git::Status status;
+	return Git::DiscoverRepository(status, path)
+		? std::make_tuple(true, std::move(status.RepositoryPath))
+		: std::make_tuple(false, std::string());
+}
+
+std::tuple<bool, Git::Status> Git::GetStatus(const std::string& path, uint32_t components)
+{
+	Git::Status status;
+	if (!Git::DiscoverRepository(status, path))
+		return std::make_tuple(false, Git::Status());
+
+	auto lease = m_repositoryPool.Checkout(status.RepositoryPath);
+	auto& repository = lease.Get();
+	if (!Git::OpenRepository(status, repository))
+		return std::make_tuple(false, Git::Status());
+
+	status.Components = components;
+	Git::GetWorkingDirectory(status, repository);
+	Git::GetCommonDirectory(status, repository);
+	Git::GetRepositoryState(status, repository);
+	Git::GetRefStatus(status, repository, (components & AheadBehindComponent) != 0);
+	if ((components & StashComponent) != 0)
+		Git::GetStashList(status, repository);
+	if ((components & SubmoduleComponent) != 0)
+		Git::GetSubmodules(status, repository);
+	if ((components & FileStatusComponent) != 0 && !Git::GetFullFileStatus(status, repository))
+		return std::make_tuple(false, Git::Status());
+
+	return std::make_tuple(true, std::move(status));
+}
+
+std::tuple<bool, Git::Status> Git::GetStatus(
+	const std::string& path,
+	const Git::Status& previousStatus,
+	const std::unordered_set<std::string>& dirtyPaths,
+	uint32_t components)
+{
+	components |= FileStatusComponent;
+	if (dirtyPaths.empty() || (previousStatus.Components & FileStatusComponent) == 0)
+		return Git::GetStatus(path, components);
+
+	Git::Status status;
+	if (!Git::DiscoverRepository(status, path))
+		return std::make_tuple(false, Git::Status());
+
+	auto lease = m_repositoryPool.Checkout(status.RepositoryPath);
+	auto& repository = lease.Get();
+	if (!Git::OpenRepository(status, repository))
+		return std::make_tuple(false, Git::Status());
+
+	Git::GetWorkingDirectory(status, repository);
+	Git::GetCommonDirectory(status, repository);
+	if (status.RepositoryPath != previousStatus.RepositoryPath || status.WorkingDirectory != previousStatus.WorkingDirectory)
+	{
+		Log("Git.GetGitStatus.PreviousStatusMismatch", Severity::Warning)
+			<< R"(Previous status doesn't match repository. Computing full status. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+		return Git::GetStatus(path, components);
+	}
+
+	status.Components = components;
+	Git::GetRepositoryState(status, repository);
+	Git::GetRefStatus(status, repository, (components & AheadBehindComponent) != 0);
+	if ((components & StashComponent) != 0)
+		Git::GetStashList(status, repository);
+	if ((components & SubmoduleComponent) != 0)
+		Git::GetSubmodules(status, repository);
+
+	auto pathspec = Git::BuildDirtyPathspec(previousStatus, dirtyPaths);
+	if (pathspec.empty())
+	{
+		if (!Git::GetFullFileStatus(status, repository))
+			return std::make_tuple(false, Git::Status());
+		return std::make_tuple(true, std::move(status));
+	}
+
+	FileStatus::Lists recomputedFiles;
+	if (!Git::GetFileStatus(status, recomputedFiles, repository, pathspec))
+		return std::make_tuple(false, Git::Status());
+
+	Log("Git.GetGitStatus.IncrementalFileStatus", Severity::Verbose)
+		<< R"(Recomputed file status for dirty paths. { "repositoryPath": ")" << status.RepositoryPath
+		<< R"(", "dirtyPaths": )" << dirtyPaths.size()
+		<< R"(, "pathspecEntries": )" << pathspec.size() << R"( })";
+
+	FileStatus::Lists files;
+	Git::MergeFileStatus(files, previousStatus.Files, std::move(recomputedFiles), pathspec);
+	status.Files = FileStatus(files);
+	return std::make_tuple(true, std::move(status));
+}
+
+/*static*/ void Git::CopyStatusComponents(Git::Status& status, const Git::Status& source, uint32_t components)
+{
+	if ((components & AheadBehindComponent) != 0)
+	{
+		status.AheadBy = source.AheadBy;
+		status.BehindBy = source.BehindBy;
+	}
+
+	if ((components & FileStatusComponent) != 0)
+		status.Files = source.Files;
+
+	if ((components & StashComponent) != 0)
+		status.Stashes = source.Stashes;
+
+	if ((components & SubmoduleComponent) != 0)
+		status.Submodules = source.Submodules;
+
+	status.Components |= components;
+}
+
+void Git::ReloadRepository(const std::string& repositoryPath)
+{
+	m_repositoryPool.Reload(repositoryPath);
+}
+
+void Git::EvictRepository(const std::string& repositoryPath)
+{
+	m_repositoryPool.Reload(repositoryPath);
+	m_untrackedCache.Remove(repositoryPath);
+}
+
+uint64_t Git::GetRetainedSizeInBytes(const std::string& repositoryPath)
+{
+	return m_repositoryPool.GetSizeInBytes(repositoryPath) + m_untrackedCache.GetSizeInBytes(repositoryPath);
+}
\ No newline at end of file
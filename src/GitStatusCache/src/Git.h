@@ -1,113 +1,287 @@
-#pragma once
-
-
-/**
- * Performs git operations.
- */
-class Git
-{
-public:
-	struct Stash
-	{
-		uint64_t Index;
-		std::string Sha1Id;
-		std::string Message;
-	};
-
-	struct Status
-	{
-		std::string RepositoryPath;
-		std::string WorkingDirectory;
-		std::string State;
-
-		std::string Branch;
-		std::string Upstream;
-		bool UpstreamGone = false;
-		int AheadBy = 0;
-		int BehindBy = 0;
-
-		std::vector<std::string> IndexAdded;
-		std::vector<std::string> IndexModified;
-		std::vector<std::string> IndexDeleted;
-		std::vector<std::string> IndexTypeChange;
-		std::vector<std::pair<std::string, std::string>> IndexRenamed;
-
-		std::vector<std::string> WorkingAdded;
-		std::vector<std::string> WorkingModified;
-		std::vector<std::string> WorkingDeleted;
-		std::vector<std::string> WorkingTypeChange;
-		std::vector<std::string> WorkingUnreadable;
-		std::vector<std::pair<std::string, std::string>> WorkingRenamed;
-
-		std::vector<std::string> Ignored;
-		std::vector<std::string> Conflicted;
-
-		std::vector<Stash> Stashes;
-	};
-
-private:
-	/**
-	* Searches for repository containing provided path and updates status.
-	*/
-	bool DiscoverRepository(Status& status, const std::string& path);
-
-	/**
-	* Retrieves the repository's working directory and updates status.
-	*/
-	bool GetWorkingDirectory(Status& status, UniqueGitRepository& repository);
-
-	/**
-	 * Retrieves current repository state based on current ongoing operation
-	 * (ex. rebase, cherry pick) and updates status.
-	 */
-	bool GetRepositoryState(Status& status, UniqueGitRepository& repository);
-
-	/**
-	 * Attempts to set the branch in the status to the current commit.
-	 */
-	bool SetBranchToCurrentCommit(Status& status);
-
-	/**
-	 * Attempts to set the branch in the status by parsing head-name.
-	 */
-	bool SetBranchFromHeadName(Status& status, const boost::filesystem::path& path);
-
-	/**
-	* Attempts to set the branch in the status using the reference from .git/rebase-apply/head-name.
-	*/
-	bool SetBranchFromRebaseApplyHeadName(Status& status);
-
-	/**
-	* Attempts to set the branch in the status using the reference from .git/rebase-merge/head-name.
-	*/
-	bool SetBranchFromRebaseMergeHeadName(Status& status);
-
-	/**
-	* Retrieves the current branch/upstream and updates status.
-	*/
-	bool GetRefStatus(Status& status, UniqueGitRepository& repository);
-
-	/**
-	 * Retrieves file add/modify/delete statistics and updates status.
-	 */
-	bool GetFileStatus(Status& status, UniqueGitRepository& repository);
-
-	/**
-	 * Retrieves information about stashes and updates status.
-	 */
-	bool GetStashList(Status& status, UniqueGitRepository& repository);
-
-public:
-	Git();
-	~Git();
-
-	/**
-	* Searches for repository containing provided path and updates status.
-	*/
-	std::tuple<bool, std::string> DiscoverRepository(const std::string& path);
-
-	/**
-	 * Retrieves current git status for repository at provided path.
-	 */
-	std::tuple<bool, Git::Status> GetStatus(const std::string& path);
+#pragma once
+#include "AheadBehindCache.h"
+#include "FileStatus.h"
+#include "GitSettings.h"
+#include "IndexRefresher.h"
+#include "RefResolver.h"
+#include "RepositoryPool.h"
+#include "UntrackedCache.h"
+
+/**
+ * Performs git operations.
+ */
+class Git
+{
+public:
+	/**
+	 * Optional parts of status. Repository, working directory, state, branch, and upstream
+	 * are always retrieved.
+	 */
+	enum StatusComponents : uint32_t
+	{
+		AheadBehindComponent = 0x1,
+		FileStatusComponent = 0x2,
+		StashComponent = 0x4,
+		SubmoduleComponent = 0x8,
+		AllComponents = AheadBehindComponent | FileStatusComponent | StashComponent | SubmoduleComponent
+	};
+
+	struct Stash
+	{
+		uint64_t Index;
+		std::string Sha1Id;
+		std::string Message;
+	};
+
+	/**
+	 * Submodule of a repository. Summary of the submodule's own status is filled in by the
+	 * cache from the submodule's cache entry.
+	 */
+	struct Submodule
+	{
+		std::string Path;
+		std::string WorkingDirectory;
+		std::string RepositoryPath;
+		std::string IndexSha1Id;
+
+		bool HasStatus = false;
+		std::string Branch;
+		std::string HeadSha1Id;
+		bool HasNewCommits = false;
+		size_t IndexChanges = 0;
+		size_t WorkingChanges = 0;
+		size_t Conflicted = 0;
+	};
+
+	struct Status
+	{
+		std::string RepositoryPath;
+		std::string CommonDirectory;
+		std::string WorkingDirectory;
+		std::string State;
+		uint32_t Components = 0;
+
+		std::string Branch;
+		std::string HeadSha1Id;
+		std::string Upstream;
+		bool UpstreamGone = false;
+		int AheadBy = 0;
+		int BehindBy = 0;
+
+		FileStatus Files;
+
+		std::vector<Stash> Stashes;
+		std::vector<Submodule> Submodules;
+	};
+
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	/**
+	 * Stash list and the identity of refs/stash and its reflog it was read from.
+	 */
+	struct CachedStashList
+	{
+		git_oid StashId;
+		uintmax_t ReflogSize = 0;
+		std::time_t ReflogLastWriteTime = 0;
+		std::vector<Stash> Stashes;
+	};
+
+	GitSettings m_settings;
+	RepositoryPool m_repositoryPool;
+	UntrackedCache m_untrackedCache;
+	std::unique_ptr<IndexRefresher> m_indexRefresher;
+	AheadBehindCache m_aheadBehindCache;
+	RefResolver m_refResolver;
+	std::unordered_map<std::string, CachedStashList> m_stashListCache;
+	boost::shared_mutex m_stashListCacheMutex;
+
+	/**
+	* Searches for repository containing provided path and updates status.
+	*/
+	bool DiscoverRepository(Status& status, const std::string& path);
+
+	/**
+	* Retrieves the repository's working directory and updates status.
+	*/
+	bool GetWorkingDirectory(Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Retrieves the directory shared by all worktrees of the repository and updates status.
+	 * Matches the repository path unless the repository is a linked worktree.
+	 */
+	bool GetCommonDirectory(Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Retrieves current repository state based on current ongoing operation
+	 * (ex. rebase, cherry pick) and updates status.
+	 */
+	bool GetRepositoryState(Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Attempts to set the branch in the status to the current commit.
+	 */
+	bool SetBranchToCurrentCommit(Status& status);
+
+	/**
+	 * Attempts to set the branch in the status by parsing head-name.
+	 */
+	bool SetBranchFromHeadName(Status& status, const boost::filesystem::path& path);
+
+	/**
+	* Attempts to set the branch in the status using the reference from .git/rebase-apply/head-name.
+	*/
+	bool SetBranchFromRebaseApplyHeadName(Status& status);
+
+	/**
+	* Attempts to set the branch in the status using the reference from .git/rebase-merge/head-name.
+	*/
+	bool SetBranchFromRebaseMergeHeadName(Status& status);
+
+	/**
+	* Retrieves the current branch/upstream and updates status.
+	*/
+	bool GetRefStatus(Status& status, UniqueGitRepository& repository, bool includeAheadBehind = true);
+
+	/**
+	 * Retrieves file add/modify/delete statistics and updates file lists.
+	 * Restricts status to the provided pathspec if it is not empty.
+	 */
+	bool GetFileStatus(
+		Status& status,
+		FileStatus::Lists& files,
+		UniqueGitRepository& repository,
+		const std::vector<std::string>& pathspec,
+		git_status_show_t show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR,
+		bool includeUntracked = true);
+
+	/**
+	 * Retrieves file statistics for the whole repository and updates status. Uses parallel
+	 * status if enabled and the repository is large enough. Untracked files come from the
+	 * untracked cache if enabled.
+	 */
+	bool GetFullFileStatus(Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Retrieves file statistics for the whole repository and updates file lists.
+	 */
+	bool GetFullFileStatus(Status& status, FileStatus::Lists& files, UniqueGitRepository& repository, bool includeUntracked);
+
+	/**
+	 * Retrieves file statistics and updates file lists. Index changes are computed on the calling
+	 * thread. Working tree is split into top-level subtrees balanced by index entry count and
+	 * each group of subtrees is computed on its own thread with its own repository handle.
+	 */
+	bool GetFileStatusInParallel(Status& status, FileStatus::Lists& files, UniqueGitRepository& repository, uint32_t threadCount, bool includeUntracked);
+
+	/**
+	 * Partitions top-level entries of the working tree into balanced groups of pathspecs.
+	 * Returns empty vector if the repository is too small to benefit from parallel status.
+	 */
+	std::vector<std::vector<std::string>> PartitionWorkingTree(
+		Status& status,
+		UniqueGitRepository& repository,
+		uint32_t threadCount);
+
+	/**
+	 * Builds pathspec for recomputing dirty paths. Removes paths nested under other dirty paths
+	 * and widens paths inside untracked directories to the untracked directory itself. Adds
+	 * the other side of cached renames with a dirty side. Returns empty pathspec if the whole
+	 * working tree must be recomputed.
+	 */
+	static std::vector<std::string> BuildDirtyPathspec(const Status& previousStatus, const std::unordered_set<std::string>& dirtyPaths);
+
+	/**
+	 * Replaces file status for paths covered by the pathspec in the previous file status with
+	 * the recomputed file status and updates file lists.
+	 */
+	static void MergeFileStatus(
+		FileStatus::Lists& files,
+		const FileStatus& previousFiles,
+		FileStatus::Lists&& recomputedFiles,
+		const std::vector<std::string>& pathspec);
+
+	/**
+	 * Moves file status for disjoint paths into file lists. Call SortFileStatus once all
+	 * partial file lists are appended.
+	 */
+	static void AppendFileStatus(FileStatus::Lists& files, FileStatus::Lists&& partialFiles);
+
+	/**
+	 * Sorts file lists and removes duplicate ignored and conflicted paths.
+	 */
+	static void SortFileStatus(FileStatus::Lists& files);
+
+	/**
+	 * Retrieves information about stashes and updates status. Stash list is only re-read
+	 * when refs/stash or its reflog have changed since the last read.
+	 */
+	bool GetStashList(Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Reads stash list from the stash reflog.
+	 */
+	bool ReadStashList(std::vector<Stash>& stashes, Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Retrieves submodules checked out in the working directory and updates status. Status
+	 * of the submodules themselves isn't retrieved.
+	 */
+	bool GetSubmodules(Status& status, UniqueGitRepository& repository);
+
+	/**
+	 * Opens repository for status unless handle from the pool is already open.
+	 */
+	bool OpenRepository(Status& status, UniqueGitRepository& repository);
+
+public:
+	Git();
+	Git(const GitSettings& settings);
+	~Git();
+
+	/**
+	* Searches for repository containing provided path and updates status.
+	*/
+	std::tuple<bool, std::string> DiscoverRepository(const std::string& path);
+
+	/**
+	 * Retrieves current git status for repository at provided path.
+	 * Only retrieves the requested optional components.
+	 */
+	std::tuple<bool, Git::Status> GetStatus(const std::string& path, uint32_t components = AllComponents);
+
+	/**
+	 * Retrieves current git status for repository at provided path. File status is only
+	 * recomputed for dirty paths (relative to the working directory) and merged into the
+	 * previous status, which must include file status. Falls back to a full status if the
+	 * previous status doesn't match.
+	 */
+	std::tuple<bool, Git::Status> GetStatus(
+		const std::string& path,
+		const Git::Status& previousStatus,
+		const std::unordered_set<std::string>& dirtyPaths,
+		uint32_t components = AllComponents);
+
+	/**
+	 * Copies the provided optional components from source status.
+	 */
+	static void CopyStatusComponents(Status& status, const Status& source, uint32_t components);
+
+	/**
+	 * Discards open handles for repository so config and index are reloaded on next use.
+	 */
+	void ReloadRepository(const std::string& repositoryPath);
+
+	/**
+	 * Discards open handles and cached directories for repository that's no longer cached.
+	 */
+	void EvictRepository(const std::string& repositoryPath);
+
+	/**
+	 * Estimates bytes retained for repository outside its status: indexes held by pooled
+	 * handles and cached untracked directories.
+	 */
+	uint64_t GetRetainedSizeInBytes(const std::string& repositoryPath);
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+struct GitSettings
+{
+	/**
+	* Computes working tree status for top-level subtrees on separate threads.
+	*/
+	bool EnableParallelStatus = false;
+
+	/**
+	* Maximum number of threads used for parallel status. Zero uses one thread per core.
+	*/
+	uint32_t ParallelStatusThreads = 0;
+
+	/**
+	* Repositories with fewer index entries are always computed on a single thread.
+	*/
+	size_t ParallelStatusMinimumIndexEntries = 20000;
+
+	/**
+	* Reuses untracked entries for directories that haven't changed since they were last read.
+	*/
+	bool EnableUntrackedCache = false;
+
+	/**
+	* Writes refreshed stat data for unchanged files back to the index in the background
+	* after working tree status is computed, so later statuses don't re-hash them.
+	*/
+	bool EnableIndexRefresh = false;
+
+	/**
+	* Default maximum number of paths reported for each file list. Zero reports every path.
+	*/
+	uint32_t MaximumPathsPerCategory = 0;
+
+	/**
+	* Default time in milliseconds an invalidated status may still be reported while it's
+	* refreshed in the background. Zero always waits for current status.
+	*/
+	uint32_t MaximumStalenessInMilliseconds = 0;
+
+	/**
+	* Approximate memory in megabytes cached status, pooled indexes, and cached untracked
+	* directories may use before least recently used repositories are evicted. Zero never evicts.
+	*/
+	uint32_t CacheMemoryBudgetInMegabytes = 0;
+
+	/**
+	* Working directories or repository directories of repositories that are never evicted.
+	*/
+	std::vector<std::string> PinnedRepositories;
+
+	/**
+	* File cached status is persisted to so it survives restarts. Empty disables persistence.
+	*/
+	std::string CacheSnapshotPath;
+
+	/**
+	* Time in seconds between writes of the persisted cache. Also written on shutdown.
+	*/
+	uint32_t CacheSnapshotIntervalInSeconds = 300;
+};
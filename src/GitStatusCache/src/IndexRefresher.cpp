@@ -0,0 +1,502 @@
+#include "stdafx.h"
+#include "IndexRefresher.h"
+#include "StringConverters.h"
+#include <wincrypt.h>
+
+static const size_t IndexHeaderSize = 12;
+static const size_t IndexEntryHeaderSize = 62;
+static const size_t IndexChecksumSize = 20;
+
+uint32_t ReadBigEndian32(const std::string& contents, size_t offset)
+{
+	auto bytes = reinterpret_cast<const uint8_t*>(contents.data() + offset);
+	return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16)
+		| (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+uint16_t ReadBigEndian16(const std::string& contents, size_t offset)
+{
+	auto bytes = reinterpret_cast<const uint8_t*>(contents.data() + offset);
+	return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+void WriteBigEndian32(std::string& contents, size_t offset, uint32_t value)
+{
+	contents[offset] = static_cast<char>(value >> 24);
+	contents[offset + 1] = static_cast<char>(value >> 16);
+	contents[offset + 2] = static_cast<char>(value >> 8);
+	contents[offset + 3] = static_cast<char>(value);
+}
+
+git_index_time ConvertFileTime(const FILETIME& fileTime)
+{
+	// Matches libgit2's conversion from Windows file time to seconds since the epoch.
+	auto time = (static_cast<int64_t>(fileTime.dwHighDateTime) << 32) + fileTime.dwLowDateTime;
+	time -= 116444736000000000LL;
+
+	git_index_time indexTime;
+	indexTime.seconds = static_cast<int32_t>(time / 10000000);
+	indexTime.nanoseconds = static_cast<uint32_t>((time % 10000000) * 100);
+	return indexTime;
+}
+
+bool IsEqual(const git_index_time& left, const git_index_time& right)
+{
+	return left.seconds == right.seconds && left.nanoseconds == right.nanoseconds;
+}
+
+IndexRefresher::IndexRefresher(uint32_t threadCount)
+	: m_threadCount((std::max)(threadCount, 1u))
+{
+	Log("IndexRefresher.StartingRefreshThread", Severity::Spam)
+		<< "Attempting to start background thread for index refresh.";
+	m_refreshThread = std::thread(&IndexRefresher::RefreshScheduledRepositories, this);
+}
+
+IndexRefresher::~IndexRefresher()
+{
+	Log("IndexRefresher.Shutdown.StoppingRefreshThread", Severity::Spam)
+		<< R"(Shutting down index refresh thread. { "threadId": 0x)" << std::hex << m_refreshThread.get_id() << " }";
+
+	{
+		std::lock_guard<std::mutex> lock(m_refreshMutex);
+		m_isStopping = true;
+	}
+	m_refreshCondition.notify_one();
+	m_refreshThread.join();
+}
+
+void IndexRefresher::ScheduleRefresh(const std::string& repositoryPath)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_refreshMutex);
+		m_repositoriesToRefresh.insert(repositoryPath);
+	}
+	m_refreshCondition.notify_one();
+}
+
+void IndexRefresher::RefreshScheduledRepositories()
+{
+	Log("IndexRefresher.RefreshScheduledRepositories.Start", Severity::Verbose) << "Thread for index refresh started.";
+
+	while (true)
+	{
+		std::unordered_set<std::string> repositoriesToRefresh;
+		{
+			std::unique_lock<std::mutex> lock(m_refreshMutex);
+			m_refreshCondition.wait(lock, [this]() { return m_isStopping || !m_repositoriesToRefresh.empty(); });
+			if (m_isStopping)
+				break;
+			m_repositoriesToRefresh.swap(repositoriesToRefresh);
+		}
+
+		for (const auto& repositoryPath : repositoriesToRefresh)
+			IndexRefresher::Refresh(repositoryPath);
+	}
+
+	Log("IndexRefresher.RefreshScheduledRepositories.Stop", Severity::Verbose) << "Thread for index refresh stopping.";
+}
+
+/*static*/ IndexRefresher::FileStamp IndexRefresher::ReadFileStamp(const std::string& path)
+{
+	FileStamp stamp;
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (::GetFileAttributesEx(ConvertToUnicode(path).c_str(), GetFileExInfoStandard, &attributes) == FALSE
+		|| (attributes.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT)) != 0)
+	{
+		return stamp;
+	}
+
+	stamp.Exists = true;
+	stamp.Size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	stamp.ChangedTime = ConvertFileTime(attributes.ftCreationTime);
+	stamp.ModifiedTime = ConvertFileTime(attributes.ftLastWriteTime);
+	return stamp;
+}
+
+/*static*/ bool IndexRefresher::IsUpToDate(const EntryStat& entry, const FileStamp& file, const FileStamp& index)
+{
+	// Entries modified in the same second the index was written are racily clean and are
+	// always re-hashed by libgit2.
+	return IsEqual(entry.ChangedTime, file.ChangedTime)
+		&& IsEqual(entry.ModifiedTime, file.ModifiedTime)
+		&& entry.FileSize == static_cast<uint32_t>(file.Size)
+		&& entry.ModifiedTime.seconds < index.ModifiedTime.seconds;
+}
+
+/*static*/ void IndexRefresher::HashEntries(
+	std::vector<EntryStat>& refreshedEntries,
+	const std::string& repositoryPath,
+	const std::string& workingDirectory,
+	const std::vector<EntryStat>& entries,
+	size_t first,
+	size_t stride,
+	const FileStamp& index,
+	int32_t refreshStartTime)
+{
+	auto repository = MakeUniqueGitRepository(nullptr);
+	auto result = git_repository_open_ext(&repository.get(), repositoryPath.c_str(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr);
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("IndexRefresher.HashEntries.FailedToOpenRepository", Severity::Error)
+			<< R"(Failed to open repository. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return;
+	}
+
+	for (auto i = first; i < entries.size(); i += stride)
+	{
+		const auto& entry = entries[i];
+		auto path = workingDirectory + entry.Path;
+		auto file = IndexRefresher::ReadFileStamp(path);
+		if (!file.Exists || IndexRefresher::IsUpToDate(entry, file, index) || file.ModifiedTime.seconds >= refreshStartTime)
+			continue;
+
+		git_oid id;
+		if (git_repository_hashfile(&id, repository.get(), entry.Path.c_str(), GIT_OBJ_BLOB, nullptr) != GIT_OK
+			|| !git_oid_equal(&id, &entry.Id))
+		{
+			continue;
+		}
+
+		// Hash can't be trusted for files that changed while they were read.
+		if (IndexRefresher::ReadFileStamp(path) != file)
+			continue;
+
+		refreshedEntries.push_back(EntryStat{ entry.Path, entry.Id, file.ChangedTime, file.ModifiedTime, static_cast<uint32_t>(file.Size) });
+	}
+}
+
+/*static*/ bool IndexRefresher::ReadIndexFile(const std::string& path, std::string& contents)
+{
+	contents.clear();
+	auto file = MakeUniqueHandle(::CreateFile(
+		ConvertToUnicode(path).c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr /*lpSecurityAttributes*/,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr /*hTemplateFile*/));
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (::GetFileSizeEx(file, &size) == FALSE || size.QuadPart > (std::numeric_limits<DWORD>::max)())
+		return false;
+
+	contents.resize(static_cast<size_t>(size.QuadPart));
+	DWORD bytesRead = 0;
+	if (!contents.empty()
+		&& (::ReadFile(file, &contents[0], static_cast<DWORD>(contents.size()), &bytesRead, nullptr /*lpOverlapped*/) == FALSE
+			|| bytesRead != contents.size()))
+	{
+		contents.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/*static*/ std::string IndexRefresher::GetIndexChecksum(const std::string& contents)
+{
+	if (contents.size() < IndexHeaderSize + IndexChecksumSize)
+		return std::string();
+	return contents.substr(contents.size() - IndexChecksumSize);
+}
+
+/*static*/ bool IndexRefresher::ComputeIndexChecksum(const std::string& contents, size_t size, std::string& checksum)
+{
+	HCRYPTPROV provider = 0;
+	if (::CryptAcquireContext(&provider, nullptr, nullptr, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT) == FALSE)
+		return false;
+	auto releaseProvider = std::experimental::scope_guard([provider]() { ::CryptReleaseContext(provider, 0); });
+
+	HCRYPTHASH hash = 0;
+	if (::CryptCreateHash(provider, CALG_SHA1, 0, 0, &hash) == FALSE)
+		return false;
+	auto destroyHash = std::experimental::scope_guard([hash]() { ::CryptDestroyHash(hash); });
+
+	checksum.resize(IndexChecksumSize);
+	DWORD checksumSize = static_cast<DWORD>(checksum.size());
+	return ::CryptHashData(hash, reinterpret_cast<const BYTE*>(contents.data()), static_cast<DWORD>(size), 0) != FALSE
+		&& ::CryptGetHashParam(hash, HP_HASHVAL, reinterpret_cast<BYTE*>(&checksum[0]), &checksumSize, 0) != FALSE
+		&& checksumSize == IndexChecksumSize;
+}
+
+/*static*/ bool IndexRefresher::UpdateIndexEntries(
+	std::string& contents,
+	const std::unordered_map<std::string, const EntryStat*>& refreshedEntries,
+	size_t& updatedCount)
+{
+	updatedCount = 0;
+	if (contents.size() < IndexHeaderSize + IndexChecksumSize || contents.compare(0, 4, "DIRC") != 0)
+		return false;
+
+	// Version 4 prefix-compresses paths and isn't understood by libgit2 either.
+	auto version = ReadBigEndian32(contents, 4);
+	if (version != 2 && version != 3)
+		return false;
+
+	auto end = contents.size() - IndexChecksumSize;
+	auto offset = IndexHeaderSize;
+	auto entryCount = ReadBigEndian32(contents, 8);
+	for (auto i = uint32_t{ 0 }; i < entryCount; ++i)
+	{
+		if (end - offset < IndexEntryHeaderSize)
+			return false;
+
+		auto flags = ReadBigEndian16(contents, offset + 60);
+		auto headerSize = IndexEntryHeaderSize;
+		if ((flags & 0x4000) != 0)
+		{
+			if (version < 3)
+				return false;
+			headerSize += 2;
+		}
+
+		auto pathOffset = offset + headerSize;
+		size_t pathLength = flags & 0x0FFF;
+		if (pathLength == 0x0FFF)
+		{
+			auto pathEnd = contents.find('\0', pathOffset);
+			if (pathEnd == std::string::npos || pathEnd >= end)
+				return false;
+			pathLength = pathEnd - pathOffset;
+		}
+
+		// Entries are padded with one to eight NULs to a multiple of eight bytes.
+		auto entrySize = (headerSize + pathLength + 8) & ~size_t{ 7 };
+		if (end - offset < entrySize)
+			return false;
+
+		if (((flags >> 12) & 0x3) == 0)
+		{
+			auto refreshedEntry = refreshedEntries.find(contents.substr(pathOffset, pathLength));
+			if (refreshedEntry != refreshedEntries.end()
+				&& std::memcmp(&contents[offset + 40], refreshedEntry->second->Id.id, GIT_OID_RAWSZ) == 0)
+			{
+				const auto& stat = *refreshedEntry->second;
+				WriteBigEndian32(contents, offset, static_cast<uint32_t>(stat.ChangedTime.seconds));
+				WriteBigEndian32(contents, offset + 4, stat.ChangedTime.nanoseconds);
+				WriteBigEndian32(contents, offset + 8, static_cast<uint32_t>(stat.ModifiedTime.seconds));
+				WriteBigEndian32(contents, offset + 12, stat.ModifiedTime.nanoseconds);
+				WriteBigEndian32(contents, offset + 20, 0 /*ino*/);
+				WriteBigEndian32(contents, offset + 28, 0 /*uid*/);
+				WriteBigEndian32(contents, offset + 32, 0 /*gid*/);
+				WriteBigEndian32(contents, offset + 36, stat.FileSize);
+				++updatedCount;
+			}
+		}
+
+		offset += entrySize;
+	}
+
+	// Extensions are copied unchanged. Patching stat data keeps entry order and count, so
+	// FSMN and UNTR stay valid. A split index keeps entries elsewhere and isn't supported.
+	while (end - offset >= 8)
+	{
+		if (contents.compare(offset, 4, "link") == 0)
+			return false;
+
+		auto extensionSize = ReadBigEndian32(contents, offset + 4);
+		if (end - offset - 8 < extensionSize)
+			return false;
+		offset += 8 + extensionSize;
+	}
+
+	return offset == end;
+}
+
+/*static*/ bool IndexRefresher::WriteIndex(
+	const std::string& repositoryPath,
+	const FileStamp& indexStamp,
+	const std::string& indexChecksum,
+	const std::vector<std::vector<EntryStat>>& partialResults,
+	size_t& updatedCount)
+{
+	updatedCount = 0;
+	auto indexPath = repositoryPath + "index";
+	auto lockPath = repositoryPath + "index.lock";
+
+	// Git creates index.lock exclusively before it reads the index for an update, so holding it
+	// keeps git from changing the index between verifying and replacing it.
+	auto lockFile = MakeUniqueHandle(::CreateFile(
+		ConvertToUnicode(lockPath).c_str(),
+		GENERIC_WRITE,
+		0 /*dwShareMode*/,
+		nullptr /*lpSecurityAttributes*/,
+		CREATE_NEW,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr /*hTemplateFile*/));
+	if (lockFile == INVALID_HANDLE_VALUE)
+	{
+		Log("IndexRefresher.WriteIndex.IndexLocked", Severity::Info)
+			<< R"(Index is locked. Discarding refreshed entries. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return false;
+	}
+
+	auto isLockCommitted = false;
+	auto removeLock = std::experimental::scope_guard([&lockFile, &lockPath, &isLockCommitted]()
+	{
+		if (!isLockCommitted)
+		{
+			lockFile.invoke();
+			::DeleteFile(ConvertToUnicode(lockPath).c_str());
+		}
+	});
+
+	// Writing would discard changes git made to the index while files were hashed.
+	std::string contents;
+	if (IndexRefresher::ReadFileStamp(indexPath) != indexStamp
+		|| !IndexRefresher::ReadIndexFile(indexPath, contents)
+		|| IndexRefresher::GetIndexChecksum(contents) != indexChecksum)
+	{
+		Log("IndexRefresher.WriteIndex.IndexChanged", Severity::Info)
+			<< R"(Index changed during refresh. Discarding refreshed entries. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return false;
+	}
+
+	std::unordered_map<std::string, const EntryStat*> refreshedEntries;
+	for (const auto& partialResult : partialResults)
+	{
+		for (const auto& refreshedEntry : partialResult)
+			refreshedEntries[refreshedEntry.Path] = &refreshedEntry;
+	}
+
+	std::string checksum;
+	if (!IndexRefresher::UpdateIndexEntries(contents, refreshedEntries, updatedCount)
+		|| !IndexRefresher::ComputeIndexChecksum(contents, contents.size() - IndexChecksumSize, checksum))
+	{
+		Log("IndexRefresher.WriteIndex.UnsupportedIndex", Severity::Warning)
+			<< R"(Index format isn't supported for refresh. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return false;
+	}
+	if (updatedCount == 0)
+		return true;
+	contents.replace(contents.size() - IndexChecksumSize, IndexChecksumSize, checksum);
+
+	DWORD bytesWritten = 0;
+	if (::WriteFile(lockFile, contents.data(), static_cast<DWORD>(contents.size()), &bytesWritten, nullptr /*lpOverlapped*/) == FALSE
+		|| bytesWritten != contents.size())
+	{
+		Log("IndexRefresher.WriteIndex.FailedToWriteLock", Severity::Error)
+			<< R"(Failed to write index.lock. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "error": )" << ::GetLastError() << " }";
+		return false;
+	}
+
+	// Renaming the lock over the index lets readers see either the old or the new index.
+	lockFile.invoke();
+	if (::MoveFileEx(ConvertToUnicode(lockPath).c_str(), ConvertToUnicode(indexPath).c_str(), MOVEFILE_REPLACE_EXISTING) == FALSE)
+	{
+		Log("IndexRefresher.WriteIndex.FailedToReplaceIndex", Severity::Info)
+			<< R"(Failed to replace index with index.lock. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "error": )" << ::GetLastError() << " }";
+		return false;
+	}
+
+	isLockCommitted = true;
+	return true;
+}
+
+bool IndexRefresher::Refresh(const std::string& repositoryPath)
+{
+	FILETIME now;
+	::GetSystemTimeAsFileTime(&now);
+	auto refreshStartTime = ConvertFileTime(now).seconds;
+
+	auto repository = MakeUniqueGitRepository(nullptr);
+	auto result = git_repository_open_ext(&repository.get(), repositoryPath.c_str(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr);
+	if (result != GIT_OK || git_repository_workdir(repository.get()) == nullptr)
+	{
+		auto lastError = giterr_last();
+		Log("IndexRefresher.Refresh.FailedToOpenRepository", Severity::Error)
+			<< R"(Failed to open repository. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+	auto workingDirectory = std::string(git_repository_workdir(repository.get()));
+
+	// Stamp is read first so any write that races with reading the index is detected below.
+	auto indexPath = repositoryPath + "index";
+	auto indexStamp = IndexRefresher::ReadFileStamp(indexPath);
+	if (!indexStamp.Exists)
+		return true;
+
+	// Checksum identifies the index that was read even if git rewrites it within the stamp's
+	// timestamp resolution.
+	std::string indexContents;
+	if (!IndexRefresher::ReadIndexFile(indexPath, indexContents))
+	{
+		Log("IndexRefresher.Refresh.FailedToReadIndexFile", Severity::Warning)
+			<< R"(Failed to read index file. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return false;
+	}
+	auto indexChecksum = IndexRefresher::GetIndexChecksum(indexContents);
+	indexContents.clear();
+
+	auto index = MakeUniqueGitIndex(nullptr);
+	result = git_repository_index(&index.get(), repository.get());
+	if (result == GIT_OK)
+		result = git_index_read(index.get(), true /*force*/);
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("IndexRefresher.Refresh.FailedToReadIndex", Severity::Error)
+			<< R"(Failed to read index. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	std::vector<EntryStat> entries;
+	auto entryCount = git_index_entrycount(index.get());
+	entries.reserve(entryCount);
+	for (auto i = size_t{ 0 }; i < entryCount; ++i)
+	{
+		auto entry = git_index_get_byindex(index.get(), i);
+		if (GIT_IDXENTRY_STAGE(entry) != 0
+			|| (entry->mode != GIT_FILEMODE_BLOB && entry->mode != GIT_FILEMODE_BLOB_EXECUTABLE)
+			|| (entry->flags_extended & (GIT_IDXENTRY_INTENT_TO_ADD | GIT_IDXENTRY_SKIP_WORKTREE)) != 0)
+		{
+			continue;
+		}
+
+		entries.push_back(EntryStat{ entry->path, entry->id, entry->ctime, entry->mtime, entry->file_size });
+	}
+
+	auto threadCount = static_cast<size_t>(m_threadCount);
+	std::vector<std::vector<EntryStat>> partialResults(threadCount);
+	std::vector<std::thread> workers;
+	for (auto i = size_t{ 0 }; i < threadCount; ++i)
+	{
+		workers.emplace_back([i, threadCount, refreshStartTime, &repositoryPath, &workingDirectory, &entries, &indexStamp, &partialResults]()
+		{
+			IndexRefresher::HashEntries(
+				partialResults[i], repositoryPath, workingDirectory, entries, i, threadCount, indexStamp, refreshStartTime);
+		});
+	}
+	for (auto& worker : workers)
+		worker.join();
+
+	auto refreshedCount = size_t{ 0 };
+	for (const auto& refreshedEntries : partialResults)
+		refreshedCount += refreshedEntries.size();
+	if (refreshedCount == 0)
+	{
+		Log("IndexRefresher.Refresh.UpToDate", Severity::Verbose)
+			<< R"(Index stat data is up to date. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return true;
+	}
+
+	size_t updatedCount = 0;
+	if (!IndexRefresher::WriteIndex(repositoryPath, indexStamp, indexChecksum, partialResults, updatedCount))
+		return false;
+
+	Log("IndexRefresher.Refresh.WroteIndex", Severity::Info)
+		<< R"(Wrote refreshed stat data to index. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "refreshedEntries": )" << updatedCount
+		<< R"(, "threads": )" << threadCount << R"( })";
+	return true;
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <condition_variable>
+
+/**
+* Writes refreshed stat data back to the index in the background. libgit2 re-hashes every file
+* whose stat data no longer matches its index entry (ex. after a checkout or a build touched
+* timestamps) on every status, but never records that the content was unchanged. Refreshing
+* hashes those files once in parallel and stores their current stat data, so later statuses
+* can trust the index again. index.lock is held while the index is re-verified and rewritten,
+* so the index is only written if it wasn't modified while files were hashed. Only stat data of
+* refreshed entries is patched in place; extensions (ex. FSMN, UNTR) are kept as is.
+* This class is thread-safe.
+*/
+class IndexRefresher : boost::noncopyable
+{
+private:
+	/**
+	* Stat data for an index entry, either as recorded in the index or as read from the file.
+	*/
+	struct EntryStat
+	{
+		std::string Path;
+		git_oid Id;
+		git_index_time ChangedTime;
+		git_index_time ModifiedTime;
+		uint32_t FileSize;
+	};
+
+	/**
+	* Identifies a version of a file by size, creation time, and last write time.
+	*/
+	struct FileStamp
+	{
+		bool Exists = false;
+		uint64_t Size = 0;
+		git_index_time ChangedTime = { 0, 0 };
+		git_index_time ModifiedTime = { 0, 0 };
+
+		bool operator==(const FileStamp& other) const
+		{
+			return Exists == other.Exists
+				&& Size == other.Size
+				&& ChangedTime.seconds == other.ChangedTime.seconds
+				&& ChangedTime.nanoseconds == other.ChangedTime.nanoseconds
+				&& ModifiedTime.seconds == other.ModifiedTime.seconds
+				&& ModifiedTime.nanoseconds == other.ModifiedTime.nanoseconds;
+		}
+
+		bool operator!=(const FileStamp& other) const { return !(*this == other); }
+	};
+
+	const uint32_t m_threadCount;
+
+	std::thread m_refreshThread;
+	std::unordered_set<std::string> m_repositoriesToRefresh;
+	bool m_isStopping = false;
+	std::mutex m_refreshMutex;
+	std::condition_variable m_refreshCondition;
+
+	/**
+	* Reads stat data for a file the same way libgit2 does on Windows.
+	*/
+	static FileStamp ReadFileStamp(const std::string& path);
+
+	/**
+	* Checks if index entry's stat data matches the file and the entry isn't racily clean.
+	*/
+	static bool IsUpToDate(const EntryStat& entry, const FileStamp& file, const FileStamp& index);
+
+	/**
+	* Hashes every stride-th entry starting at first that isn't up to date and collects stat
+	* data for those whose content matches the index. Files modified at or after
+	* refreshStartTime are skipped since they would still be racily clean after the index is
+	* written.
+	*/
+	static void HashEntries(
+		std::vector<EntryStat>& refreshedEntries,
+		const std::string& repositoryPath,
+		const std::string& workingDirectory,
+		const std::vector<EntryStat>& entries,
+		size_t first,
+		size_t stride,
+		const FileStamp& index,
+		int32_t refreshStartTime);
+
+	/**
+	* Reads the full contents of the index file.
+	*/
+	static bool ReadIndexFile(const std::string& path, std::string& contents);
+
+	/**
+	* Returns the trailing checksum of index file contents, or an empty string if too short.
+	*/
+	static std::string GetIndexChecksum(const std::string& contents);
+
+	/**
+	* Computes SHA-1 used as the trailing checksum of the index file.
+	*/
+	static bool ComputeIndexChecksum(const std::string& contents, size_t size, std::string& checksum);
+
+	/**
+	* Patches stat data of stage 0 entries whose path and id match a refreshed entry directly in
+	* index file contents. Fails for index versions and extensions this doesn't understand.
+	*/
+	static bool UpdateIndexEntries(
+		std::string& contents,
+		const std::unordered_map<std::string, const EntryStat*>& refreshedEntries,
+		size_t& updatedCount);
+
+	/**
+	* Takes index.lock, verifies the index still matches the stamp and checksum read before
+	* files were hashed, and replaces it with a copy that has refreshed stat data.
+	*/
+	static bool WriteIndex(
+		const std::string& repositoryPath,
+		const FileStamp& indexStamp,
+		const std::string& indexChecksum,
+		const std::vector<std::vector<EntryStat>>& partialResults,
+		size_t& updatedCount);
+
+	/**
+	* Refreshes index for repository at provided path.
+	*/
+	bool Refresh(const std::string& repositoryPath);
+
+	/**
+	* Refreshes scheduled repositories until stopped.
+	*/
+	void RefreshScheduledRepositories();
+
+public:
+	/**
+	* Constructor.
+	* @param threadCount Number of threads used to hash files.
+	*/
+	IndexRefresher(uint32_t threadCount);
+	~IndexRefresher();
+
+	/**
+	* Schedules index refresh for repository at provided path on the refresh thread.
+	*/
+	void ScheduleRefresh(const std::string& repositoryPath);
+};
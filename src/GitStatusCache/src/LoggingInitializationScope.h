@@ -1,20 +1,20 @@
-#pragma once
-
-#include "LoggingModule.h"
-
-namespace Logging
-{
-	class LoggingInitializationScope : boost::noncopyable
-	{
-	public:
-		LoggingInitializationScope(LoggingModuleSettings settings)
-		{
-			LoggingModule::Initialize(settings);
-		}
-
-		~LoggingInitializationScope()
-		{
-			LoggingModule::Uninitialize();
-		}
-	};
+#pragma once
+
+#include "LoggingModule.h"
+
+namespace Logging
+{
+	class LoggingInitializationScope : boost::noncopyable
+	{
+	public:
+		LoggingInitializationScope(LoggingModuleSettings settings)
+		{
+			LoggingModule::Initialize(settings);
+		}
+
+		~LoggingInitializationScope()
+		{
+			LoggingModule::Uninitialize();
+		}
+	};
 }
\ No newline at end of file
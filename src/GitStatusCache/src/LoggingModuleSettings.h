@@ -1,12 +1,12 @@
-#pragma once
-
-#include "LoggingSeverities.h"
-
-namespace Logging
-{
-	struct LoggingModuleSettings
-	{
-		bool EnableFileLogging = false;
-		Severity MinimumSeverity = Severity::Info;
-	};
+#pragma once
+
+#include "LoggingSeverities.h"
+
+namespace Logging
+{
+	struct LoggingModuleSettings
+	{
+		bool EnableFileLogging = false;
+		Severity MinimumSeverity = Severity::Info;
+	};
 }
\ No newline at end of file
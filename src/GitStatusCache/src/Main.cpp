@@ -1,100 +1,122 @@
-#include "stdafx.h"
-#include <boost/program_options.hpp>
-#include "DirectoryMonitor.h"
-#include "LoggingModuleSettings.h"
-#include "LoggingInitializationScope.h"
-#include "NamedPipeServer.h"
-#include "StatusCache.h"
-#include "StatusController.h"
-
-using namespace boost::program_options;
-
-options_description BuildGenericOptions()
-{
-	options_description generic{ "Generic options" };
-	generic.add_options()
-		("help", "Display help message");
-	return generic;
-}
-
-options_description BuildLoggingOptions(bool* enableFileLogging, bool* quiet, bool* verbose, bool* spam)
-{
-	options_description logging{ "Logging options" };
-	logging.add_options()
-		("fileLogging", bool_switch(enableFileLogging), "Enables file logging.")
-		("quiet,q", bool_switch(quiet), "Disables all non-critical logging output.")
-		("verbose,v", bool_switch(verbose), "Enables verbose logging output.")
-		("spam,s", bool_switch(spam), "Enables spam logging output.");
-	return logging;
-}
-
-void ThrowIfMutuallyExclusiveOptionsSet(
-	const variables_map& vm,
-	const std::string& option1,
-	const std::string& option2,
-	const std::string& option3)
-{
-	if (   (!vm[option1].defaulted() && (!vm[option2].defaulted() || !vm[option3].defaulted()))
-		|| (!vm[option2].defaulted() && (!vm[option1].defaulted() || !vm[option3].defaulted()))
-		|| (!vm[option3].defaulted() && (!vm[option1].defaulted() || !vm[option2].defaulted())))
-	{
-		throw std::logic_error(std::string("Options '") + option1 + "', '" + option2 + "', and '" + option3 + "' are mutually exclusive.");
-	}
-}
-
-int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
-{
-	int argc;
-	auto argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
-
-	Logging::LoggingModuleSettings loggingSettings;
-	bool quiet = false;
-	bool verbose = false;
-	bool spam = false;
-
-	auto generic = BuildGenericOptions();
-	auto logging = BuildLoggingOptions(&loggingSettings.EnableFileLogging, &quiet, &verbose, &spam);
-	options_description all{ "Allowed options" };
-	all.add(generic).add(logging);
-
-	try
-	{
-		variables_map vm;
-		store(wcommand_line_parser(argc, argv).options(all).run(), vm);
-
-		if (vm.count("help"))
-		{
-			std::cout << generic << std::endl;
-			std::cout << logging << std::endl;
-			return 1;
-		}
-
-		ThrowIfMutuallyExclusiveOptionsSet(vm, "quiet", "verbose", "spam");
-		notify(vm);
-	}
-	catch (std::exception& e)
-	{
-		std::cerr << "Error: " << e.what() << std::endl;
-		std::cout << generic << std::endl;
-		std::cout << logging << std::endl;
-		return -1;
-	}
-
-	if (quiet)
-		loggingSettings.MinimumSeverity = Logging::Severity::Error;
-	else if (verbose)
-		loggingSettings.MinimumSeverity = Logging::Severity::Verbose;
-	else if (spam)
-		loggingSettings.MinimumSeverity = Logging::Severity::Spam;
-	else
-		loggingSettings.MinimumSeverity = Logging::Severity::Info;
-
-	Logging::LoggingInitializationScope enableLogging(loggingSettings);
-
-	StatusController statusController;
-	NamedPipeServer server([&statusController](const std::string& request) { return statusController.HandleRequest(request); });
-
-	statusController.WaitForShutdownRequest();
-
-	return 0;
-}
+#include "stdafx.h"
+#include <boost/program_options.hpp>
+#include "DirectoryMonitor.h"
+#include "LoggingModuleSettings.h"
+#include "LoggingInitializationScope.h"
+#include "NamedPipeServer.h"
+#include "StatusCache.h"
+#include "StatusController.h"
+
+using namespace boost::program_options;
+
+options_description BuildGenericOptions()
+{
+	options_description generic{ "Generic options" };
+	generic.add_options()
+		("help", "Display help message");
+	return generic;
+}
+
+options_description BuildLoggingOptions(bool* enableFileLogging, bool* quiet, bool* verbose, bool* spam)
+{
+	options_description logging{ "Logging options" };
+	logging.add_options()
+		("fileLogging", bool_switch(enableFileLogging), "Enables file logging.")
+		("quiet,q", bool_switch(quiet), "Disables all non-critical logging output.")
+		("verbose,v", bool_switch(verbose), "Enables verbose logging output.")
+		("spam,s", bool_switch(spam), "Enables spam logging output.");
+	return logging;
+}
+
+options_description BuildStatusOptions(GitSettings* gitSettings)
+{
+	options_description status{ "Status options" };
+	status.add_options()
+		("parallelStatus", bool_switch(&gitSettings->EnableParallelStatus), "Computes working tree status for top-level subtrees in parallel.")
+		("parallelStatusThreads", value<uint32_t>(&gitSettings->ParallelStatusThreads), "Maximum threads used for parallel status. Defaults to one per core.")
+		("parallelStatusMinimumIndexEntries", value<size_t>(&gitSettings->ParallelStatusMinimumIndexEntries), "Minimum index entries before parallel status is used.")
+		("untrackedCache", bool_switch(&gitSettings->EnableUntrackedCache), "Skips reading unchanged directories when searching for untracked files.")
+		("refreshIndex", bool_switch(&gitSettings->EnableIndexRefresh), "Writes refreshed stat data for unchanged files back to the index in the background.")
+		("maxPaths", value<uint32_t>(&gitSettings->MaximumPathsPerCategory), "Maximum paths reported for each file list unless requests specify 'MaxPaths'. Defaults to unlimited.")
+		("maxStalenessMs", value<uint32_t>(&gitSettings->MaximumStalenessInMilliseconds), "Milliseconds an invalidated status may be reported while it's refreshed unless requests specify 'MaxStalenessMs'. Defaults to zero.")
+		("cacheBudgetMB", value<uint32_t>(&gitSettings->CacheMemoryBudgetInMegabytes), "Approximate megabytes of cached status, pooled indexes, and untracked directories retained before least recently used repositories are evicted. Defaults to unlimited.")
+		("pin", value<std::vector<std::string>>(&gitSettings->PinnedRepositories)->multitoken(), "Repositories that are never evicted from the cache.")
+		("snapshotFile", value<std::string>(&gitSettings->CacheSnapshotPath), "File cached status is persisted to and restored from on startup. Disabled unless specified.")
+		("snapshotIntervalSeconds", value<uint32_t>(&gitSettings->CacheSnapshotIntervalInSeconds), "Seconds between writes of the snapshot file. Defaults to 300.");
+	return status;
+}
+
+void ThrowIfMutuallyExclusiveOptionsSet(
+	const variables_map& vm,
+	const std::string& option1,
+	const std::string& option2,
+	const std::string& option3)
+{
+	if (   (!vm[option1].defaulted() && (!vm[option2].defaulted() || !vm[option3].defaulted()))
+		|| (!vm[option2].defaulted() && (!vm[option1].defaulted() || !vm[option3].defaulted()))
+		|| (!vm[option3].defaulted() && (!vm[option1].defaulted() || !vm[option2].defaulted())))
+	{
+		throw std::logic_error(std::string("Options '") + option1 + "', '" + option2 + "', and '" + option3 + "' are mutually exclusive.");
+	}
+}
+
+int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
+{
+	int argc;
+	auto argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+
+	Logging::LoggingModuleSettings loggingSettings;
+	GitSettings gitSettings;
+	bool quiet = false;
+	bool verbose = false;
+	bool spam = false;
+
+	auto generic = BuildGenericOptions();
+	auto logging = BuildLoggingOptions(&loggingSettings.EnableFileLogging, &quiet, &verbose, &spam);
+	auto status = BuildStatusOptions(&gitSettings);
+	options_description all{ "Allowed options" };
+	all.add(generic).add(logging).add(status);
+
+	try
+	{
+		variables_map vm;
+		store(wcommand_line_parser(argc, argv).options(all).run(), vm);
+
+		if (vm.count("help"))
+		{
+			std::cout << generic << std::endl;
+			std::cout << logging << std::endl;
+			std::cout << status << std::endl;
+			return 1;
+		}
+
+		ThrowIfMutuallyExclusiveOptionsSet(vm, "quiet", "verbose", "spam");
+		notify(vm);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		std::cout << generic << std::endl;
+		std::cout << logging << std::endl;
+		std::cout << status << std::endl;
+		return -1;
+	}
+
+	if (quiet)
+		loggingSettings.MinimumSeverity = Logging::Severity::Error;
+	else if (verbose)
+		loggingSettings.MinimumSeverity = Logging::Severity::Verbose;
+	else if (spam)
+		loggingSettings.MinimumSeverity = Logging::Severity::Spam;
+	else
+		loggingSettings.MinimumSeverity = Logging::Severity::Info;
+
+	Logging::LoggingInitializationScope enableLogging(loggingSettings);
+
+	StatusController statusController(gitSettings);
+	NamedPipeServer server([&statusController](const std::string& request) { return statusController.HandleRequest(request); });
+
+	statusController.WaitForShutdownRequest();
+
+	return 0;
+}
@@ -0,0 +1,464 @@
+#include "stdafx.h"
+#include "PersistentCache.h"
+#include "StringConverters.h"
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+
+/**
+* Reads values from a memory-mapped file. Reads past the end fail and leave the reader failed.
+*/
+class FileReader
+{
+private:
+	const char* m_position;
+	const char* m_end;
+	bool m_failed = false;
+
+public:
+	FileReader(const char* data, size_t size) : m_position(data), m_end(data + size) { }
+
+	bool ReadBytes(void* value, size_t size)
+	{
+		if (m_failed || static_cast<size_t>(m_end - m_position) < size)
+		{
+			m_failed = true;
+			return false;
+		}
+
+		std::memcpy(value, m_position, size);
+		m_position += size;
+		return true;
+	}
+
+	template <typename T>
+	bool Read(T& value)
+	{
+		return ReadBytes(&value, sizeof(T));
+	}
+
+	bool ReadString(std::string& value)
+	{
+		uint32_t size = 0;
+		if (!Read(size) || static_cast<size_t>(m_end - m_position) < size)
+		{
+			m_failed = true;
+			return false;
+		}
+
+		value.assign(m_position, size);
+		m_position += size;
+		return true;
+	}
+};
+
+template <typename T>
+void Append(std::string& buffer, const T& value)
+{
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void AppendString(std::string& buffer, const boost::string_ref& value)
+{
+	Append(buffer, static_cast<uint32_t>(value.size()));
+	buffer.append(value.data(), value.size());
+}
+
+void AppendFingerprint(std::string& buffer, const PersistentCache::Fingerprint& fingerprint)
+{
+	Append(buffer, fingerprint.IndexSize);
+	Append(buffer, fingerprint.IndexLastWriteTime);
+	Append(buffer, fingerprint.IndexChecksum.id);
+	Append(buffer, fingerprint.HeadTargetHash);
+	Append(buffer, fingerprint.Head.id);
+	Append(buffer, fingerprint.PackedRefsSize);
+	Append(buffer, fingerprint.PackedRefsLastWriteTime);
+	Append(buffer, fingerprint.ConfigLastWriteTime);
+	Append(buffer, fingerprint.WorkingDirectoryLastWriteTime);
+}
+
+bool ReadFingerprint(FileReader& reader, PersistentCache::Fingerprint& fingerprint)
+{
+	return reader.Read(fingerprint.IndexSize)
+		&& reader.Read(fingerprint.IndexLastWriteTime)
+		&& reader.Read(fingerprint.IndexChecksum.id)
+		&& reader.Read(fingerprint.HeadTargetHash)
+		&& reader.Read(fingerprint.Head.id)
+		&& reader.Read(fingerprint.PackedRefsSize)
+		&& reader.Read(fingerprint.PackedRefsLastWriteTime)
+		&& reader.Read(fingerprint.ConfigLastWriteTime)
+		&& reader.Read(fingerprint.WorkingDirectoryLastWriteTime);
+}
+
+bool IsRenameCategory(FileStatus::Category category)
+{
+	return category == FileStatus::IndexRenamed || category == FileStatus::WorkingRenamed;
+}
+
+void AppendFileStatus(std::string& buffer, const FileStatus& files)
+{
+	for (auto i = uint32_t{ 0 }; i < FileStatus::CategoryCount; ++i)
+	{
+		auto category = static_cast<FileStatus::Category>(i);
+		Append(buffer, static_cast<uint32_t>(files.GetCount(category)));
+		if (IsRenameCategory(category))
+		{
+			for (const auto& rename : files.GetRenames(category))
+			{
+				AppendString(buffer, rename.first);
+				AppendString(buffer, rename.second);
+			}
+		}
+		else
+		{
+			for (const auto& path : files.GetPaths(category))
+				AppendString(buffer, path);
+		}
+	}
+}
+
+std::vector<std::string>& GetPathList(FileStatus::Lists& lists, FileStatus::Category category)
+{
+	switch (category)
+	{
+	case FileStatus::IndexAdded: return lists.IndexAdded;
+	case FileStatus::IndexModified: return lists.IndexModified;
+	case FileStatus::IndexDeleted: return lists.IndexDeleted;
+	case FileStatus::IndexTypeChange: return lists.IndexTypeChange;
+	case FileStatus::WorkingAdded: return lists.WorkingAdded;
+	case FileStatus::WorkingModified: return lists.WorkingModified;
+	case FileStatus::WorkingDeleted: return lists.WorkingDeleted;
+	case FileStatus::WorkingTypeChange: return lists.WorkingTypeChange;
+	case FileStatus::WorkingUnreadable: return lists.WorkingUnreadable;
+	case FileStatus::Ignored: return lists.Ignored;
+	default: return lists.Conflicted;
+	}
+}
+
+bool ReadFileStatus(FileReader& reader, FileStatus& files)
+{
+	FileStatus::Lists lists;
+	for (auto i = uint32_t{ 0 }; i < FileStatus::CategoryCount; ++i)
+	{
+		auto category = static_cast<FileStatus::Category>(i);
+		uint32_t count = 0;
+		if (!reader.Read(count))
+			return false;
+
+		if (IsRenameCategory(category))
+		{
+			auto& renames = category == FileStatus::IndexRenamed ? lists.IndexRenamed : lists.WorkingRenamed;
+			for (auto j = uint32_t{ 0 }; j < count; ++j)
+			{
+				std::pair<std::string, std::string> rename;
+				if (!reader.ReadString(rename.first) || !reader.ReadString(rename.second))
+					return false;
+				renames.push_back(std::move(rename));
+			}
+		}
+		else
+		{
+			auto& paths = GetPathList(lists, category);
+			for (auto j = uint32_t{ 0 }; j < count; ++j)
+			{
+				std::string path;
+				if (!reader.ReadString(path))
+					return false;
+				paths.push_back(std::move(path));
+			}
+		}
+	}
+
+	files = FileStatus(lists);
+	return true;
+}
+
+bool ReadFileStamp(const std::string& path, uint64_t& size, uint64_t& lastWriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (::GetFileAttributesEx(ConvertToUnicode(path).c_str(), GetFileExInfoStandard, &attributes) == FALSE)
+	{
+		size = 0;
+		lastWriteTime = 0;
+		return false;
+	}
+
+	size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+bool ReadIndexChecksum(const std::string& path, git_oid& checksum)
+{
+	// Index ends with a SHA-1 of its contents.
+	std::ifstream fileStream(boost::filesystem::path(ConvertToUnicode(path)).c_str(), std::ios::binary);
+	if (!fileStream.good())
+		return false;
+
+	fileStream.seekg(-static_cast<std::streamoff>(GIT_OID_RAWSZ), std::ios::end);
+	fileStream.read(reinterpret_cast<char*>(checksum.id), GIT_OID_RAWSZ);
+	return fileStream.good();
+}
+
+uint64_t HashString(const std::string& value)
+{
+	// FNV-1a, which is stable across runs unlike std::hash.
+	auto hash = uint64_t{ 14695981039346656037ULL };
+	for (auto character : value)
+	{
+		hash ^= static_cast<uint8_t>(character);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+PersistentCache::PersistentCache(const std::shared_ptr<Cache>& cache, const std::string& path, uint32_t writeIntervalInSeconds)
+	: m_cache(cache)
+	, m_path(path)
+	, m_writeInterval(std::chrono::seconds((std::max)(writeIntervalInSeconds, 1u)))
+{
+	Log("PersistentCache.StartingWriteThread", Severity::Spam)
+		<< "Attempting to start background thread for writing persistent cache.";
+	m_writeThread = std::thread(&PersistentCache::WritePeriodically, this);
+}
+
+PersistentCache::~PersistentCache()
+{
+	Log("PersistentCache.Shutdown.StoppingWriteThread", Severity::Spam)
+		<< R"(Shutting down persistent cache write thread. { "threadId": 0x)" << std::hex << m_writeThread.get_id() << " }";
+
+	{
+		std::lock_guard<std::mutex> lock(m_writeMutex);
+		m_isStopping = true;
+	}
+	m_writeCondition.notify_one();
+	m_writeThread.join();
+
+	PersistentCache::Write();
+}
+
+void PersistentCache::WritePeriodically()
+{
+	Log("PersistentCache.WritePeriodically.Start", Severity::Verbose) << "Thread for writing persistent cache started.";
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_writeMutex);
+			if (m_writeCondition.wait_for(lock, m_writeInterval, [this]() { return m_isStopping; }))
+				break;
+		}
+
+		PersistentCache::Write();
+	}
+
+	Log("PersistentCache.WritePeriodically.Stop", Severity::Verbose) << "Thread for writing persistent cache stopping.";
+}
+
+bool PersistentCache::ComputeFingerprint(const Git::Status& status, Fingerprint& fingerprint)
+{
+	fingerprint = Fingerprint();
+	auto indexPath = status.RepositoryPath + "index";
+	if (!ReadFileStamp(indexPath, fingerprint.IndexSize, fingerprint.IndexLastWriteTime)
+		|| !ReadIndexChecksum(indexPath, fingerprint.IndexChecksum))
+	{
+		return false;
+	}
+
+	// Unborn branches have a symbolic HEAD that doesn't resolve and keep a zero oid.
+	std::string headTarget;
+	if (!m_refResolver.ReadHead(status.RepositoryPath, headTarget, fingerprint.Head))
+		return false;
+	if (!headTarget.empty())
+		m_refResolver.ResolveReference(status.RepositoryPath, status.CommonDirectory, headTarget, fingerprint.Head);
+	fingerprint.HeadTargetHash = HashString(headTarget);
+
+	uint64_t configSize = 0;
+	uint64_t workingDirectorySize = 0;
+	ReadFileStamp(status.CommonDirectory + "packed-refs", fingerprint.PackedRefsSize, fingerprint.PackedRefsLastWriteTime);
+	ReadFileStamp(status.CommonDirectory + "config", configSize, fingerprint.ConfigLastWriteTime);
+	ReadFileStamp(status.WorkingDirectory, workingDirectorySize, fingerprint.WorkingDirectoryLastWriteTime);
+	return true;
+}
+
+/*static*/ bool PersistentCache::IsFingerprintOfStatus(const Cache::CurrentStatus& currentStatus, const Fingerprint& fingerprint)
+{
+	const auto& status = *currentStatus.Status;
+	char head[GIT_OID_HEXSZ + 1] = { 0 };
+	auto isHeadUnchanged = status.HeadSha1Id.empty()
+		? git_oid_iszero(&fingerprint.Head) != 0
+		: status.HeadSha1Id == git_oid_tostr(head, sizeof(head), &fingerprint.Head);
+
+	// Missing files have a zero last write time.
+	return isHeadUnchanged
+		&& fingerprint.IndexLastWriteTime < currentStatus.ComputeStartTime
+		&& fingerprint.PackedRefsLastWriteTime < currentStatus.ComputeStartTime
+		&& fingerprint.ConfigLastWriteTime < currentStatus.ComputeStartTime
+		&& fingerprint.WorkingDirectoryLastWriteTime < currentStatus.ComputeStartTime;
+}
+
+bool PersistentCache::Write()
+{
+	auto statuses = m_cache->GetCurrentStatuses();
+
+	std::string buffer;
+	Append(buffer, FileSignature);
+	Append(buffer, FileVersion);
+	auto countOffset = buffer.size();
+	Append(buffer, uint32_t{ 0 });
+
+	auto count = uint32_t{ 0 };
+	auto skipped = uint32_t{ 0 };
+	for (const auto& currentStatus : statuses)
+	{
+		const auto& status = currentStatus.Status;
+		Fingerprint fingerprint;
+		if (status->WorkingDirectory.empty() || !PersistentCache::ComputeFingerprint(*status, fingerprint))
+			continue;
+
+		// Fingerprint is read after status was computed and may include changes the status
+		// doesn't. Persisting both would restore outdated status, so status is only written
+		// if the fingerprint predates it and no change was reported while it was read.
+		if (!PersistentCache::IsFingerprintOfStatus(currentStatus, fingerprint) || !m_cache->IsCurrentStatus(status))
+		{
+			++skipped;
+			continue;
+		}
+
+		AppendFingerprint(buffer, fingerprint);
+		Append(buffer, currentStatus.ComputeStartTime);
+		AppendString(buffer, status->RepositoryPath);
+		AppendString(buffer, status->CommonDirectory);
+		AppendString(buffer, status->WorkingDirectory);
+		AppendString(buffer, status->State);
+		AppendString(buffer, status->Branch);
+		AppendString(buffer, status->HeadSha1Id);
+		AppendString(buffer, status->Upstream);
+		Append(buffer, static_cast<uint8_t>(status->UpstreamGone ? 1 : 0));
+		AppendFileStatus(buffer, status->Files);
+		++count;
+	}
+	std::memcpy(&buffer[countOffset], &count, sizeof(count));
+
+	// Written to a temporary file and renamed over the previous file so a crash while writing
+	// never leaves a truncated file behind.
+	auto path = boost::filesystem::path(ConvertToUnicode(m_path));
+	auto temporaryPath = boost::filesystem::path(path).concat(L".tmp");
+	{
+		std::ofstream fileStream(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+		fileStream.write(buffer.data(), buffer.size());
+		if (!fileStream.good())
+		{
+			Log("PersistentCache.Write.FailedToWriteFile", Severity::Error)
+				<< R"(Failed to write persistent cache. { "path": ")" << ConvertToUtf8(temporaryPath.wstring()) << R"(" })";
+			return false;
+		}
+	}
+
+	boost::system::error_code errorCode;
+	boost::filesystem::rename(temporaryPath, path, errorCode);
+	if (errorCode)
+	{
+		Log("PersistentCache.Write.FailedToReplaceFile", Severity::Error)
+			<< R"(Failed to replace persistent cache. { "path": ")" << m_path
+			<< R"(", "error": ")" << errorCode.message() << R"(" })";
+		return false;
+	}
+
+	Log("PersistentCache.Write", Severity::Verbose)
+		<< R"(Wrote persistent cache. { "path": ")" << m_path
+		<< R"(", "statuses": )" << count
+		<< R"(, "skipped": )" << skipped
+		<< R"(, "bytes": )" << buffer.size() << R"( })";
+	return true;
+}
+
+std::vector<PersistentCache::PersistedStatus> PersistentCache::Load()
+{
+	std::vector<PersistedStatus> persistedStatuses;
+
+	auto file = MakeUniqueHandle(::CreateFile(
+		ConvertToUnicode(m_path).c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr /*lpSecurityAttributes*/,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr /*hTemplateFile*/));
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		Log("PersistentCache.Load.NoFile", Severity::Info)
+			<< R"(No persistent cache to load. { "path": ")" << m_path << R"(" })";
+		return persistedStatuses;
+	}
+
+	LARGE_INTEGER size;
+	if (::GetFileSizeEx(file, &size) == FALSE || size.QuadPart == 0)
+		return persistedStatuses;
+
+	auto mapping = ::CreateFileMapping(file, nullptr /*lpAttributes*/, PAGE_READONLY, 0, 0, nullptr /*lpName*/);
+	if (mapping == nullptr)
+		return persistedStatuses;
+	auto uniqueMapping = MakeUniqueHandle(mapping);
+
+	auto view = MakeUniqueMapView(::MapViewOfFile(uniqueMapping, FILE_MAP_READ, 0, 0, 0));
+	if (view.get() == nullptr)
+		return persistedStatuses;
+
+	FileReader reader(static_cast<const char*>(view.get()), static_cast<size_t>(size.QuadPart));
+	uint32_t signature = 0;
+	uint32_t version = 0;
+	uint32_t count = 0;
+	if (!reader.Read(signature) || !reader.Read(version) || !reader.Read(count)
+		|| signature != FileSignature || version != FileVersion)
+	{
+		Log("PersistentCache.Load.UnknownFormat", Severity::Warning)
+			<< R"(Ignoring persistent cache in unknown format. { "path": ")" << m_path << R"(" })";
+		return persistedStatuses;
+	}
+
+	for (auto i = uint32_t{ 0 }; i < count; ++i)
+	{
+		PersistedStatus persistedStatus;
+		auto& status = persistedStatus.Status;
+		uint8_t upstreamGone = 0;
+		if (!ReadFingerprint(reader, persistedStatus.Fingerprint)
+			|| !reader.Read(persistedStatus.ComputeStartTime)
+			|| !reader.ReadString(status.RepositoryPath)
+			|| !reader.ReadString(status.CommonDirectory)
+			|| !reader.ReadString(status.WorkingDirectory)
+			|| !reader.ReadString(status.State)
+			|| !reader.ReadString(status.Branch)
+			|| !reader.ReadString(status.HeadSha1Id)
+			|| !reader.ReadString(status.Upstream)
+			|| !reader.Read(upstreamGone)
+			|| !ReadFileStatus(reader, status.Files))
+		{
+			Log("PersistentCache.Load.Corrupt", Severity::Warning)
+				<< R"(Ignoring corrupt persistent cache. { "path": ")" << m_path << R"(" })";
+			return std::vector<PersistedStatus>();
+		}
+
+		status.UpstreamGone = upstreamGone != 0;
+		status.Components = PersistedComponents;
+		persistedStatuses.push_back(std::move(persistedStatus));
+	}
+
+	Log("PersistentCache.Load", Severity::Info)
+		<< R"(Loaded persistent cache. { "path": ")" << m_path
+		<< R"(", "statuses": )" << persistedStatuses.size() << R"( })";
+	return persistedStatuses;
+}
+
+bool PersistentCache::Restore(const PersistedStatus& persistedStatus)
+{
+	const auto& status = persistedStatus.Status;
+	Fingerprint fingerprint;
+	if (!PersistentCache::ComputeFingerprint(status, fingerprint) || fingerprint != persistedStatus.Fingerprint)
+	{
+		Log("PersistentCache.Restore.Changed", Severity::Verbose)
+			<< R"(Repository changed since status was persisted. { "repositoryPath": ")" << status.RepositoryPath << R"(" })";
+		return false;
+	}
+
+	return m_cache->RestoreCacheEntry(status, persistedStatus.ComputeStartTime);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "Cache.h"
+#include "RefResolver.h"
+#include <condition_variable>
+
+/**
+* Persists cached status to a file so a restarted cache can serve repositories that haven't
+* changed without recomputing them. Each persisted status carries a fingerprint of the files
+* it was computed from. Statuses whose fingerprint still matches are restored into the cache.
+* The file is written periodically and on shutdown, and memory-mapped when it's read.
+* This class is thread-safe.
+*/
+class PersistentCache : boost::noncopyable
+{
+public:
+	/**
+	* Identifies the state of a repository that cached file status depends on.
+	*/
+	struct Fingerprint
+	{
+		uint64_t IndexSize = 0;
+		uint64_t IndexLastWriteTime = 0;
+		git_oid IndexChecksum = {};
+		uint64_t HeadTargetHash = 0;
+		git_oid Head = {};
+		uint64_t PackedRefsSize = 0;
+		uint64_t PackedRefsLastWriteTime = 0;
+		uint64_t ConfigLastWriteTime = 0;
+		uint64_t WorkingDirectoryLastWriteTime = 0;
+
+		bool operator==(const Fingerprint& other) const
+		{
+			return IndexSize == other.IndexSize
+				&& IndexLastWriteTime == other.IndexLastWriteTime
+				&& git_oid_equal(&IndexChecksum, &other.IndexChecksum)
+				&& HeadTargetHash == other.HeadTargetHash
+				&& git_oid_equal(&Head, &other.Head)
+				&& PackedRefsSize == other.PackedRefsSize
+				&& PackedRefsLastWriteTime == other.PackedRefsLastWriteTime
+				&& ConfigLastWriteTime == other.ConfigLastWriteTime
+				&& WorkingDirectoryLastWriteTime == other.WorkingDirectoryLastWriteTime;
+		}
+
+		bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+	};
+
+	/**
+	* Status read from the file along with the fingerprint recorded when it was written and
+	* when its computation started as a FILETIME.
+	*/
+	struct PersistedStatus
+	{
+		Git::Status Status;
+		PersistentCache::Fingerprint Fingerprint;
+		uint64_t ComputeStartTime = 0;
+	};
+
+private:
+	/**
+	* Identifies the file format. Files with a different signature or version are ignored.
+	*/
+	static const uint32_t FileSignature = 0x53435347;
+	static const uint32_t FileVersion = 2;
+
+	/**
+	* Components restored from the file. Branch, state, and upstream are always persisted.
+	* Other components depend on state the fingerprint doesn't cover and are recomputed on
+	* first use.
+	*/
+	static const uint32_t PersistedComponents = Git::FileStatusComponent;
+
+	std::shared_ptr<Cache> m_cache;
+	const std::string m_path;
+	const std::chrono::seconds m_writeInterval;
+	RefResolver m_refResolver;
+
+	std::thread m_writeThread;
+	bool m_isStopping = false;
+	std::mutex m_writeMutex;
+	std::condition_variable m_writeCondition;
+
+	/**
+	* Computes fingerprint of the repository's current state. Returns false if the repository
+	* has no index or HEAD can't be read.
+	*/
+	bool ComputeFingerprint(const Git::Status& status, Fingerprint& fingerprint);
+
+	/**
+	* Checks if fingerprint read after status was computed describes the state status was
+	* computed from: HEAD matches and every fingerprinted file was last written before the
+	* computation started.
+	*/
+	static bool IsFingerprintOfStatus(const Cache::CurrentStatus& currentStatus, const Fingerprint& fingerprint);
+
+	/**
+	* Writes cached statuses to the file. The file is replaced only once it's fully written.
+	*/
+	bool Write();
+
+	/**
+	* Writes cached statuses every write interval until stopped.
+	*/
+	void WritePeriodically();
+
+public:
+	/**
+	* Constructor.
+	* @param cache Cache persisted to and restored from the file.
+	* @param path Path of the file.
+	* @param writeIntervalInSeconds Time between writes of the file.
+	*/
+	PersistentCache(const std::shared_ptr<Cache>& cache, const std::string& path, uint32_t writeIntervalInSeconds);
+	~PersistentCache();
+
+	/**
+	* Reads statuses persisted by a previous run. Returns nothing if the file is missing,
+	* from another version, or corrupt.
+	*/
+	std::vector<PersistedStatus> Load();
+
+	/**
+	* Restores persisted status into the cache if the repository's fingerprint still matches.
+	* Returns false if the repository changed or is already cached.
+	*/
+	bool Restore(const PersistedStatus& persistedStatus);
+};
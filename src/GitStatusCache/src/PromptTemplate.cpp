@@ -0,0 +1,195 @@
+#include "stdafx.h"
+#include "PromptTemplate.h"
+
+/*static*/ bool PromptTemplate::ParseField(const std::string& name, Field& field, uint32_t& components)
+{
+	static const std::unordered_map<std::string, std::tuple<Field, uint32_t>> fields =
+	{
+		{ "Branch", std::make_tuple(Field::Branch, 0) },
+		{ "Upstream", std::make_tuple(Field::Upstream, 0) },
+		{ "State", std::make_tuple(Field::State, 0) },
+		{ "AheadBy", std::make_tuple(Field::AheadBy, Git::AheadBehindComponent) },
+		{ "BehindBy", std::make_tuple(Field::BehindBy, Git::AheadBehindComponent) },
+		{ "IndexAdded", std::make_tuple(Field::IndexAdded, Git::FileStatusComponent) },
+		{ "IndexModified", std::make_tuple(Field::IndexModified, Git::FileStatusComponent) },
+		{ "IndexDeleted", std::make_tuple(Field::IndexDeleted, Git::FileStatusComponent) },
+		{ "IndexTypeChange", std::make_tuple(Field::IndexTypeChange, Git::FileStatusComponent) },
+		{ "IndexRenamed", std::make_tuple(Field::IndexRenamed, Git::FileStatusComponent) },
+		{ "IndexChanges", std::make_tuple(Field::IndexChanges, Git::FileStatusComponent) },
+		{ "WorkingAdded", std::make_tuple(Field::WorkingAdded, Git::FileStatusComponent) },
+		{ "WorkingModified", std::make_tuple(Field::WorkingModified, Git::FileStatusComponent) },
+		{ "WorkingDeleted", std::make_tuple(Field::WorkingDeleted, Git::FileStatusComponent) },
+		{ "WorkingTypeChange", std::make_tuple(Field::WorkingTypeChange, Git::FileStatusComponent) },
+		{ "WorkingRenamed", std::make_tuple(Field::WorkingRenamed, Git::FileStatusComponent) },
+		{ "WorkingUnreadable", std::make_tuple(Field::WorkingUnreadable, Git::FileStatusComponent) },
+		{ "WorkingChanges", std::make_tuple(Field::WorkingChanges, Git::FileStatusComponent) },
+		{ "Ignored", std::make_tuple(Field::Ignored, Git::FileStatusComponent) },
+		{ "Conflicted", std::make_tuple(Field::Conflicted, Git::FileStatusComponent) },
+		{ "Stashes", std::make_tuple(Field::Stashes, Git::StashComponent) },
+	};
+
+	auto fieldEntry = fields.find(name);
+	if (fieldEntry == fields.end())
+		return false;
+
+	field = std::get<0>(fieldEntry->second);
+	components = std::get<1>(fieldEntry->second);
+	return true;
+}
+
+/*static*/ void PromptTemplate::RenderField(std::string& prompt, Field field, const Git::Status& status)
+{
+	switch (field)
+	{
+	case Field::Branch:
+		prompt += status.Branch;
+		break;
+	case Field::Upstream:
+		prompt += status.Upstream;
+		break;
+	case Field::State:
+		prompt += status.State;
+		break;
+	case Field::AheadBy:
+		prompt += std::to_string(status.AheadBy);
+		break;
+	case Field::BehindBy:
+		prompt += std::to_string(status.BehindBy);
+		break;
+	case Field::IndexAdded:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::IndexAdded));
+		break;
+	case Field::IndexModified:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::IndexModified));
+		break;
+	case Field::IndexDeleted:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::IndexDeleted));
+		break;
+	case Field::IndexTypeChange:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::IndexTypeChange));
+		break;
+	case Field::IndexRenamed:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::IndexRenamed));
+		break;
+	case Field::IndexChanges:
+		prompt += std::to_string(
+			status.Files.GetCount(FileStatus::IndexAdded)
+			+ status.Files.GetCount(FileStatus::IndexModified)
+			+ status.Files.GetCount(FileStatus::IndexDeleted)
+			+ status.Files.GetCount(FileStatus::IndexTypeChange)
+			+ status.Files.GetCount(FileStatus::IndexRenamed));
+		break;
+	case Field::WorkingAdded:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::WorkingAdded));
+		break;
+	case Field::WorkingModified:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::WorkingModified));
+		break;
+	case Field::WorkingDeleted:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::WorkingDeleted));
+		break;
+	case Field::WorkingTypeChange:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::WorkingTypeChange));
+		break;
+	case Field::WorkingRenamed:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::WorkingRenamed));
+		break;
+	case Field::WorkingUnreadable:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::WorkingUnreadable));
+		break;
+	case Field::WorkingChanges:
+		prompt += std::to_string(
+			status.Files.GetCount(FileStatus::WorkingAdded)
+			+ status.Files.GetCount(FileStatus::WorkingModified)
+			+ status.Files.GetCount(FileStatus::WorkingDeleted)
+			+ status.Files.GetCount(FileStatus::WorkingTypeChange)
+			+ status.Files.GetCount(FileStatus::WorkingRenamed)
+			+ status.Files.GetCount(FileStatus::WorkingUnreadable));
+		break;
+	case Field::Ignored:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::Ignored));
+		break;
+	case Field::Conflicted:
+		prompt += std::to_string(status.Files.GetCount(FileStatus::Conflicted));
+		break;
+	case Field::Stashes:
+		prompt += std::to_string(status.Stashes.size());
+		break;
+	case Field::Literal:
+		break;
+	}
+}
+
+/*static*/ std::tuple<bool, PromptTemplate> PromptTemplate::Parse(const std::string& format)
+{
+	PromptTemplate promptTemplate;
+	std::string literal;
+	auto flushLiteral = [&promptTemplate, &literal]()
+	{
+		if (literal.empty())
+			return;
+		promptTemplate.m_segments.push_back(Segment{ Field::Literal, std::move(literal) });
+		literal.clear();
+	};
+
+	for (size_t position = 0; position < format.size(); ++position)
+	{
+		auto character = format[position];
+		auto isEscaped = position + 1 < format.size() && format[position + 1] == character;
+		if (character == '}')
+		{
+			if (!isEscaped)
+				return std::make_tuple(false, PromptTemplate());
+			literal += character;
+			++position;
+		}
+		else if (character == '{')
+		{
+			if (isEscaped)
+			{
+				literal += character;
+				++position;
+				continue;
+			}
+
+			auto end = format.find('}', position + 1);
+			if (end == std::string::npos)
+				return std::make_tuple(false, PromptTemplate());
+
+			Field field;
+			uint32_t components;
+			if (!ParseField(format.substr(position + 1, end - position - 1), field, components))
+				return std::make_tuple(false, PromptTemplate());
+
+			flushLiteral();
+			promptTemplate.m_segments.push_back(Segment{ field, std::string() });
+			promptTemplate.m_requiredComponents |= components;
+			position = end;
+		}
+		else
+		{
+			literal += character;
+		}
+	}
+	flushLiteral();
+
+	return std::make_tuple(true, std::move(promptTemplate));
+}
+
+uint32_t PromptTemplate::GetRequiredComponents() const
+{
+	return m_requiredComponents;
+}
+
+std::string PromptTemplate::Render(const Git::Status& status) const
+{
+	std::string prompt;
+	for (const auto& segment : m_segments)
+	{
+		if (segment.Type == Field::Literal)
+			prompt += segment.Literal;
+		else
+			RenderField(prompt, segment.Type, status);
+	}
+	return prompt;
+}
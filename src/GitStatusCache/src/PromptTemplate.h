@@ -0,0 +1,72 @@
+#pragma once
+#include "Git.h"
+
+/**
+ * Parsed prompt format. Formats contain literal text and field names in braces,
+ * ex. "[{Branch} +{IndexChanges} ~{WorkingChanges}]". Braces are escaped by doubling them.
+ */
+class PromptTemplate
+{
+private:
+	enum class Field
+	{
+		Literal,
+		Branch,
+		Upstream,
+		State,
+		AheadBy,
+		BehindBy,
+		IndexAdded,
+		IndexModified,
+		IndexDeleted,
+		IndexTypeChange,
+		IndexRenamed,
+		IndexChanges,
+		WorkingAdded,
+		WorkingModified,
+		WorkingDeleted,
+		WorkingTypeChange,
+		WorkingRenamed,
+		WorkingUnreadable,
+		WorkingChanges,
+		Ignored,
+		Conflicted,
+		Stashes
+	};
+
+	struct Segment
+	{
+		Field Type;
+		std::string Literal;
+	};
+
+	std::vector<Segment> m_segments;
+	uint32_t m_requiredComponents = 0;
+
+	/**
+	 * Looks up field by name and the optional status components needed to render it.
+	 * Returns false if the field is unrecognized.
+	 */
+	static bool ParseField(const std::string& name, Field& field, uint32_t& components);
+
+	/**
+	 * Appends value of field to the rendered prompt.
+	 */
+	static void RenderField(std::string& prompt, Field field, const Git::Status& status);
+
+public:
+	/**
+	 * Parses prompt format. Fails on unrecognized fields and unbalanced braces.
+	 */
+	static std::tuple<bool, PromptTemplate> Parse(const std::string& format);
+
+	/**
+	 * Optional status components needed to render this template.
+	 */
+	uint32_t GetRequiredComponents() const;
+
+	/**
+	 * Renders prompt for status.
+	 */
+	std::string Render(const Git::Status& status) const;
+};
@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "RefResolver.h"
+#include "StringConverters.h"
+#include <cstring>
+#include <fstream>
+
+/*static*/ bool RefResolver::ReadLooseReference(const std::string& repositoryPath, const std::string& name, std::string& contents)
+{
+	auto path = boost::filesystem::path(ConvertToUnicode(repositoryPath + name));
+	auto fileStream = std::ifstream(path.c_str());
+	if (!fileStream.good())
+		return false;
+
+	std::getline(fileStream, contents);
+	if (!contents.empty() && contents.back() == '\r')
+		contents.pop_back();
+	return true;
+}
+
+/*static*/ bool RefResolver::ParseOid(const char* contents, size_t length, git_oid& oid)
+{
+	return length >= GIT_OID_HEXSZ && git_oid_fromstrn(&oid, contents, GIT_OID_HEXSZ) == GIT_OK;
+}
+
+/*static*/ bool RefResolver::IsPerWorktreeReference(const std::string& name)
+{
+	if (name.compare(0, 5, "refs/") != 0)
+		return true;
+
+	for (const auto& prefix : { "refs/bisect/", "refs/worktree/", "refs/rewritten/" })
+	{
+		if (name.compare(0, std::strlen(prefix), prefix) == 0)
+			return true;
+	}
+	return false;
+}
+
+/*static*/ std::shared_ptr<const RefResolver::PackedRefs> RefResolver::LoadPackedRefs(const boost::filesystem::path& path, uint64_t size, uint64_t lastWriteTime)
+{
+	auto packedRefs = std::make_shared<PackedRefs>();
+	packedRefs->Exists = true;
+	packedRefs->Size = size;
+	packedRefs->LastWriteTime = lastWriteTime;
+
+	// The view is released as soon as the index is built so git can still replace the file.
+	auto file = MakeUniqueHandle(::CreateFile(
+		path.wstring().c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr /*lpSecurityAttributes*/,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr /*hTemplateFile*/));
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	// The file may have been replaced or truncated since its attributes were read, so the
+	// parsed size comes from the open handle. Mapping exactly that size fails if the file
+	// shrank in the meantime, and a mapped file can't be truncated.
+	LARGE_INTEGER fileSize;
+	if (::GetFileSizeEx(file, &fileSize) == FALSE)
+		return nullptr;
+	if (fileSize.QuadPart == 0)
+		return packedRefs;
+
+	auto mapping = ::CreateFileMapping(
+		file,
+		nullptr /*lpAttributes*/,
+		PAGE_READONLY,
+		static_cast<DWORD>(fileSize.QuadPart >> 32),
+		static_cast<DWORD>(fileSize.QuadPart),
+		nullptr /*lpName*/);
+	if (mapping == nullptr)
+		return nullptr;
+	auto uniqueMapping = MakeUniqueHandle(mapping);
+
+	auto view = MakeUniqueMapView(::MapViewOfFile(uniqueMapping, FILE_MAP_READ, 0, 0, 0));
+	if (view.get() == nullptr)
+		return nullptr;
+
+	auto data = static_cast<const char*>(view.get());
+	auto end = data + fileSize.QuadPart;
+	auto isSorted = false;
+	packedRefs->Names.reserve(static_cast<size_t>(fileSize.QuadPart));
+
+	for (auto line = data; line < end;)
+	{
+		auto lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		auto contentEnd = (lineEnd > line && *(lineEnd - 1) == '\r') ? lineEnd - 1 : lineEnd;
+		auto length = static_cast<size_t>(contentEnd - line);
+
+		if (*line == '#')
+		{
+			auto header = std::string(line, length);
+			isSorted = header.find(" sorted") != std::string::npos;
+		}
+		else if (*line != '^')
+		{
+			PackedRefs::Entry entry;
+			if (length > GIT_OID_HEXSZ + 1 && line[GIT_OID_HEXSZ] == ' ' && ParseOid(line, length, entry.Oid))
+			{
+				entry.NameOffset = packedRefs->Names.size();
+				entry.NameLength = length - GIT_OID_HEXSZ - 1;
+				packedRefs->Names.append(line + GIT_OID_HEXSZ + 1, entry.NameLength);
+				packedRefs->Entries.push_back(entry);
+			}
+		}
+
+		line = lineEnd + 1;
+	}
+
+	if (!isSorted)
+	{
+		const auto& names = packedRefs->Names;
+		std::sort(
+			packedRefs->Entries.begin(),
+			packedRefs->Entries.end(),
+			[&names](const PackedRefs::Entry& left, const PackedRefs::Entry& right)
+			{
+				return names.compare(left.NameOffset, left.NameLength, names, right.NameOffset, right.NameLength) < 0;
+			});
+	}
+
+	Log("RefResolver.LoadPackedRefs", Severity::Verbose)
+		<< R"(Indexed packed-refs. { "path": ")" << ConvertToUtf8(path.wstring())
+		<< R"(", "references": )" << packedRefs->Entries.size()
+		<< R"(, "wasSorted": )" << (isSorted ? "true" : "false") << R"( })";
+
+	return packedRefs;
+}
+
+std::shared_ptr<const RefResolver::PackedRefs> RefResolver::GetPackedRefs(const std::string& repositoryPath)
+{
+	auto path = boost::filesystem::path(ConvertToUnicode(repositoryPath));
+	path.append(L"packed-refs");
+
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	auto exists = ::GetFileAttributesEx(path.wstring().c_str(), GetFileExInfoStandard, &attributes) != FALSE;
+	auto size = exists ? (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow : 0;
+	auto lastWriteTime = exists
+		? (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime
+		: 0;
+
+	{
+		ReadLock readLock(m_packedRefsMutex);
+		auto packedRefs = m_packedRefs.find(repositoryPath);
+		if (packedRefs != m_packedRefs.end()
+			&& packedRefs->second->Exists == exists
+			&& packedRefs->second->Size == size
+			&& packedRefs->second->LastWriteTime == lastWriteTime)
+		{
+			return packedRefs->second;
+		}
+	}
+
+	std::shared_ptr<const PackedRefs> packedRefs;
+	if (exists)
+		packedRefs = RefResolver::LoadPackedRefs(path, size, lastWriteTime);
+	else
+		packedRefs = std::make_shared<const PackedRefs>();
+
+	if (packedRefs == nullptr)
+	{
+		Log("RefResolver.GetPackedRefs.FailedToLoad", Severity::Warning)
+			<< R"(Failed to map packed-refs. { "repositoryPath": ")" << repositoryPath << R"(" })";
+		return std::make_shared<const PackedRefs>();
+	}
+
+	WriteLock writeLock(m_packedRefsMutex);
+	m_packedRefs[repositoryPath] = packedRefs;
+	return packedRefs;
+}
+
+bool RefResolver::LookupPackedReference(const std::string& commonDirectory, const std::string& name, git_oid& oid)
+{
+	auto packedRefs = GetPackedRefs(commonDirectory);
+	const auto& names = packedRefs->Names;
+	auto entry = std::lower_bound(
+		packedRefs->Entries.begin(),
+		packedRefs->Entries.end(),
+		name,
+		[&names](const PackedRefs::Entry& left, const std::string& right)
+		{
+			return names.compare(left.NameOffset, left.NameLength, right) < 0;
+		});
+
+	if (entry == packedRefs->Entries.end() || names.compare(entry->NameOffset, entry->NameLength, name) != 0)
+		return false;
+
+	oid = entry->Oid;
+	return true;
+}
+
+bool RefResolver::ReadHead(const std::string& repositoryPath, std::string& symbolicTarget, git_oid& oid)
+{
+	std::string contents;
+	if (!RefResolver::ReadLooseReference(repositoryPath, "HEAD", contents))
+		return false;
+
+	const auto symbolicPrefix = std::string("ref: ");
+	if (contents.compare(0, symbolicPrefix.size(), symbolicPrefix) == 0)
+	{
+		symbolicTarget = contents.substr(symbolicPrefix.size());
+		return !symbolicTarget.empty();
+	}
+
+	symbolicTarget = std::string();
+	return RefResolver::ParseOid(contents.c_str(), contents.size(), oid);
+}
+
+bool RefResolver::ResolveReference(const std::string& repositoryPath, const std::string& commonDirectory, const std::string& name, git_oid& oid)
+{
+	const auto symbolicPrefix = std::string("ref: ");
+	auto currentName = name;
+	for (auto depth = 0; depth < MaximumSymbolicReferenceDepth; ++depth)
+	{
+		const auto& directory = RefResolver::IsPerWorktreeReference(currentName) ? repositoryPath : commonDirectory;
+		std::string contents;
+		if (!RefResolver::ReadLooseReference(directory, currentName, contents))
+			return LookupPackedReference(commonDirectory, currentName, oid);
+
+		if (contents.compare(0, symbolicPrefix.size(), symbolicPrefix) != 0)
+			return RefResolver::ParseOid(contents.c_str(), contents.size(), oid);
+
+		currentName = contents.substr(symbolicPrefix.size());
+	}
+
+	Log("RefResolver.ResolveReference.TooManySymbolicReferences", Severity::Warning)
+		<< R"(Failed to resolve nested symbolic references. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "name": ")" << name << R"(" })";
+	return false;
+}
+
+/*static*/ std::string RefResolver::GetShorthand(const std::string& name)
+{
+	for (const auto& prefix : { "refs/heads/", "refs/tags/", "refs/remotes/", "refs/" })
+	{
+		auto prefixLength = std::strlen(prefix);
+		if (name.size() > prefixLength && name.compare(0, prefixLength, prefix) == 0)
+			return name.substr(prefixLength);
+	}
+	return name;
+}
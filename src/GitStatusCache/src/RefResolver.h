@@ -0,0 +1,96 @@
+#pragma once
+
+/**
+* Resolves HEAD and references by reading the repository directory directly instead of going
+* through libgit2's refdb. Loose references are read on each lookup. packed-refs is parsed
+* into a sorted index once and only re-parsed when its size or last write time changes.
+* Linked worktrees share references and packed-refs through their common directory, so
+* packed-refs is indexed once per common directory no matter how many worktrees use it.
+* This class is thread-safe.
+*/
+class RefResolver : boost::noncopyable
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	/**
+	* Index of references in a packed-refs file. Names are stored back to back in Names
+	* and entries are sorted by name.
+	*/
+	struct PackedRefs
+	{
+		struct Entry
+		{
+			size_t NameOffset;
+			size_t NameLength;
+			git_oid Oid;
+		};
+
+		bool Exists = false;
+		uint64_t Size = 0;
+		uint64_t LastWriteTime = 0;
+		std::string Names;
+		std::vector<Entry> Entries;
+	};
+
+	/**
+	* Maximum number of symbolic references followed when resolving a reference.
+	*/
+	static const int MaximumSymbolicReferenceDepth = 5;
+
+	std::unordered_map<std::string, std::shared_ptr<const PackedRefs>> m_packedRefs;
+	boost::shared_mutex m_packedRefsMutex;
+
+	/**
+	* Reads first line of loose reference or HEAD. Returns false if it doesn't exist.
+	*/
+	static bool ReadLooseReference(const std::string& repositoryPath, const std::string& name, std::string& contents);
+
+	/**
+	* Parses oid from hex at start of contents.
+	*/
+	static bool ParseOid(const char* contents, size_t length, git_oid& oid);
+
+	/**
+	* Checks if reference is private to a worktree (ex. HEAD, refs/bisect/) instead of
+	* shared through the common directory.
+	*/
+	static bool IsPerWorktreeReference(const std::string& name);
+
+	/**
+	* Memory-maps packed-refs and builds sorted index of its references. Size and last write
+	* time identify the version of the file the index was requested for.
+	*/
+	static std::shared_ptr<const PackedRefs> LoadPackedRefs(const boost::filesystem::path& path, uint64_t size, uint64_t lastWriteTime);
+
+	/**
+	* Retrieves index of packed-refs, reloading it if the file changed.
+	*/
+	std::shared_ptr<const PackedRefs> GetPackedRefs(const std::string& repositoryPath);
+
+	/**
+	* Looks up reference in packed-refs of the common directory.
+	*/
+	bool LookupPackedReference(const std::string& commonDirectory, const std::string& name, git_oid& oid);
+
+public:
+	/**
+	* Reads HEAD. Sets symbolic target (ex. refs/heads/master) if HEAD is symbolic, otherwise sets
+	* target to empty string and oid to the detached commit. Returns false if HEAD can't be read.
+	*/
+	bool ReadHead(const std::string& repositoryPath, std::string& symbolicTarget, git_oid& oid);
+
+	/**
+	* Resolves reference (ex. refs/remotes/origin/master) to the oid it points to, following
+	* symbolic references. Shared references are read from the common directory and
+	* per-worktree references from the repository path. Returns false if the reference
+	* doesn't exist.
+	*/
+	bool ResolveReference(const std::string& repositoryPath, const std::string& commonDirectory, const std::string& name, git_oid& oid);
+
+	/**
+	* Returns short name for reference, ex. "master" for "refs/heads/master".
+	*/
+	static std::string GetShorthand(const std::string& name);
+};
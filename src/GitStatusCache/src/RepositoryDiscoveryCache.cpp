@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "RepositoryDiscoveryCache.h"
+
+/*static*/ std::vector<std::string> RepositoryDiscoveryCache::SplitPath(const std::string& path)
+{
+	std::vector<std::string> components;
+	std::string component;
+	for (auto character : path)
+	{
+		if (character == '/' || character == '\\')
+		{
+			if (!component.empty())
+				components.push_back(std::move(component));
+			component.clear();
+		}
+		else
+		{
+			component.push_back(static_cast<char>(::tolower(static_cast<unsigned char>(character))));
+		}
+	}
+
+	if (!component.empty())
+		components.push_back(std::move(component));
+	return components;
+}
+
+/*static*/ size_t RepositoryDiscoveryCache::CountEntries(const Node& node)
+{
+	size_t entries = node.HasResult ? 1 : 0;
+	for (const auto& child : node.Children)
+		entries += CountEntries(*child.second);
+	return entries;
+}
+
+bool RepositoryDiscoveryCache::TryGetRepositoryPath(const std::string& path, std::string& repositoryPath)
+{
+	auto components = RepositoryDiscoveryCache::SplitPath(path);
+
+	ReadLock readLock(m_rootMutex);
+	const Node* node = &m_root;
+	for (const auto& component : components)
+	{
+		auto child = node->Children.find(component);
+		if (child == node->Children.end())
+			return false;
+		node = child->second.get();
+	}
+
+	if (!node->HasResult)
+		return false;
+	if (node->RepositoryPath.empty() && Clock::now() >= node->ExpirationTime)
+		return false;
+
+	repositoryPath = node->RepositoryPath;
+	return true;
+}
+
+void RepositoryDiscoveryCache::Add(const std::string& path, const std::string& repositoryPath)
+{
+	auto components = RepositoryDiscoveryCache::SplitPath(path);
+
+	WriteLock writeLock(m_rootMutex);
+	if (m_entries >= MaximumEntries)
+	{
+		Log("RepositoryDiscoveryCache.Add.Full", Severity::Verbose)
+			<< R"(Clearing repository discovery cache. { "entries": )" << m_entries << R"( })";
+		m_root.Children.clear();
+		m_root.HasResult = false;
+		m_entries = 0;
+	}
+
+	auto node = &m_root;
+	for (const auto& component : components)
+	{
+		auto& child = node->Children[component];
+		if (child == nullptr)
+			child = std::make_unique<Node>();
+		node = child.get();
+	}
+
+	if (!node->HasResult)
+		++m_entries;
+	node->HasResult = true;
+	node->RepositoryPath = repositoryPath;
+	node->ExpirationTime = Clock::now() + std::chrono::milliseconds(NegativeEntryLifetimeInMilliseconds);
+}
+
+void RepositoryDiscoveryCache::InvalidateDirectory(const std::string& directory)
+{
+	auto components = RepositoryDiscoveryCache::SplitPath(directory);
+
+	WriteLock writeLock(m_rootMutex);
+	auto node = &m_root;
+	for (const auto& component : components)
+	{
+		auto child = node->Children.find(component);
+		if (child == node->Children.end())
+			return;
+		node = child->second.get();
+	}
+
+	auto invalidatedEntries = RepositoryDiscoveryCache::CountEntries(*node);
+	if (invalidatedEntries == 0)
+		return;
+
+	node->Children.clear();
+	node->HasResult = false;
+	node->RepositoryPath.clear();
+	m_entries -= invalidatedEntries;
+
+	Log("RepositoryDiscoveryCache.InvalidateDirectory", Severity::Verbose)
+		<< R"(Invalidated repository discovery results. { "directory": ")" << directory
+		<< R"(", "entries": )" << invalidatedEntries << R"( })";
+}
+
+void RepositoryDiscoveryCache::Clear()
+{
+	WriteLock writeLock(m_rootMutex);
+	m_root.Children.clear();
+	m_root.HasResult = false;
+	m_root.RepositoryPath.clear();
+	m_entries = 0;
+}
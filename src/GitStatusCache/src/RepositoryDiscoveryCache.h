@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+
+/**
+* Caches which repository, if any, owns a directory. Directories are stored in a trie so a
+* change to a .git entry can drop results for the directory and everything below it.
+* Results for directories outside any repository can't be invalidated by monitored
+* directories, so they expire after a short time instead.
+* This class is thread-safe.
+*/
+class RepositoryDiscoveryCache : boost::noncopyable
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	* Directory in the trie. Children are keyed by lowercase path component.
+	*/
+	struct Node
+	{
+		std::unordered_map<std::string, std::unique_ptr<Node>> Children;
+		bool HasResult = false;
+		std::string RepositoryPath;
+		Clock::time_point ExpirationTime;
+	};
+
+	/**
+	* Number of cached results after which the cache is cleared.
+	*/
+	static const size_t MaximumEntries = 10000;
+
+	/**
+	* Time results for directories outside any repository are trusted.
+	*/
+	static const uint32_t NegativeEntryLifetimeInMilliseconds = 5000;
+
+	Node m_root;
+	size_t m_entries = 0;
+	boost::shared_mutex m_rootMutex;
+
+	/**
+	* Splits path into lowercase components, ignoring separators and trailing slashes.
+	*/
+	static std::vector<std::string> SplitPath(const std::string& path);
+
+	/**
+	* Counts results in subtree.
+	*/
+	static size_t CountEntries(const Node& node);
+
+public:
+	/**
+	* Looks up cached repository for path. Returns false if there is no usable cached result.
+	* On success, repository path is empty if path isn't part of a repository.
+	*/
+	bool TryGetRepositoryPath(const std::string& path, std::string& repositoryPath);
+
+	/**
+	* Records repository for path. Empty repository path records that path isn't part of a repository.
+	*/
+	void Add(const std::string& path, const std::string& repositoryPath);
+
+	/**
+	* Discards cached results for directory and everything below it.
+	*/
+	void InvalidateDirectory(const std::string& directory);
+
+	/**
+	* Discards all cached results.
+	*/
+	void Clear();
+};
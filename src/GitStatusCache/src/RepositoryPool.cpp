@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "RepositoryPool.h"
+
+RepositoryPool::Lease::Lease(RepositoryPool* pool, const std::string& repositoryPath, uint64_t generation, UniqueGitRepository&& repository)
+	: m_pool(pool)
+	, m_repositoryPath(repositoryPath)
+	, m_generation(generation)
+	, m_repository(std::move(repository))
+{
+}
+
+RepositoryPool::Lease::Lease(Lease&& other)
+	: m_pool(other.m_pool)
+	, m_repositoryPath(std::move(other.m_repositoryPath))
+	, m_generation(other.m_generation)
+	, m_repository(std::move(other.m_repository))
+{
+	other.m_pool = nullptr;
+}
+
+RepositoryPool::Lease::~Lease()
+{
+	if (m_pool != nullptr && m_repository.get() != nullptr)
+		m_pool->Return(m_repositoryPath, m_generation, std::move(m_repository));
+}
+
+RepositoryPool::RepositoryPool(size_t maximumIdleRepositoriesPerPath)
+	: m_maximumIdleRepositoriesPerPath(maximumIdleRepositoriesPerPath)
+{
+}
+
+RepositoryPool::~RepositoryPool()
+{
+	Clear();
+}
+
+RepositoryPool::Lease RepositoryPool::Checkout(const std::string& repositoryPath)
+{
+	WriteLock writeLock(m_poolMutex);
+	auto& entry = m_pool[repositoryPath];
+	while (!entry.IdleRepositories.empty())
+	{
+		auto idleRepository = std::move(entry.IdleRepositories.back());
+		entry.IdleRepositories.pop_back();
+		if (idleRepository.Generation == entry.Generation)
+		{
+			Log("RepositoryPool.Checkout.Reuse", Severity::Spam)
+				<< R"(Reusing open repository handle. { "repositoryPath": ")" << repositoryPath << R"(" })";
+			return Lease(this, repositoryPath, entry.Generation, std::move(idleRepository.Repository));
+		}
+	}
+
+	return Lease(this, repositoryPath, entry.Generation, MakeUniqueGitRepository(nullptr));
+}
+
+void RepositoryPool::Return(const std::string& repositoryPath, uint64_t generation, UniqueGitRepository&& repository)
+{
+	auto sizeInBytes = RepositoryPool::GetSizeInBytes(repository.get());
+
+	WriteLock writeLock(m_poolMutex);
+	auto& entry = m_pool[repositoryPath];
+	if (generation != entry.Generation || entry.IdleRepositories.size() >= m_maximumIdleRepositoriesPerPath)
+		return;
+
+	entry.IdleRepositories.emplace_back(IdleRepository{ generation, std::move(repository), sizeInBytes });
+}
+
+uint64_t RepositoryPool::GetSizeInBytes(const std::string& repositoryPath)
+{
+	ReadLock readLock(m_poolMutex);
+	auto entry = m_pool.find(repositoryPath);
+	if (entry == m_pool.end())
+		return 0;
+
+	auto size = uint64_t{ 0 };
+	for (const auto& idleRepository : entry->second.IdleRepositories)
+		size += idleRepository.SizeInBytes;
+	return size;
+}
+
+/*static*/ uint64_t RepositoryPool::GetSizeInBytes(git_repository* repository)
+{
+	git_index* index = nullptr;
+	if (git_repository_index(&index, repository) != GIT_OK)
+		return 0;
+	auto uniqueIndex = MakeUniqueGitIndex(index);
+
+	// Each entry is allocated with its path and referenced from the entry vector and the
+	// path map.
+	auto entryCount = git_index_entrycount(index);
+	auto size = uint64_t{ entryCount } * (sizeof(git_index_entry) + 3 * sizeof(void*));
+	for (auto i = size_t{ 0 }; i < entryCount; ++i)
+		size += std::strlen(git_index_get_byindex(index, i)->path) + 1;
+	return size;
+}
+
+void RepositoryPool::Reload(const std::string& repositoryPath)
+{
+	std::vector<IdleRepository> repositoriesToFree;
+	{
+		WriteLock writeLock(m_poolMutex);
+		auto& entry = m_pool[repositoryPath];
+		++entry.Generation;
+		entry.IdleRepositories.swap(repositoriesToFree);
+	}
+
+	Log("RepositoryPool.Reload", Severity::Verbose)
+		<< R"(Discarded open repository handles. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "handlesDiscarded": )" << repositoriesToFree.size() << R"( })";
+}
+
+void RepositoryPool::Clear()
+{
+	WriteLock writeLock(m_poolMutex);
+	for (auto& entry : m_pool)
+	{
+		++entry.second.Generation;
+		entry.second.IdleRepositories.clear();
+	}
+}
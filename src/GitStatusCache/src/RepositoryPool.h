@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+* Pool of open libgit2 repository handles keyed by repository path. Reusing handles
+* avoids reloading config, index, refdb, and odb caches for every status computation.
+* Each handle is checked out by a single thread at a time.
+* This class is thread-safe.
+*/
+class RepositoryPool : boost::noncopyable
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	/**
+	* Open handle waiting to be checked out. SizeInBytes estimates memory held by its index.
+	*/
+	struct IdleRepository
+	{
+		uint64_t Generation;
+		UniqueGitRepository Repository;
+		uint64_t SizeInBytes;
+	};
+
+	/**
+	* Handles for a single repository. Generation is incremented whenever the repository's
+	* handles must be reloaded. Handles opened for older generations are discarded.
+	*/
+	struct PoolEntry
+	{
+		uint64_t Generation = 0;
+		std::vector<IdleRepository> IdleRepositories;
+	};
+
+	const size_t m_maximumIdleRepositoriesPerPath;
+	std::unordered_map<std::string, PoolEntry> m_pool;
+	boost::shared_mutex m_poolMutex;
+
+public:
+	/**
+	* Exclusive use of a repository handle. Returns handle to the pool on destruction.
+	*/
+	class Lease : boost::noncopyable
+	{
+	private:
+		RepositoryPool* m_pool;
+		std::string m_repositoryPath;
+		uint64_t m_generation;
+		UniqueGitRepository m_repository;
+
+	public:
+		Lease(RepositoryPool* pool, const std::string& repositoryPath, uint64_t generation, UniqueGitRepository&& repository);
+		Lease(Lease&& other);
+		~Lease();
+
+		/**
+		* Returns leased handle. Handle is null if the pool had no idle handle for the
+		* repository. Callers should open the repository into the returned handle.
+		*/
+		UniqueGitRepository& Get() { return m_repository; }
+	};
+
+	/**
+	* Constructor.
+	* @param maximumIdleRepositoriesPerPath Maximum number of idle handles retained for each repository.
+	*/
+	RepositoryPool(size_t maximumIdleRepositoriesPerPath);
+	~RepositoryPool();
+
+	/**
+	* Checks out a handle for the repository at provided path.
+	*/
+	Lease Checkout(const std::string& repositoryPath);
+
+	/**
+	* Discards handles for the repository at provided path. Handles currently checked out
+	* are discarded when they are returned.
+	*/
+	void Reload(const std::string& repositoryPath);
+
+	/**
+	* Discards all idle handles.
+	*/
+	void Clear();
+
+	/**
+	* Estimates bytes held by idle handles for the repository at provided path.
+	*/
+	uint64_t GetSizeInBytes(const std::string& repositoryPath);
+
+private:
+	/**
+	* Estimates bytes held by handle's index. Index is only loaded by handles that computed
+	* status, which is what nearly every returned handle did.
+	*/
+	static uint64_t GetSizeInBytes(git_repository* repository);
+
+	/**
+	* Returns handle to the pool if it's still current.
+	*/
+	void Return(const std::string& repositoryPath, uint64_t generation, UniqueGitRepository&& repository);
+};
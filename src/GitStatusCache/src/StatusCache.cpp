@@ -1,22 +1,117 @@
-#include "stdafx.h"
-#include "StatusCache.h"
-
-StatusCache::StatusCache()
-	: m_cache(std::make_shared<Cache>())
-	, m_cacheInvalidator(m_cache)
-{
-}
-
-std::tuple<bool, Git::Status> StatusCache::GetStatus(const std::string& repositoryPath)
-{
-	auto status = m_cache->GetStatus(repositoryPath);
-	if (std::get<0>(status))
-		m_cacheInvalidator.MonitorRepositoryDirectories(std::get<1>(status));
-
-	return status;
-}
-
-CacheStatistics StatusCache::GetCacheStatistics()
-{
-	return m_cache->GetCacheStatistics();
+#include "stdafx.h"
+#include "StatusCache.h"
+
+StatusCache::StatusCache(const GitSettings& gitSettings)
+	: m_cache(new Cache(gitSettings))
+	, m_discoveryCache(std::make_shared<RepositoryDiscoveryCache>())
+	, m_cacheInvalidator(m_cache, m_discoveryCache)
+{
+	if (!gitSettings.CacheSnapshotPath.empty())
+	{
+		m_persistentCache = std::make_unique<PersistentCache>(m_cache, gitSettings.CacheSnapshotPath, gitSettings.CacheSnapshotIntervalInSeconds);
+		StatusCache::RestorePersistedStatuses();
+	}
+}
+
+void StatusCache::RestorePersistedStatuses()
+{
+	auto restoredStatuses = size_t{ 0 };
+	auto persistedStatuses = m_persistentCache->Load();
+	for (const auto& persistedStatus : persistedStatuses)
+	{
+		// Monitored before the fingerprint is checked so changes made after the check
+		// invalidate the restored status. The fingerprint doesn't cover every file, so
+		// restored statuses are recomputed in the background to verify them. Statuses that
+		// can't be restored get an empty entry so priming computes them.
+		m_cacheInvalidator.MonitorRepositoryDirectories(persistedStatus.Status);
+		if (m_persistentCache->Restore(persistedStatus))
+			++restoredStatuses;
+		else
+			m_cache->AddCacheEntry(persistedStatus.Status.RepositoryPath);
+		m_cacheInvalidator.SchedulePriming(persistedStatus.Status.RepositoryPath);
+	}
+
+	Log("StatusCache.RestorePersistedStatuses", Severity::Info)
+		<< R"(Restored persisted statuses. { "restored": )" << restoredStatuses
+		<< R"(, "primed": )" << persistedStatuses.size() << R"( })";
+}
+
+std::tuple<bool, std::string> StatusCache::DiscoverRepository(const std::string& path)
+{
+	std::string repositoryPath;
+	if (m_discoveryCache->TryGetRepositoryPath(path, repositoryPath))
+		return std::make_tuple(!repositoryPath.empty(), std::move(repositoryPath));
+
+	auto discoveredRepository = m_cache->DiscoverRepository(path);
+	m_discoveryCache->Add(path, std::get<1>(discoveredRepository));
+	return discoveredRepository;
+}
+
+std::tuple<bool, std::shared_ptr<const Git::Status>> StatusCache::GetStatus(const std::string& repositoryPath, uint32_t components, bool joinComputation)
+{
+	auto status = m_cache->GetStatus(repositoryPath, components, joinComputation);
+	if (std::get<0>(status))
+		m_cacheInvalidator.MonitorRepositoryDirectories(*std::get<1>(status));
+	else
+		m_discoveryCache->Clear();
+
+	return status;
+}
+
+std::tuple<bool, std::shared_ptr<const Git::Status>> StatusCache::GetStatusProgressively(const std::string& repositoryPath, uint32_t components)
+{
+	static const uint32_t deferredComponents = Git::FileStatusComponent | Git::SubmoduleComponent;
+
+	// Cached status that includes deferred components is returned whole. Doesn't wait on a
+	// computation of the deferred components that's already in progress.
+	auto status = GetStatus(repositoryPath, components & ~deferredComponents, false /*joinComputation*/);
+	if (std::get<0>(status) && (std::get<1>(status)->Components & components) != components)
+		m_cacheInvalidator.SchedulePriming(repositoryPath);
+
+	return status;
+}
+
+std::shared_ptr<const Git::Status> StatusCache::GetStaleStatus(
+	const std::string& repositoryPath,
+	uint32_t components,
+	std::chrono::milliseconds maximumStaleness,
+	bool& isStale,
+	std::chrono::milliseconds& staleness)
+{
+	auto status = m_cache->GetStaleStatus(repositoryPath, components, maximumStaleness, isStale, staleness);
+	if (status != nullptr && isStale)
+		m_cacheInvalidator.SchedulePriming(repositoryPath);
+
+	return status;
+}
+
+std::tuple<bool, std::string> StatusCache::GetRenderedStatus(
+	const std::string& repositoryPath,
+	const std::string& key,
+	uint32_t components,
+	const std::function<std::string(const Git::Status&)>& render)
+{
+	return m_cache->GetRenderedStatus(
+		repositoryPath,
+		key,
+		components,
+		[this, &render](const Git::Status& status)
+		{
+			m_cacheInvalidator.MonitorRepositoryDirectories(status);
+			return render(status);
+		});
+}
+
+std::tuple<bool, ChangeJournal::Changes> StatusCache::GetChangesSince(const std::string& repositoryPath, const std::string& token)
+{
+	auto status = GetStatus(repositoryPath, 0);
+	if (!std::get<0>(status))
+		return std::make_tuple(false, ChangeJournal::Changes());
+
+	return std::make_tuple(true, m_cacheInvalidator.GetChangesSince(*std::get<1>(status), token));
+}
+
+CacheStatistics StatusCache::GetCacheStatistics()
+{
+	return m_cache->GetCacheStatistics();
 }
\ No newline at end of file
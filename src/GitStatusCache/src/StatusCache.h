@@ -1,27 +1,84 @@
-#pragma once
-#include "Cache.h"
-#include "CacheInvalidator.h"
-
-/**
- * Caches git status information. This class is thread-safe.
- */
-class StatusCache : boost::noncopyable
-{
-private:
-	std::shared_ptr<Cache> m_cache;
-	CacheInvalidator m_cacheInvalidator;
-
-public:
-	StatusCache();
-
-	/**
-	* Retrieves current git status for repository at provided path.
-	* Returns from cache if present, otherwise queries git and adds to cache.
-	*/
-	std::tuple<bool, Git::Status> GetStatus(const std::string& repositoryPath);
-
-	/**
-	* Returns information about cache's performance.
-	*/
-	CacheStatistics GetCacheStatistics();
+#pragma once
+#include "Cache.h"
+#include "CacheInvalidator.h"
+#include "PersistentCache.h"
+
+/**
+ * Caches git status information. This class is thread-safe.
+ */
+class StatusCache : boost::noncopyable
+{
+private:
+	std::shared_ptr<Cache> m_cache;
+	std::shared_ptr<RepositoryDiscoveryCache> m_discoveryCache;
+	CacheInvalidator m_cacheInvalidator;
+	std::unique_ptr<PersistentCache> m_persistentCache;
+
+	/**
+	* Restores statuses persisted by a previous run. Changed repositories are primed in the
+	* background. Every persisted repository is monitored.
+	*/
+	void RestorePersistedStatuses();
+
+public:
+	StatusCache(const GitSettings& gitSettings);
+
+	/**
+	* Searches for repository containing provided path.
+	* Returns from cache if present, otherwise searches the file system and adds to cache.
+	*/
+	std::tuple<bool, std::string> DiscoverRepository(const std::string& path);
+
+	/**
+	* Retrieves current git status for repository at provided path.
+	* Returns from cache if present, otherwise queries git and adds to cache.
+	* Components that weren't requested may be missing from the returned status.
+	* Returned status is shared with the cache and never modified. Waits on a computation
+	* already in progress for the repository unless joinComputation is false.
+	*/
+	std::tuple<bool, std::shared_ptr<const Git::Status>> GetStatus(
+		const std::string& repositoryPath,
+		uint32_t components = Git::AllComponents,
+		bool joinComputation = true);
+
+	/**
+	* Retrieves current git status for repository at provided path without waiting on file
+	* status or submodules if they aren't cached. Missing components are computed in the
+	* background and are absent from the returned status's components.
+	*/
+	std::tuple<bool, std::shared_ptr<const Git::Status>> GetStatusProgressively(const std::string& repositoryPath, uint32_t components);
+
+	/**
+	* Retrieves cached status for repository at provided path even if it was invalidated no
+	* longer than maximumStaleness ago. Sets isStale if it was invalidated and staleness to how
+	* long ago that was. Invalidated status is refreshed in the background. Returns nullptr if
+	* no such status is cached.
+	*/
+	std::shared_ptr<const Git::Status> GetStaleStatus(
+		const std::string& repositoryPath,
+		uint32_t components,
+		std::chrono::milliseconds maximumStaleness,
+		bool& isStale,
+		std::chrono::milliseconds& staleness);
+
+	/**
+	* Retrieves status for repository at provided path rendered by the provided function.
+	* Rendered result is memoized by key until the repository changes.
+	*/
+	std::tuple<bool, std::string> GetRenderedStatus(
+		const std::string& repositoryPath,
+		const std::string& key,
+		uint32_t components,
+		const std::function<std::string(const Git::Status&)>& render);
+
+	/**
+	* Retrieves paths in the working directory of repository at provided path changed since
+	* token. Starts monitoring the repository if needed.
+	*/
+	std::tuple<bool, ChangeJournal::Changes> GetChangesSince(const std::string& repositoryPath, const std::string& token);
+
+	/**
+	* Returns information about cache's performance.
+	*/
+	CacheStatistics GetCacheStatistics();
 };
\ No newline at end of file
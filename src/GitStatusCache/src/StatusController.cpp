@@ -1,297 +1,679 @@
-#include "stdafx.h"
-#include "StatusController.h"
-#include <boost/algorithm/string.hpp>
-#include <boost/timer/timer.hpp>
-
-StatusController::StatusController()
-	: m_startTime(boost::posix_time::second_clock::universal_time())
-	, m_requestShutdown(MakeUniqueHandle(INVALID_HANDLE_VALUE))
-{
-	auto requestShutdown = ::CreateEvent(
-		nullptr /*lpEventAttributes*/,
-		true    /*manualReset*/,
-		false   /*bInitialState*/,
-		nullptr /*lpName*/);
-	if (requestShutdown == nullptr)
-	{
-		Log("StatusController.Constructor.CreateEventFailed", Severity::Error)
-			<< "Failed to create event to signal shutdown request.";
-		throw std::runtime_error("CreateEvent failed unexpectedly.");
-	}
-	m_requestShutdown = MakeUniqueHandle(requestShutdown);
-}
-
-StatusController::~StatusController()
-{
-}
-
-/*static*/ void StatusController::AddStringToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, std::string&& value)
-{
-	writer.String(name.c_str());
-	writer.String(value.c_str());
-}
-
-/*static*/ void StatusController::AddBoolToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, bool value)
-{
-	writer.String(name.c_str());
-	writer.Bool(value);
-}
-
-/*static*/ void StatusController::AddUintToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint32_t value)
-{
-	writer.String(name.c_str());
-	writer.Uint(value);
-}
-
-/*static*/ void StatusController::AddUint64ToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint64_t value)
-{
-	writer.String(name.c_str());
-	writer.Uint64(value);
-}
-
-/*static*/ void StatusController::AddDoubleToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, double value)
-{
-	writer.String(name.c_str());
-	writer.Double(value);
-}
-
-/*static*/ void StatusController::AddArrayToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const std::vector<std::string>& values)
-{
-	writer.String(name.c_str());
-	writer.StartArray();
-	for (const auto& value : values)
-		writer.String(value.c_str());
-	writer.EndArray();
-}
-
-/*static*/ void StatusController::AddVersionToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer)
-{
-	AddUintToJson(writer, "Version", 1);
-}
-
-/*static*/ std::string StatusController::CreateErrorResponse(const std::string& request, std::string&& error)
-{
-	Log("StatusController.FailedRequest", Severity::Warning)
-		<< R"(Failed to service request. { "error": ")" << error << R"(", "request": ")" << request << R"(" })";
-
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
-
-	writer.StartObject();
-	AddVersionToJson(writer);
-	AddStringToJson(writer, "Error", std::move(error));
-	writer.EndObject();
-
-	return buffer.GetString();
-}
-
-void StatusController::RecordGetStatusTime(uint64_t nanosecondsInGetStatus)
-{
-	WriteLock writeLock{m_getStatusStatisticsMutex};
-	++m_totalGetStatusCalls;
-	m_totalNanosecondsInGetStatus += nanosecondsInGetStatus;
-	m_minNanosecondsInGetStatus = (std::min)(nanosecondsInGetStatus, m_minNanosecondsInGetStatus);
-	m_maxNanosecondsInGetStatus = (std::max)(nanosecondsInGetStatus, m_maxNanosecondsInGetStatus);
-}
-
-std::string StatusController::GetStatus(const rapidjson::Document& document, const std::string& request)
-{
-	if (!document.HasMember("Path") || !document["Path"].IsString())
-	{
-		return CreateErrorResponse(request, "'Path' must be specified.");
-	}
-	auto path = std::string(document["Path"].GetString());
-
-	auto repositoryPath = m_git.DiscoverRepository(path);
-	if (!std::get<0>(repositoryPath))
-	{
-		return CreateErrorResponse(request, "Requested 'Path' is not part of a git repository.");
-	}
-
-	auto status = m_cache.GetStatus(std::get<1>(repositoryPath));
-	if (!std::get<0>(status))
-	{
-		return CreateErrorResponse(request, "Failed to retrieve status of git repository at provided 'Path'.");
-	}
-
-	auto& statusToReport = std::get<1>(status);
-
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
-
-	writer.StartObject();
-
-	AddVersionToJson(writer);
-	AddStringToJson(writer, "Path", path.c_str());
-	AddStringToJson(writer, "RepoPath", statusToReport.RepositoryPath.c_str());
-	AddStringToJson(writer, "WorkingDir", statusToReport.WorkingDirectory.c_str());
-	AddStringToJson(writer, "State", statusToReport.State.c_str());
-	AddStringToJson(writer, "Branch", statusToReport.Branch.c_str());
-	AddStringToJson(writer, "Upstream", statusToReport.Upstream.c_str());
-	AddBoolToJson(writer, "UpstreamGone", statusToReport.UpstreamGone);
-	AddUintToJson(writer, "AheadBy", statusToReport.AheadBy);
-	AddUintToJson(writer, "BehindBy", statusToReport.BehindBy);
-
-	AddArrayToJson(writer, "IndexAdded", statusToReport.IndexAdded);
-	AddArrayToJson(writer, "IndexModified", statusToReport.IndexModified);
-	AddArrayToJson(writer, "IndexDeleted", statusToReport.IndexDeleted);
-	AddArrayToJson(writer, "IndexTypeChange", statusToReport.IndexTypeChange);
-	writer.String("IndexRenamed");
-	writer.StartArray();
-	for (const auto& value : statusToReport.IndexRenamed)
-	{
-		writer.StartObject();
-		writer.String("Old");
-		writer.String(value.first.c_str());
-		writer.String("New");
-		writer.String(value.second.c_str());
-		writer.EndObject();
-	}
-	writer.EndArray();
-
-	AddArrayToJson(writer, "WorkingAdded", statusToReport.WorkingAdded);
-	AddArrayToJson(writer, "WorkingModified", statusToReport.WorkingModified);
-	AddArrayToJson(writer, "WorkingDeleted", statusToReport.WorkingDeleted);
-	AddArrayToJson(writer, "WorkingTypeChange", statusToReport.WorkingTypeChange);
-	writer.String("WorkingRenamed");
-	writer.StartArray();
-	for (const auto& value : statusToReport.WorkingRenamed)
-	{
-		writer.StartObject();
-		writer.String("Old");
-		writer.String(value.first.c_str());
-		writer.String("New");
-		writer.String(value.second.c_str());
-		writer.EndObject();
-	}
-	writer.EndArray();
-	AddArrayToJson(writer, "WorkingUnreadable", statusToReport.WorkingUnreadable);
-
-	AddArrayToJson(writer, "Ignored", statusToReport.Ignored);
-	AddArrayToJson(writer, "Conflicted", statusToReport.Conflicted);
-
-	writer.String("Stashes");
-	writer.StartArray();
-	for (const auto& value : statusToReport.Stashes)
-	{
-		writer.StartObject();
-		writer.String("Name");
-		std::string name = "stash@{";
-		name += std::to_string(value.Index);
-		name += "}";
-		writer.String(name.c_str());
-		writer.String("Sha1Id");
-		writer.String(value.Sha1Id.c_str());
-		writer.String("Message");
-		writer.String(value.Message.c_str());
-		writer.EndObject();
-	}
-	writer.EndArray();
-
-	writer.EndObject();
-
-	return buffer.GetString();
-}
-
-std::string StatusController::GetCacheStatistics()
-{
-	auto statistics = m_cache.GetCacheStatistics();
-
-	static const int nanosecondsPerMillisecond = 1000000;
-	uint64_t totalGetStatusCalls;
-	uint64_t totalNanosecondsInGetStatus;
-	uint64_t minNanosecondsInGetStatus;
-	uint64_t maxNanosecondsInGetStatus;
-	{
-		ReadLock readLock{m_getStatusStatisticsMutex};
-		totalGetStatusCalls = m_totalGetStatusCalls;
-		totalNanosecondsInGetStatus = m_totalNanosecondsInGetStatus;
-		minNanosecondsInGetStatus = m_minNanosecondsInGetStatus;
-		maxNanosecondsInGetStatus = m_maxNanosecondsInGetStatus;
-	}
-	
-	auto averageNanosecondsInGetStatus = totalGetStatusCalls != 0 ? totalNanosecondsInGetStatus / totalGetStatusCalls : 0;
-	auto averageMillisecondsInGetStatus = static_cast<double>(averageNanosecondsInGetStatus) / nanosecondsPerMillisecond;
-	auto minMillisecondsInGetStatus = static_cast<double>(minNanosecondsInGetStatus) / nanosecondsPerMillisecond;
-	auto maxMillisecondsInGetStatus = static_cast<double>(maxNanosecondsInGetStatus) / nanosecondsPerMillisecond;
-
-	auto currentTime = boost::posix_time::second_clock::universal_time();
-	auto uptime = boost::posix_time::to_simple_string(currentTime - m_startTime);
-
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
-
-	writer.StartObject();
-	AddVersionToJson(writer);
-	AddStringToJson(writer, "Uptime", std::move(uptime));
-	AddUint64ToJson(writer, "TotalGetStatusRequests", totalGetStatusCalls);
-	AddDoubleToJson(writer, "AverageMillisecondsInGetStatus", averageMillisecondsInGetStatus);
-	AddDoubleToJson(writer, "MinimumMillisecondsInGetStatus", minMillisecondsInGetStatus);
-	AddDoubleToJson(writer, "MaximumMillisecondsInGetStatus", maxMillisecondsInGetStatus);
-	AddUint64ToJson(writer, "CacheHits",  statistics.CacheHits);
-	AddUint64ToJson(writer, "CacheMisses", statistics.CacheMisses);
-	AddUint64ToJson(writer, "EffectiveCachePrimes", statistics.CacheEffectivePrimeRequests);
-	AddUint64ToJson(writer, "TotalCachePrimes", statistics.CacheTotalPrimeRequests);
-	AddUint64ToJson(writer, "EffectiveCacheInvalidations", statistics.CacheEffectiveInvalidationRequests);
-	AddUint64ToJson(writer, "TotalCacheInvalidations", statistics.CacheTotalInvalidationRequests);
-	AddUint64ToJson(writer, "FullCacheInvalidations", statistics.CacheInvalidateAllRequests);
-	writer.EndObject();
-
-	return buffer.GetString();
-}
-
-std::string StatusController::Shutdown()
-{
-	Log("StatusController.Shutdown", Severity::Info) << R"(Shutting down due to client request.")";
-	::SetEvent(m_requestShutdown);
-
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer{ buffer };
-
-	writer.StartObject();
-	AddVersionToJson(writer);
-	AddStringToJson(writer, "Result", "Shutting down.");
-	writer.EndObject();
-
-	return buffer.GetString();
-}
-
-std::string StatusController::HandleRequest(const std::string& request)
-{
-	rapidjson::Document document;
-	const auto& parser = document.Parse(request.c_str());
-	if (parser.HasParseError())
-		return CreateErrorResponse(request, "Request must be valid JSON.");
-
-	if (!document.HasMember("Version") || !document["Version"].IsUint())
-		return CreateErrorResponse(request, "'Version' must be specified.");
-	auto version = document["Version"].GetUint();
-
-	if (version != 1)
-		return CreateErrorResponse(request, "Requested 'Version' unknown.");
-
-	if (!document.HasMember("Action") || !document["Action"].IsString())
-		return CreateErrorResponse(request, "'Action' must be specified.");
-	auto action = std::string(document["Action"].GetString());
-
-	if (boost::iequals(action, "GetStatus"))
-	{
-		boost::timer::cpu_timer timer;
-		auto result = GetStatus(document, request);
-		RecordGetStatusTime(timer.elapsed().wall);
-		return result;
-	}
-
-	if (boost::iequals(action, "GetCacheStatistics"))
-		return GetCacheStatistics();
-
-	if (boost::iequals(action, "Shutdown"))
-		return Shutdown();
-
-	return CreateErrorResponse(request, "'Action' unrecognized.");
-}
-
-void StatusController::WaitForShutdownRequest()
-{
-	::WaitForSingleObject(m_requestShutdown, INFINITE);
+#include "stdafx.h"
+#include "StatusController.h"
+#include <boost/algorithm/string.hpp>
+#include <boost/timer/timer.hpp>
+
+StatusController::StatusController(const GitSettings& gitSettings)
+	: m_startTime(boost::posix_time::second_clock::universal_time())
+	, m_cache(gitSettings)
+	, m_requestShutdown(MakeUniqueHandle(INVALID_HANDLE_VALUE))
+	, m_maximumPathsPerCategory(gitSettings.MaximumPathsPerCategory)
+	, m_maximumStalenessInMilliseconds(gitSettings.MaximumStalenessInMilliseconds)
+{
+	auto requestShutdown = ::CreateEvent(
+		nullptr /*lpEventAttributes*/,
+		true    /*manualReset*/,
+		false   /*bInitialState*/,
+		nullptr /*lpName*/);
+	if (requestShutdown == nullptr)
+	{
+		Log("StatusController.Constructor.CreateEventFailed", Severity::Error)
+			<< "Failed to create event to signal shutdown request.";
+		throw std::runtime_error("CreateEvent failed unexpectedly.");
+	}
+	m_requestShutdown = MakeUniqueHandle(requestShutdown);
+}
+
+StatusController::~StatusController()
+{
+}
+
+/*static*/ void StatusController::AddStringToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, std::string&& value)
+{
+	writer.String(name.c_str());
+	writer.String(value.c_str());
+}
+
+/*static*/ void StatusController::AddBoolToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, bool value)
+{
+	writer.String(name.c_str());
+	writer.Bool(value);
+}
+
+/*static*/ void StatusController::AddUintToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint32_t value)
+{
+	writer.String(name.c_str());
+	writer.Uint(value);
+}
+
+/*static*/ void StatusController::AddUint64ToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint64_t value)
+{
+	writer.String(name.c_str());
+	writer.Uint64(value);
+}
+
+/*static*/ void StatusController::AddDoubleToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, double value)
+{
+	writer.String(name.c_str());
+	writer.Double(value);
+}
+
+/*static*/ void StatusController::AddArrayToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const std::vector<std::string>& values)
+{
+	writer.String(name.c_str());
+	writer.StartArray();
+	for (const auto& value : values)
+		writer.String(value.c_str());
+	writer.EndArray();
+}
+
+/*static*/ bool StatusController::AddArrayToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const FileStatus::PathRange& values, uint32_t maximumPaths)
+{
+	auto count = size_t{ 0 };
+	writer.String(name.c_str());
+	writer.StartArray();
+	for (auto value : values)
+	{
+		if (maximumPaths != 0 && count++ == maximumPaths)
+			break;
+		writer.String(value.data(), static_cast<rapidjson::SizeType>(value.size()));
+	}
+	writer.EndArray();
+	return maximumPaths != 0 && values.size() > maximumPaths;
+}
+
+/*static*/ bool StatusController::AddRenamesToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const FileStatus::RenameRange& values, uint32_t maximumPaths)
+{
+	auto count = size_t{ 0 };
+	writer.String(name.c_str());
+	writer.StartArray();
+	for (auto value : values)
+	{
+		if (maximumPaths != 0 && count++ == maximumPaths)
+			break;
+		writer.StartObject();
+		writer.String("Old");
+		writer.String(value.first.data(), static_cast<rapidjson::SizeType>(value.first.size()));
+		writer.String("New");
+		writer.String(value.second.data(), static_cast<rapidjson::SizeType>(value.second.size()));
+		writer.EndObject();
+	}
+	writer.EndArray();
+	return maximumPaths != 0 && values.size() > maximumPaths;
+}
+
+/*static*/ void StatusController::AddVersionToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer)
+{
+	AddUintToJson(writer, "Version", 1);
+}
+
+/*static*/ std::string StatusController::CreateErrorResponse(const std::string& request, std::string&& error)
+{
+	Log("StatusController.FailedRequest", Severity::Warning)
+		<< R"(Failed to service request. { "error": ")" << error << R"(", "request": ")" << request << R"(" })";
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
+
+	writer.StartObject();
+	AddVersionToJson(writer);
+	AddStringToJson(writer, "Error", std::move(error));
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+/*static*/ bool StatusController::GetComponentsForField(const std::string& field, uint32_t& components)
+{
+	static const std::unordered_map<std::string, uint32_t> componentsForFields =
+	{
+		{ "Path", 0 },
+		{ "RepoPath", 0 },
+		{ "WorkingDir", 0 },
+		{ "State", 0 },
+		{ "Branch", 0 },
+		{ "Upstream", 0 },
+		{ "UpstreamGone", 0 },
+		{ "AheadBy", Git::AheadBehindComponent },
+		{ "BehindBy", Git::AheadBehindComponent },
+		{ "IndexAdded", Git::FileStatusComponent },
+		{ "IndexModified", Git::FileStatusComponent },
+		{ "IndexDeleted", Git::FileStatusComponent },
+		{ "IndexTypeChange", Git::FileStatusComponent },
+		{ "IndexRenamed", Git::FileStatusComponent },
+		{ "WorkingAdded", Git::FileStatusComponent },
+		{ "WorkingModified", Git::FileStatusComponent },
+		{ "WorkingDeleted", Git::FileStatusComponent },
+		{ "WorkingTypeChange", Git::FileStatusComponent },
+		{ "WorkingRenamed", Git::FileStatusComponent },
+		{ "WorkingUnreadable", Git::FileStatusComponent },
+		{ "Ignored", Git::FileStatusComponent },
+		{ "Conflicted", Git::FileStatusComponent },
+		{ "Counts", Git::FileStatusComponent },
+		{ "Dirty", Git::FileStatusComponent },
+		{ "Truncated", 0 },
+		{ "Stashes", Git::StashComponent },
+		{ "Submodules", Git::SubmoduleComponent },
+	};
+
+	auto componentsForField = componentsForFields.find(field);
+	if (componentsForField == componentsForFields.end())
+		return false;
+
+	components = componentsForField->second;
+	return true;
+}
+
+void StatusController::RecordGetStatusTime(uint64_t nanosecondsInGetStatus)
+{
+	WriteLock writeLock{m_getStatusStatisticsMutex};
+	++m_totalGetStatusCalls;
+	m_totalNanosecondsInGetStatus += nanosecondsInGetStatus;
+	m_minNanosecondsInGetStatus = (std::min)(nanosecondsInGetStatus, m_minNanosecondsInGetStatus);
+	m_maxNanosecondsInGetStatus = (std::max)(nanosecondsInGetStatus, m_maxNanosecondsInGetStatus);
+}
+
+std::string StatusController::GetStatus(const rapidjson::Document& document, const std::string& request)
+{
+	if (!document.HasMember("Path") || !document["Path"].IsString())
+	{
+		return CreateErrorResponse(request, "'Path' must be specified.");
+	}
+	auto path = std::string(document["Path"].GetString());
+
+	auto hasFields = document.HasMember("Fields");
+	std::unordered_set<std::string> fields;
+	uint32_t components = Git::AllComponents;
+	if (hasFields)
+	{
+		const auto& fieldsValue = document["Fields"];
+		if (!fieldsValue.IsArray())
+			return CreateErrorResponse(request, "'Fields' must be an array of field names.");
+
+		components = 0;
+		for (auto field = fieldsValue.Begin(); field != fieldsValue.End(); ++field)
+		{
+			if (!field->IsString())
+				return CreateErrorResponse(request, "'Fields' must be an array of field names.");
+
+			auto fieldName = std::string(field->GetString());
+			uint32_t componentsForField;
+			if (!GetComponentsForField(fieldName, componentsForField))
+				return CreateErrorResponse(request, "'Fields' contains an unrecognized field.");
+
+			components |= componentsForField;
+			fields.insert(std::move(fieldName));
+		}
+	}
+
+	auto maximumPaths = m_maximumPathsPerCategory;
+	if (document.HasMember("MaxPaths"))
+	{
+		if (!document["MaxPaths"].IsUint())
+			return CreateErrorResponse(request, "'MaxPaths' must be a non-negative integer.");
+		maximumPaths = document["MaxPaths"].GetUint();
+	}
+
+	auto maximumStaleness = m_maximumStalenessInMilliseconds;
+	if (document.HasMember("MaxStalenessMs"))
+	{
+		if (!document["MaxStalenessMs"].IsUint())
+			return CreateErrorResponse(request, "'MaxStalenessMs' must be a non-negative integer.");
+		maximumStaleness = document["MaxStalenessMs"].GetUint();
+	}
+
+	auto progressive = false;
+	if (document.HasMember("Progressive"))
+	{
+		if (!document["Progressive"].IsBool())
+			return CreateErrorResponse(request, "'Progressive' must be a boolean.");
+		progressive = document["Progressive"].GetBool();
+	}
+
+	auto repositoryPath = m_cache.DiscoverRepository(path);
+	if (!std::get<0>(repositoryPath))
+	{
+		return CreateErrorResponse(request, "Requested 'Path' is not part of a git repository.");
+	}
+
+	if (maximumStaleness != 0)
+	{
+		// Current statuses are served through the memoized path below.
+		auto isStale = false;
+		std::chrono::milliseconds staleness;
+		auto status = m_cache.GetStaleStatus(
+			std::get<1>(repositoryPath), components, std::chrono::milliseconds(maximumStaleness), isStale, staleness);
+		if (status != nullptr && isStale)
+			return SerializeStatus(*status, path, hasFields, fields, components, maximumPaths, true /*isStale*/, staleness.count());
+	}
+
+	if (progressive)
+	{
+		// Partial responses aren't memoized. Once the background computation completes the
+		// status includes every component and is served through the memoized path below.
+		auto status = m_cache.GetStatusProgressively(std::get<1>(repositoryPath), components);
+		if (!std::get<0>(status))
+		{
+			return CreateErrorResponse(request, "Failed to retrieve status of git repository at provided 'Path'.");
+		}
+
+		if ((std::get<1>(status)->Components & components) != components)
+			return SerializeStatus(*std::get<1>(status), path, hasFields, fields, components, maximumPaths);
+	}
+
+	// Response includes the requested path, so it's part of the key along with the fields.
+	std::vector<std::string> sortedFields(fields.begin(), fields.end());
+	std::sort(sortedFields.begin(), sortedFields.end());
+	std::string key = "GetStatus:";
+	key += hasFields ? boost::algorithm::join(sortedFields, ",") : "*";
+	key += ":";
+	key += std::to_string(maximumPaths);
+	key += ":";
+	key += path;
+
+	auto response = m_cache.GetRenderedStatus(
+		std::get<1>(repositoryPath),
+		key,
+		components,
+		[&path, hasFields, &fields, components, maximumPaths](const Git::Status& status)
+		{
+			return SerializeStatus(status, path, hasFields, fields, components, maximumPaths);
+		});
+	if (!std::get<0>(response))
+	{
+		return CreateErrorResponse(request, "Failed to retrieve status of git repository at provided 'Path'.");
+	}
+
+	return std::get<1>(response);
+}
+
+/*static*/ std::string StatusController::SerializeStatus(
+	const Git::Status& statusToReport,
+	const std::string& path,
+	bool hasFields,
+	const std::unordered_set<std::string>& fields,
+	uint32_t components,
+	uint32_t maximumPaths,
+	bool isStale,
+	uint64_t stalenessInMilliseconds)
+{
+	auto isRequested = [hasFields, &fields, &statusToReport](const char* field)
+	{
+		uint32_t componentsForField = 0;
+		GetComponentsForField(field, componentsForField);
+		return (!hasFields || fields.find(field) != fields.end())
+			&& (statusToReport.Components & componentsForField) == componentsForField;
+	};
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
+
+	writer.StartObject();
+
+	AddVersionToJson(writer);
+	if (isRequested("Path"))
+		AddStringToJson(writer, "Path", path.c_str());
+	if (isRequested("RepoPath"))
+		AddStringToJson(writer, "RepoPath", statusToReport.RepositoryPath.c_str());
+	if (isRequested("WorkingDir"))
+		AddStringToJson(writer, "WorkingDir", statusToReport.WorkingDirectory.c_str());
+	if (isRequested("State"))
+		AddStringToJson(writer, "State", statusToReport.State.c_str());
+	if (isRequested("Branch"))
+		AddStringToJson(writer, "Branch", statusToReport.Branch.c_str());
+	if (isRequested("Upstream"))
+		AddStringToJson(writer, "Upstream", statusToReport.Upstream.c_str());
+	if (isRequested("UpstreamGone"))
+		AddBoolToJson(writer, "UpstreamGone", statusToReport.UpstreamGone);
+	if (isRequested("AheadBy"))
+		AddUintToJson(writer, "AheadBy", statusToReport.AheadBy);
+	if (isRequested("BehindBy"))
+		AddUintToJson(writer, "BehindBy", statusToReport.BehindBy);
+
+	auto truncated = false;
+	if (isRequested("IndexAdded"))
+		truncated |= AddArrayToJson(writer, "IndexAdded", statusToReport.Files.GetPaths(FileStatus::IndexAdded), maximumPaths);
+	if (isRequested("IndexModified"))
+		truncated |= AddArrayToJson(writer, "IndexModified", statusToReport.Files.GetPaths(FileStatus::IndexModified), maximumPaths);
+	if (isRequested("IndexDeleted"))
+		truncated |= AddArrayToJson(writer, "IndexDeleted", statusToReport.Files.GetPaths(FileStatus::IndexDeleted), maximumPaths);
+	if (isRequested("IndexTypeChange"))
+		truncated |= AddArrayToJson(writer, "IndexTypeChange", statusToReport.Files.GetPaths(FileStatus::IndexTypeChange), maximumPaths);
+	if (isRequested("IndexRenamed"))
+		truncated |= AddRenamesToJson(writer, "IndexRenamed", statusToReport.Files.GetRenames(FileStatus::IndexRenamed), maximumPaths);
+
+	if (isRequested("WorkingAdded"))
+		truncated |= AddArrayToJson(writer, "WorkingAdded", statusToReport.Files.GetPaths(FileStatus::WorkingAdded), maximumPaths);
+	if (isRequested("WorkingModified"))
+		truncated |= AddArrayToJson(writer, "WorkingModified", statusToReport.Files.GetPaths(FileStatus::WorkingModified), maximumPaths);
+	if (isRequested("WorkingDeleted"))
+		truncated |= AddArrayToJson(writer, "WorkingDeleted", statusToReport.Files.GetPaths(FileStatus::WorkingDeleted), maximumPaths);
+	if (isRequested("WorkingTypeChange"))
+		truncated |= AddArrayToJson(writer, "WorkingTypeChange", statusToReport.Files.GetPaths(FileStatus::WorkingTypeChange), maximumPaths);
+	if (isRequested("WorkingRenamed"))
+		truncated |= AddRenamesToJson(writer, "WorkingRenamed", statusToReport.Files.GetRenames(FileStatus::WorkingRenamed), maximumPaths);
+	if (isRequested("WorkingUnreadable"))
+		truncated |= AddArrayToJson(writer, "WorkingUnreadable", statusToReport.Files.GetPaths(FileStatus::WorkingUnreadable), maximumPaths);
+
+	if (isRequested("Ignored"))
+		truncated |= AddArrayToJson(writer, "Ignored", statusToReport.Files.GetPaths(FileStatus::Ignored), maximumPaths);
+	if (isRequested("Conflicted"))
+		truncated |= AddArrayToJson(writer, "Conflicted", statusToReport.Files.GetPaths(FileStatus::Conflicted), maximumPaths);
+
+	if (isRequested("Counts"))
+	{
+		static const std::pair<const char*, FileStatus::Category> categories[] =
+		{
+			{ "IndexAdded", FileStatus::IndexAdded },
+			{ "IndexModified", FileStatus::IndexModified },
+			{ "IndexDeleted", FileStatus::IndexDeleted },
+			{ "IndexTypeChange", FileStatus::IndexTypeChange },
+			{ "IndexRenamed", FileStatus::IndexRenamed },
+			{ "WorkingAdded", FileStatus::WorkingAdded },
+			{ "WorkingModified", FileStatus::WorkingModified },
+			{ "WorkingDeleted", FileStatus::WorkingDeleted },
+			{ "WorkingTypeChange", FileStatus::WorkingTypeChange },
+			{ "WorkingRenamed", FileStatus::WorkingRenamed },
+			{ "WorkingUnreadable", FileStatus::WorkingUnreadable },
+			{ "Ignored", FileStatus::Ignored },
+			{ "Conflicted", FileStatus::Conflicted },
+		};
+
+		writer.String("Counts");
+		writer.StartObject();
+		for (const auto& category : categories)
+			AddUint64ToJson(writer, category.first, statusToReport.Files.GetCount(category.second));
+		writer.EndObject();
+	}
+	if (isRequested("Dirty"))
+	{
+		// Ignored files don't make the working tree dirty.
+		static const FileStatus::Category changeCategories[] =
+		{
+			FileStatus::IndexAdded, FileStatus::IndexModified, FileStatus::IndexDeleted, FileStatus::IndexTypeChange, FileStatus::IndexRenamed,
+			FileStatus::WorkingAdded, FileStatus::WorkingModified, FileStatus::WorkingDeleted, FileStatus::WorkingTypeChange, FileStatus::WorkingRenamed,
+			FileStatus::WorkingUnreadable, FileStatus::Conflicted,
+		};
+
+		auto dirty = std::any_of(
+			std::begin(changeCategories),
+			std::end(changeCategories),
+			[&statusToReport](FileStatus::Category category) { return statusToReport.Files.GetCount(category) != 0; });
+		AddBoolToJson(writer, "Dirty", dirty);
+	}
+	if (isRequested("Truncated"))
+		AddBoolToJson(writer, "Truncated", truncated);
+
+	if (isRequested("Stashes"))
+	{
+		writer.String("Stashes");
+		writer.StartArray();
+		for (const auto& value : statusToReport.Stashes)
+		{
+			writer.StartObject();
+			writer.String("Name");
+			std::string name = "stash@{";
+			name += std::to_string(value.Index);
+			name += "}";
+			writer.String(name.c_str());
+			writer.String("Sha1Id");
+			writer.String(value.Sha1Id.c_str());
+			writer.String("Message");
+			writer.String(value.Message.c_str());
+			writer.EndObject();
+		}
+		writer.EndArray();
+	}
+
+	if (isRequested("Submodules"))
+	{
+		writer.String("Submodules");
+		writer.StartArray();
+		for (const auto& value : statusToReport.Submodules)
+		{
+			writer.StartObject();
+			writer.String("Path");
+			writer.String(value.Path.c_str());
+			writer.String("Initialized");
+			writer.Bool(!value.RepositoryPath.empty());
+			if (value.HasStatus)
+			{
+				writer.String("Branch");
+				writer.String(value.Branch.c_str());
+				writer.String("NewCommits");
+				writer.Bool(value.HasNewCommits);
+				writer.String("IndexChanges");
+				writer.Uint64(value.IndexChanges);
+				writer.String("WorkingChanges");
+				writer.Uint64(value.WorkingChanges);
+				writer.String("Conflicted");
+				writer.Uint64(value.Conflicted);
+			}
+			writer.EndObject();
+		}
+		writer.EndArray();
+	}
+
+	if ((statusToReport.Components & components) != components)
+		AddBoolToJson(writer, "FilesPending", true);
+
+	if (isStale)
+	{
+		AddBoolToJson(writer, "Stale", true);
+		AddUint64ToJson(writer, "StalenessMs", stalenessInMilliseconds);
+	}
+
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+std::string StatusController::RenderPrompt(const rapidjson::Document& document, const std::string& request)
+{
+	if (!document.HasMember("Path") || !document["Path"].IsString())
+	{
+		return CreateErrorResponse(request, "'Path' must be specified.");
+	}
+	auto path = std::string(document["Path"].GetString());
+
+	if (!document.HasMember("Format") || !document["Format"].IsString())
+	{
+		return CreateErrorResponse(request, "'Format' must be specified.");
+	}
+	auto format = std::string(document["Format"].GetString());
+
+	auto promptTemplate = PromptTemplate::Parse(format);
+	if (!std::get<0>(promptTemplate))
+	{
+		return CreateErrorResponse(request, "'Format' contains an unrecognized field or unbalanced braces.");
+	}
+
+	auto repositoryPath = m_cache.DiscoverRepository(path);
+	if (!std::get<0>(repositoryPath))
+	{
+		return CreateErrorResponse(request, "Requested 'Path' is not part of a git repository.");
+	}
+
+	const auto& promptTemplateToRender = std::get<1>(promptTemplate);
+	auto response = m_cache.GetRenderedStatus(
+		std::get<1>(repositoryPath),
+		"RenderPrompt:" + format,
+		promptTemplateToRender.GetRequiredComponents(),
+		[&promptTemplateToRender](const Git::Status& status)
+		{
+			rapidjson::StringBuffer buffer;
+			rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
+
+			writer.StartObject();
+			AddVersionToJson(writer);
+			AddStringToJson(writer, "Prompt", promptTemplateToRender.Render(status));
+			writer.EndObject();
+
+			return std::string(buffer.GetString());
+		});
+	if (!std::get<0>(response))
+	{
+		return CreateErrorResponse(request, "Failed to retrieve status of git repository at provided 'Path'.");
+	}
+
+	return std::get<1>(response);
+}
+
+std::string StatusController::GetFsmonitorChanges(const rapidjson::Document& document, const std::string& request)
+{
+	if (!document.HasMember("Path") || !document["Path"].IsString())
+	{
+		return CreateErrorResponse(request, "'Path' must be specified.");
+	}
+	auto path = std::string(document["Path"].GetString());
+
+	if (!document.HasMember("Token") || !document["Token"].IsString())
+	{
+		return CreateErrorResponse(request, "'Token' must be specified.");
+	}
+	auto token = std::string(document["Token"].GetString());
+
+	auto repositoryPath = m_cache.DiscoverRepository(path);
+	if (!std::get<0>(repositoryPath))
+	{
+		return CreateErrorResponse(request, "Requested 'Path' is not part of a git repository.");
+	}
+
+	auto changes = m_cache.GetChangesSince(std::get<1>(repositoryPath), token);
+	if (!std::get<0>(changes))
+	{
+		return CreateErrorResponse(request, "Failed to retrieve status of git repository at provided 'Path'.");
+	}
+
+	auto& changesToReport = std::get<1>(changes);
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
+
+	writer.StartObject();
+	AddVersionToJson(writer);
+	AddStringToJson(writer, "Token", std::move(changesToReport.Token));
+	AddBoolToJson(writer, "AllChanged", changesToReport.AllChanged);
+	AddArrayToJson(writer, "Paths", changesToReport.Paths);
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+std::string StatusController::GetCacheStatistics()
+{
+	auto statistics = m_cache.GetCacheStatistics();
+
+	static const int nanosecondsPerMillisecond = 1000000;
+	uint64_t totalGetStatusCalls;
+	uint64_t totalNanosecondsInGetStatus;
+	uint64_t minNanosecondsInGetStatus;
+	uint64_t maxNanosecondsInGetStatus;
+	{
+		ReadLock readLock{m_getStatusStatisticsMutex};
+		totalGetStatusCalls = m_totalGetStatusCalls;
+		totalNanosecondsInGetStatus = m_totalNanosecondsInGetStatus;
+		minNanosecondsInGetStatus = m_minNanosecondsInGetStatus;
+		maxNanosecondsInGetStatus = m_maxNanosecondsInGetStatus;
+	}
+	
+	auto averageNanosecondsInGetStatus = totalGetStatusCalls != 0 ? totalNanosecondsInGetStatus / totalGetStatusCalls : 0;
+	auto averageMillisecondsInGetStatus = static_cast<double>(averageNanosecondsInGetStatus) / nanosecondsPerMillisecond;
+	auto minMillisecondsInGetStatus = static_cast<double>(minNanosecondsInGetStatus) / nanosecondsPerMillisecond;
+	auto maxMillisecondsInGetStatus = static_cast<double>(maxNanosecondsInGetStatus) / nanosecondsPerMillisecond;
+
+	auto currentTime = boost::posix_time::second_clock::universal_time();
+	auto uptime = boost::posix_time::to_simple_string(currentTime - m_startTime);
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
+
+	writer.StartObject();
+	AddVersionToJson(writer);
+	AddStringToJson(writer, "Uptime", std::move(uptime));
+	AddUint64ToJson(writer, "TotalGetStatusRequests", totalGetStatusCalls);
+	AddDoubleToJson(writer, "AverageMillisecondsInGetStatus", averageMillisecondsInGetStatus);
+	AddDoubleToJson(writer, "MinimumMillisecondsInGetStatus", minMillisecondsInGetStatus);
+	AddDoubleToJson(writer, "MaximumMillisecondsInGetStatus", maxMillisecondsInGetStatus);
+	AddUint64ToJson(writer, "CacheHits",  statistics.CacheHits);
+	AddUint64ToJson(writer, "CacheMisses", statistics.CacheMisses);
+	AddUint64ToJson(writer, "EffectiveCachePrimes", statistics.CacheEffectivePrimeRequests);
+	AddUint64ToJson(writer, "TotalCachePrimes", statistics.CacheTotalPrimeRequests);
+	AddUint64ToJson(writer, "EffectiveCacheInvalidations", statistics.CacheEffectiveInvalidationRequests);
+	AddUint64ToJson(writer, "TotalCacheInvalidations", statistics.CacheTotalInvalidationRequests);
+	AddUint64ToJson(writer, "FullCacheInvalidations", statistics.CacheInvalidateAllRequests);
+	AddUint64ToJson(writer, "IncrementalRecomputes", statistics.CacheIncrementalRecomputes);
+	AddUint64ToJson(writer, "CoalescedComputations", statistics.CacheCoalescedComputations);
+	AddUint64ToJson(writer, "StaleCacheHits", statistics.CacheStaleHits);
+	AddUint64ToJson(writer, "CacheEvictions", statistics.CacheEvictions);
+	AddUint64ToJson(writer, "CacheBytes", statistics.CacheBytes);
+	AddUint64ToJson(writer, "CacheEntries", statistics.CacheEntries);
+	AddUint64ToJson(writer, "RestoredEntries", statistics.CacheRestoredEntries);
+	AddUint64ToJson(writer, "Revalidations", statistics.CacheRevalidations);
+	AddUint64ToJson(writer, "RevalidatedChanges", statistics.CacheRevalidatedChanges);
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+std::string StatusController::Shutdown()
+{
+	Log("StatusController.Shutdown", Severity::Info) << R"(Shutting down due to client request.")";
+	::SetEvent(m_requestShutdown);
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer{ buffer };
+
+	writer.StartObject();
+	AddVersionToJson(writer);
+	AddStringToJson(writer, "Result", "Shutting down.");
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+std::string StatusController::HandleRequest(const std::string& request)
+{
+	rapidjson::Document document;
+	const auto& parser = document.Parse(request.c_str());
+	if (parser.HasParseError())
+		return CreateErrorResponse(request, "Request must be valid JSON.");
+
+	if (!document.HasMember("Version") || !document["Version"].IsUint())
+		return CreateErrorResponse(request, "'Version' must be specified.");
+	auto version = document["Version"].GetUint();
+
+	if (version != 1)
+		return CreateErrorResponse(request, "Requested 'Version' unknown.");
+
+	if (!document.HasMember("Action") || !document["Action"].IsString())
+		return CreateErrorResponse(request, "'Action' must be specified.");
+	auto action = std::string(document["Action"].GetString());
+
+	if (boost::iequals(action, "GetStatus"))
+	{
+		boost::timer::cpu_timer timer;
+		auto result = GetStatus(document, request);
+		RecordGetStatusTime(timer.elapsed().wall);
+		return result;
+	}
+
+	if (boost::iequals(action, "RenderPrompt"))
+		return RenderPrompt(document, request);
+
+	if (boost::iequals(action, "GetFsmonitorChanges"))
+		return GetFsmonitorChanges(document, request);
+
+	if (boost::iequals(action, "GetCacheStatistics"))
+		return GetCacheStatistics();
+
+	if (boost::iequals(action, "Shutdown"))
+		return Shutdown();
+
+	return CreateErrorResponse(request, "'Action' unrecognized.");
+}
+
+void StatusController::WaitForShutdownRequest()
+{
+	::WaitForSingleObject(m_requestShutdown, INFINITE);
 }
\ No newline at end of file
@@ -1,104 +1,151 @@
-#pragma once
-
-#include "Git.h"
-#include "DirectoryMonitor.h"
-#include "StatusCache.h"
-#include <rapidjson/document.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
-
-/**
- * Services requests for git status information.
- */
-class StatusController : boost::noncopyable
-{
-private:
-	using ReadLock = boost::shared_lock<boost::shared_mutex>;
-	using WriteLock = boost::unique_lock<boost::shared_mutex>;
-
-	const boost::posix_time::ptime m_startTime;
-
-	uint64_t m_totalNanosecondsInGetStatus = 0;
-	uint64_t m_minNanosecondsInGetStatus = UINT64_MAX;
-	uint64_t m_maxNanosecondsInGetStatus = 0;
-	uint64_t m_totalGetStatusCalls = 0;
-	boost::shared_mutex m_getStatusStatisticsMutex;
-
-	Git m_git;
-	StatusCache m_cache;
-	UniqueHandle m_requestShutdown;
-
-	/**
-	* Adds named string to JSON response.
-	*/
-	static void AddStringToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, std::string&& value);
-
-	/**
-	* Adds bool to JSON response.
-	*/
-	static void AddBoolToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, bool value);
-
-	/**
-	* Adds uint32_t to JSON response.
-	*/
-	static void AddUintToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint32_t value);
-
-	/**
-	* Adds uint64_t to JSON response.
-	*/
-	static void AddUint64ToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint64_t value);
-
-	/**
-	* Adds double to JSON response.
-	*/
-	static void AddDoubleToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, double value);
-
-	/**
-	* Adds vector of strings to JSON response.
-	*/
-	static void AddArrayToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const std::vector<std::string>& value);
-
-	/**
-	 * Adds version to JSON response.
-	 */
-	static void AddVersionToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer);
-
-	/**
-	 * Creates JSON response for errors.
-	 */
-	static std::string CreateErrorResponse(const std::string& request, std::string&& error);
-
-	/**
-	 * Records timing datapoint for GetStatus.
-	 */
-	void RecordGetStatusTime(uint64_t nanosecondsInGetStatus);
-
-	/**
-	* Retrieves current git status.
-	*/
-	std::string GetStatus(const rapidjson::Document& document, const std::string& request);
-
-	/**
-	* Retrieves information about cache's performance.
-	*/
-	std::string GetCacheStatistics();
-
-	/**
-	 * Shuts down the service.
-	 */
-	std::string StatusController::Shutdown();
-
-public:
-	StatusController();
-	~StatusController();
-
-	/**
-	* Deserializes request and returns serialized response.
-	*/
-	std::string StatusController::HandleRequest(const std::string& request);
-
-	/**
-	 * Blocks until shutdown request received.
-	 */
-	void WaitForShutdownRequest();
+#pragma once
+
+#include "Git.h"
+#include "DirectoryMonitor.h"
+#include "PromptTemplate.h"
+#include "StatusCache.h"
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+/**
+ * Services requests for git status information.
+ */
+class StatusController : boost::noncopyable
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	const boost::posix_time::ptime m_startTime;
+
+	uint64_t m_totalNanosecondsInGetStatus = 0;
+	uint64_t m_minNanosecondsInGetStatus = UINT64_MAX;
+	uint64_t m_maxNanosecondsInGetStatus = 0;
+	uint64_t m_totalGetStatusCalls = 0;
+	boost::shared_mutex m_getStatusStatisticsMutex;
+
+	StatusCache m_cache;
+	UniqueHandle m_requestShutdown;
+	uint32_t m_maximumPathsPerCategory;
+	uint32_t m_maximumStalenessInMilliseconds;
+
+	/**
+	* Adds named string to JSON response.
+	*/
+	static void AddStringToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, std::string&& value);
+
+	/**
+	* Adds bool to JSON response.
+	*/
+	static void AddBoolToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, bool value);
+
+	/**
+	* Adds uint32_t to JSON response.
+	*/
+	static void AddUintToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint32_t value);
+
+	/**
+	* Adds uint64_t to JSON response.
+	*/
+	static void AddUint64ToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, uint64_t value);
+
+	/**
+	* Adds double to JSON response.
+	*/
+	static void AddDoubleToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, double value);
+
+	/**
+	* Adds vector of strings to JSON response.
+	*/
+	static void AddArrayToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const std::vector<std::string>& value);
+
+	/**
+	* Adds named array of paths to JSON response. Adds at most maximumPaths paths unless it is
+	* zero. Returns true if paths were left out.
+	*/
+	static bool AddArrayToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const FileStatus::PathRange& value, uint32_t maximumPaths);
+
+	/**
+	* Adds named array of old and new path pairs to JSON response. Adds at most maximumPaths
+	* pairs unless it is zero. Returns true if pairs were left out.
+	*/
+	static bool AddRenamesToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer, std::string&& name, const FileStatus::RenameRange& value, uint32_t maximumPaths);
+
+	/**
+	 * Adds version to JSON response.
+	 */
+	static void AddVersionToJson(rapidjson::Writer<rapidjson::StringBuffer>& writer);
+
+	/**
+	 * Creates JSON response for errors.
+	 */
+	static std::string CreateErrorResponse(const std::string& request, std::string&& error);
+
+	/**
+	 * Looks up the optional status components required to report a GetStatus field.
+	 * Returns false if the field is unrecognized.
+	 */
+	static bool GetComponentsForField(const std::string& field, uint32_t& components);
+
+	/**
+	 * Serializes the requested fields of status into a GetStatus response. File lists are
+	 * capped at maximumPaths entries each unless it is zero. Fields whose components are
+	 * missing from status are omitted, and the response is marked with FilesPending if any
+	 * requested components are missing. Stale status is marked as Stale along with how many
+	 * milliseconds ago it was invalidated.
+	 */
+	static std::string SerializeStatus(
+		const Git::Status& status,
+		const std::string& path,
+		bool hasFields,
+		const std::unordered_set<std::string>& fields,
+		uint32_t components,
+		uint32_t maximumPaths,
+		bool isStale = false,
+		uint64_t stalenessInMilliseconds = 0);
+
+	/**
+	 * Records timing datapoint for GetStatus.
+	 */
+	void RecordGetStatusTime(uint64_t nanosecondsInGetStatus);
+
+	/**
+	* Retrieves current git status.
+	*/
+	std::string GetStatus(const rapidjson::Document& document, const std::string& request);
+
+	/**
+	* Renders prompt from current git status using requested format.
+	*/
+	std::string RenderPrompt(const rapidjson::Document& document, const std::string& request);
+
+	/**
+	* Retrieves paths changed since token for git's fsmonitor hook.
+	*/
+	std::string GetFsmonitorChanges(const rapidjson::Document& document, const std::string& request);
+
+	/**
+	* Retrieves information about cache's performance.
+	*/
+	std::string GetCacheStatistics();
+
+	/**
+	 * Shuts down the service.
+	 */
+	std::string StatusController::Shutdown();
+
+public:
+	StatusController(const GitSettings& gitSettings);
+	~StatusController();
+
+	/**
+	* Deserializes request and returns serialized response.
+	*/
+	std::string StatusController::HandleRequest(const std::string& request);
+
+	/**
+	 * Blocks until shutdown request received.
+	 */
+	void WaitForShutdownRequest();
 };
\ No newline at end of file
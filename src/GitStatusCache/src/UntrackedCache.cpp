@@ -0,0 +1,437 @@
+#include "stdafx.h"
+#include "UntrackedCache.h"
+#include "StringConverters.h"
+#include <boost/filesystem/operations.hpp>
+#include <boost/functional/hash.hpp>
+#include <cstring>
+
+/**
+* Directories modified within this many seconds of being read are read again on the next
+* walk because further changes within the same timestamp wouldn't be detected.
+*/
+static const std::time_t RacyTimestampSeconds = 2;
+
+std::string AppendRelativePath(const std::string& relativeDirectory, const std::string& name)
+{
+	return relativeDirectory.empty() ? name : relativeDirectory + "/" + name;
+}
+
+boost::filesystem::path MakeAbsolutePath(const boost::filesystem::path& workingDirectory, const std::string& relativePath)
+{
+	return relativePath.empty() ? workingDirectory : workingDirectory / ConvertToUnicode(relativePath);
+}
+
+/*static*/ UntrackedCache::FileStamp UntrackedCache::GetFileStamp(const boost::filesystem::path& path)
+{
+	FileStamp stamp;
+	auto errorCode = boost::system::error_code();
+	auto lastWriteTime = boost::filesystem::last_write_time(path, errorCode);
+	if (errorCode)
+		return stamp;
+
+	auto size = boost::filesystem::file_size(path, errorCode);
+	if (errorCode)
+		return stamp;
+
+	stamp.Exists = true;
+	stamp.LastWriteTime = lastWriteTime;
+	stamp.Size = size;
+	return stamp;
+}
+
+/*static*/ std::string UntrackedCache::GetExcludesFilePath(UniqueGitRepository& repository)
+{
+	auto config = MakeUniqueGitConfig(nullptr);
+	if (git_repository_config_snapshot(&config.get(), repository.get()) != GIT_OK)
+		return std::string();
+
+	auto excludesFilePath = MakeUniqueGitBuffer(git_buf{ 0 });
+	if (git_config_get_path(&excludesFilePath.get(), config.get(), "core.excludesfile") == GIT_OK)
+		return std::string(excludesFilePath.get().ptr);
+
+	// libgit2 falls back to ignore next to the XDG config file.
+	auto xdgConfigPath = MakeUniqueGitBuffer(git_buf{ 0 });
+	if (git_config_find_xdg(&xdgConfigPath.get()) != GIT_OK)
+		return std::string();
+
+	auto path = std::string(xdgConfigPath.get().ptr);
+	return path.substr(0, path.find_last_of("/\\") + 1) + "ignore";
+}
+
+/*static*/ bool UntrackedCache::IsDirectory(const boost::filesystem::directory_entry& entry)
+{
+	auto errorCode = boost::system::error_code();
+	return boost::filesystem::is_directory(entry.symlink_status(errorCode));
+}
+
+/*static*/ bool UntrackedCache::GetLastWriteTime(std::time_t& lastWriteTime, const boost::filesystem::path& workingDirectory, const std::string& relativePath)
+{
+	auto errorCode = boost::system::error_code();
+	lastWriteTime = boost::filesystem::last_write_time(MakeAbsolutePath(workingDirectory, relativePath), errorCode);
+	return !errorCode;
+}
+
+/*static*/ uint64_t UntrackedCache::GetSizeInBytes(const RepositoryCache& cache)
+{
+	// Short strings are stored inline and only account for the size of the string itself.
+	auto getHeapSize = [](const std::string& value) -> uint64_t
+	{
+		auto capacity = value.capacity() + 1;
+		return capacity > sizeof(std::string) ? capacity : 0;
+	};
+
+	// Each hash node holds its value and a link.
+	auto size = uint64_t{ sizeof(RepositoryCache) } + getHeapSize(cache.ExcludesFilePath);
+	for (const auto& trackedDirectory : cache.TrackedDirectories)
+	{
+		size += sizeof(trackedDirectory) + sizeof(void*) + getHeapSize(trackedDirectory.first);
+		for (const auto* names : { &trackedDirectory.second.Files, &trackedDirectory.second.Subdirectories })
+		{
+			size += names->bucket_count() * sizeof(void*);
+			for (const auto& name : *names)
+				size += sizeof(name) + sizeof(void*) + getHeapSize(name);
+		}
+	}
+	size += cache.TrackedDirectories.bucket_count() * sizeof(void*);
+
+	for (const auto& directory : cache.Directories)
+	{
+		const auto& cachedDirectory = directory.second;
+		size += sizeof(directory) + sizeof(void*) + getHeapSize(directory.first)
+			+ (cachedDirectory.Subdirectories.capacity() + cachedDirectory.Untracked.capacity()) * sizeof(std::string)
+			+ cachedDirectory.VisitedUntrackedDirectories.capacity() * sizeof(VisitedDirectory);
+		for (const auto& subdirectory : cachedDirectory.Subdirectories)
+			size += getHeapSize(subdirectory);
+		for (const auto& untracked : cachedDirectory.Untracked)
+			size += getHeapSize(untracked);
+		for (const auto& visitedDirectory : cachedDirectory.VisitedUntrackedDirectories)
+			size += getHeapSize(visitedDirectory.RelativePath);
+	}
+	size += cache.Directories.bucket_count() * sizeof(void*);
+
+	return size;
+}
+
+/*static*/ bool UntrackedCache::LoadTrackedDirectories(RepositoryCache& cache, const std::string& repositoryPath, UniqueGitRepository& repository)
+{
+	auto index = MakeUniqueGitIndex(nullptr);
+	auto result = git_repository_index(&index.get(), repository.get());
+	if (result == GIT_OK)
+		result = git_index_read(index.get(), false /*force*/);
+	if (result != GIT_OK)
+	{
+		auto lastError = giterr_last();
+		Log("UntrackedCache.LoadTrackedDirectories.FailedToReadIndex", Severity::Warning)
+			<< R"(Failed to read index. { "repositoryPath": ")" << repositoryPath
+			<< R"(", "lastError": ")" << (lastError == nullptr ? "null" : lastError->message) << R"(" })";
+		return false;
+	}
+
+	auto entryCount = git_index_entrycount(index.get());
+	size_t indexPathsHash = entryCount;
+	for (auto i = size_t{ 0 }; i < entryCount; ++i)
+	{
+		auto path = git_index_get_byindex(index.get(), i)->path;
+		boost::hash_combine(indexPathsHash, boost::hash_range(path, path + std::strlen(path)));
+	}
+
+	if (indexPathsHash == cache.IndexPathsHash && !cache.TrackedDirectories.empty())
+		return true;
+
+	cache.IndexPathsHash = indexPathsHash;
+	cache.TrackedDirectories.clear();
+	cache.TrackedDirectories[std::string()];
+	for (auto i = size_t{ 0 }; i < entryCount; ++i)
+	{
+		auto path = std::string(git_index_get_byindex(index.get(), i)->path);
+		auto separator = path.rfind('/');
+		auto directory = separator == std::string::npos ? std::string() : path.substr(0, separator);
+		cache.TrackedDirectories[directory].Files.insert(path.substr(separator + 1));
+
+		while (!directory.empty())
+		{
+			separator = directory.rfind('/');
+			auto parent = separator == std::string::npos ? std::string() : directory.substr(0, separator);
+			if (!cache.TrackedDirectories[parent].Subdirectories.insert(directory.substr(separator + 1)).second)
+				break;
+			directory = parent;
+		}
+	}
+
+	for (auto& trackedDirectory : cache.TrackedDirectories)
+	{
+		// Order independent so the hash doesn't depend on unordered_set iteration order.
+		size_t hash = 0;
+		for (const auto& file : trackedDirectory.second.Files)
+			hash += boost::hash_value(file);
+		for (const auto& subdirectory : trackedDirectory.second.Subdirectories)
+			hash += boost::hash_value(subdirectory + "/");
+		trackedDirectory.second.Hash = hash;
+	}
+
+	Log("UntrackedCache.LoadTrackedDirectories", Severity::Verbose)
+		<< R"(Loaded tracked directories from index. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "indexEntries": )" << entryCount
+		<< R"(, "directories": )" << cache.TrackedDirectories.size() << R"( })";
+	return true;
+}
+
+/*static*/ bool UntrackedCache::IsIgnored(UniqueGitRepository& repository, const std::string& relativePath)
+{
+	int ignored = 0;
+	if (git_ignore_path_is_ignored(&ignored, repository.get(), relativePath.c_str()) != GIT_OK)
+		return false;
+	return ignored != 0;
+}
+
+/*static*/ bool UntrackedCache::ContainsUntrackedContent(
+	UniqueGitRepository& repository,
+	const boost::filesystem::path& workingDirectory,
+	const std::string& relativeDirectory,
+	std::vector<VisitedDirectory>& visitedDirectories)
+{
+	std::time_t lastWriteTime;
+	if (!UntrackedCache::GetLastWriteTime(lastWriteTime, workingDirectory, relativeDirectory))
+		return false;
+
+	// Editing .gitignore doesn't change the directory's modification time.
+	auto gitIgnore = UntrackedCache::GetFileStamp(MakeAbsolutePath(workingDirectory, relativeDirectory) / L".gitignore");
+	visitedDirectories.push_back(VisitedDirectory{ relativeDirectory, lastWriteTime, gitIgnore });
+
+	auto errorCode = boost::system::error_code();
+	for (auto iterator = boost::filesystem::directory_iterator(MakeAbsolutePath(workingDirectory, relativeDirectory), errorCode);
+		!errorCode && iterator != boost::filesystem::directory_iterator();
+		iterator.increment(errorCode))
+	{
+		auto name = ConvertToUtf8(iterator->path().filename().wstring());
+		auto relativePath = AppendRelativePath(relativeDirectory, name);
+
+		// Nested repositories are reported as untracked directories.
+		if (name == ".git")
+			return true;
+
+		if (UntrackedCache::IsDirectory(*iterator))
+		{
+			if (!UntrackedCache::IsIgnored(repository, relativePath + "/")
+				&& UntrackedCache::ContainsUntrackedContent(repository, workingDirectory, relativePath, visitedDirectories))
+			{
+				return true;
+			}
+		}
+		else if (!UntrackedCache::IsIgnored(repository, relativePath))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*static*/ void UntrackedCache::ReadDirectory(
+	CachedDirectory& cachedDirectory,
+	UniqueGitRepository& repository,
+	const boost::filesystem::path& workingDirectory,
+	const std::string& relativeDirectory,
+	const TrackedDirectory* trackedDirectory)
+{
+	cachedDirectory.Subdirectories.clear();
+	cachedDirectory.Untracked.clear();
+	cachedDirectory.VisitedUntrackedDirectories.clear();
+
+	auto errorCode = boost::system::error_code();
+	for (auto iterator = boost::filesystem::directory_iterator(MakeAbsolutePath(workingDirectory, relativeDirectory), errorCode);
+		!errorCode && iterator != boost::filesystem::directory_iterator();
+		iterator.increment(errorCode))
+	{
+		auto name = ConvertToUtf8(iterator->path().filename().wstring());
+		if (name == ".git")
+			continue;
+
+		auto isDirectory = UntrackedCache::IsDirectory(*iterator);
+		if (trackedDirectory != nullptr)
+		{
+			if (trackedDirectory->Subdirectories.count(name) != 0)
+			{
+				if (isDirectory)
+					cachedDirectory.Subdirectories.push_back(name);
+				continue;
+			}
+
+			// Tracked files, including submodules, are reported by libgit2.
+			if (trackedDirectory->Files.count(name) != 0)
+				continue;
+		}
+
+		auto relativePath = AppendRelativePath(relativeDirectory, name);
+		if (isDirectory)
+		{
+			if (UntrackedCache::IsIgnored(repository, relativePath + "/"))
+				continue;
+
+			if (UntrackedCache::ContainsUntrackedContent(repository, workingDirectory, relativePath, cachedDirectory.VisitedUntrackedDirectories))
+				cachedDirectory.Untracked.push_back(relativePath + "/");
+		}
+		else if (!UntrackedCache::IsIgnored(repository, relativePath))
+		{
+			cachedDirectory.Untracked.push_back(relativePath);
+		}
+	}
+}
+
+/*static*/ bool UntrackedCache::CanReuse(
+	const CachedDirectory& cachedDirectory,
+	const boost::filesystem::path& workingDirectory,
+	std::time_t lastWriteTime,
+	const FileStamp& gitIgnore,
+	size_t trackedHash)
+{
+	if (cachedDirectory.ReadTime == 0
+		|| cachedDirectory.LastWriteTime != lastWriteTime
+		|| cachedDirectory.LastWriteTime + RacyTimestampSeconds > cachedDirectory.ReadTime
+		|| cachedDirectory.GitIgnore != gitIgnore
+		|| cachedDirectory.TrackedHash != trackedHash)
+	{
+		return false;
+	}
+
+	for (const auto& visitedDirectory : cachedDirectory.VisitedUntrackedDirectories)
+	{
+		std::time_t currentLastWriteTime;
+		if (!UntrackedCache::GetLastWriteTime(currentLastWriteTime, workingDirectory, visitedDirectory.RelativePath)
+			|| currentLastWriteTime != visitedDirectory.LastWriteTime
+			|| visitedDirectory.LastWriteTime + RacyTimestampSeconds > cachedDirectory.ReadTime
+			|| UntrackedCache::GetFileStamp(MakeAbsolutePath(workingDirectory, visitedDirectory.RelativePath) / L".gitignore") != visitedDirectory.GitIgnore)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*static*/ void UntrackedCache::Walk(
+	RepositoryCache& cache,
+	UniqueGitRepository& repository,
+	const boost::filesystem::path& workingDirectory,
+	const std::string& relativeDirectory,
+	bool ignoreRulesChanged,
+	std::vector<std::string>& untrackedPaths,
+	WalkStatistics& statistics)
+{
+	std::time_t lastWriteTime;
+	if (!UntrackedCache::GetLastWriteTime(lastWriteTime, workingDirectory, relativeDirectory))
+		return;
+
+	auto gitIgnore = UntrackedCache::GetFileStamp(MakeAbsolutePath(workingDirectory, relativeDirectory) / L".gitignore");
+	auto trackedDirectoryIterator = cache.TrackedDirectories.find(relativeDirectory);
+	auto trackedDirectory = trackedDirectoryIterator != cache.TrackedDirectories.end() ? &trackedDirectoryIterator->second : nullptr;
+	auto trackedHash = trackedDirectory != nullptr ? trackedDirectory->Hash : 0;
+
+	auto& cachedDirectory = cache.Directories[relativeDirectory];
+	cachedDirectory.LastWalk = cache.Walks;
+	auto gitIgnoreChanged = cachedDirectory.GitIgnore != gitIgnore;
+
+	if (!ignoreRulesChanged && UntrackedCache::CanReuse(cachedDirectory, workingDirectory, lastWriteTime, gitIgnore, trackedHash))
+	{
+		++statistics.DirectoriesReused;
+	}
+	else
+	{
+		++statistics.DirectoriesRead;
+		cachedDirectory.ReadTime = std::time(nullptr);
+		cachedDirectory.LastWriteTime = lastWriteTime;
+		cachedDirectory.GitIgnore = gitIgnore;
+		cachedDirectory.TrackedHash = trackedHash;
+		UntrackedCache::ReadDirectory(cachedDirectory, repository, workingDirectory, relativeDirectory, trackedDirectory);
+	}
+
+	untrackedPaths.insert(untrackedPaths.end(), cachedDirectory.Untracked.begin(), cachedDirectory.Untracked.end());
+
+	for (const auto& subdirectory : cachedDirectory.Subdirectories)
+	{
+		UntrackedCache::Walk(
+			cache,
+			repository,
+			workingDirectory,
+			AppendRelativePath(relativeDirectory, subdirectory),
+			ignoreRulesChanged || gitIgnoreChanged,
+			untrackedPaths,
+			statistics);
+	}
+}
+
+bool UntrackedCache::GetUntrackedPaths(
+	std::vector<std::string>& untrackedPaths,
+	const std::string& repositoryPath,
+	const std::string& workingDirectory,
+	UniqueGitRepository& repository)
+{
+	std::shared_ptr<RepositoryCache> cache;
+	{
+		WriteLock writeLock(m_repositoriesMutex);
+		auto& repositoryCache = m_repositories[repositoryPath];
+		if (repositoryCache == nullptr)
+			repositoryCache = std::make_shared<RepositoryCache>();
+		cache = repositoryCache;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->Mutex);
+	if (!UntrackedCache::LoadTrackedDirectories(*cache, repositoryPath, repository))
+		return false;
+
+	auto exclude = UntrackedCache::GetFileStamp(boost::filesystem::path(ConvertToUnicode(repositoryPath)) / L"info" / L"exclude");
+	auto excludesFilePath = UntrackedCache::GetExcludesFilePath(repository);
+	auto excludesFile = excludesFilePath.empty()
+		? FileStamp()
+		: UntrackedCache::GetFileStamp(boost::filesystem::path(ConvertToUnicode(excludesFilePath)));
+	if (exclude != cache->Exclude || excludesFilePath != cache->ExcludesFilePath || excludesFile != cache->ExcludesFile)
+	{
+		cache->Exclude = exclude;
+		cache->ExcludesFilePath = excludesFilePath;
+		cache->ExcludesFile = excludesFile;
+		cache->Directories.clear();
+	}
+
+	WalkStatistics statistics;
+	++cache->Walks;
+	untrackedPaths.clear();
+	UntrackedCache::Walk(
+		*cache,
+		repository,
+		boost::filesystem::path(ConvertToUnicode(workingDirectory)),
+		std::string(),
+		false /*ignoreRulesChanged*/,
+		untrackedPaths,
+		statistics);
+
+	for (auto iterator = cache->Directories.begin(); iterator != cache->Directories.end();)
+	{
+		if (iterator->second.LastWalk != cache->Walks)
+			iterator = cache->Directories.erase(iterator);
+		else
+			++iterator;
+	}
+
+	std::sort(untrackedPaths.begin(), untrackedPaths.end());
+	cache->SizeInBytes = UntrackedCache::GetSizeInBytes(*cache);
+
+	Log("UntrackedCache.GetUntrackedPaths", Severity::Verbose)
+		<< R"(Retrieved untracked paths. { "repositoryPath": ")" << repositoryPath
+		<< R"(", "untrackedPaths": )" << untrackedPaths.size()
+		<< R"(, "directoriesRead": )" << statistics.DirectoriesRead
+		<< R"(, "directoriesReused": )" << statistics.DirectoriesReused << R"( })";
+	return true;
+}
+
+void UntrackedCache::Remove(const std::string& repositoryPath)
+{
+	WriteLock writeLock(m_repositoriesMutex);
+	m_repositories.erase(repositoryPath);
+}
+
+uint64_t UntrackedCache::GetSizeInBytes(const std::string& repositoryPath)
+{
+	ReadLock readLock(m_repositoriesMutex);
+	auto repositoryCache = m_repositories.find(repositoryPath);
+	return repositoryCache == m_repositories.end() ? 0 : repositoryCache->second->SizeInBytes.load();
+}
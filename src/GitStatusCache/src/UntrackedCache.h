@@ -0,0 +1,198 @@
+#pragma once
+
+/**
+* Caches untracked files and directories for each directory in the working tree.
+* Directories whose modification time, .gitignore, and tracked entries are unchanged
+* since they were last read are not read again. Changes to info/exclude or core.excludesFile
+* discard every cached directory. Symbolic links and junctions are never followed.
+* This class is thread-safe.
+*/
+class UntrackedCache : boost::noncopyable
+{
+private:
+	using ReadLock = boost::shared_lock<boost::shared_mutex>;
+	using WriteLock = boost::unique_lock<boost::shared_mutex>;
+
+	/**
+	* Identifies a version of a file by existence, modification time, and size.
+	*/
+	struct FileStamp
+	{
+		bool Exists = false;
+		std::time_t LastWriteTime = 0;
+		uintmax_t Size = 0;
+
+		bool operator==(const FileStamp& other) const
+		{
+			return Exists == other.Exists && LastWriteTime == other.LastWriteTime && Size == other.Size;
+		}
+
+		bool operator!=(const FileStamp& other) const { return !(*this == other); }
+	};
+
+	/**
+	* Names tracked in the index for a single directory.
+	*/
+	struct TrackedDirectory
+	{
+		std::unordered_set<std::string> Files;
+		std::unordered_set<std::string> Subdirectories;
+		size_t Hash = 0;
+	};
+
+	/**
+	* Untracked directory visited while checking for untracked content.
+	*/
+	struct VisitedDirectory
+	{
+		std::string RelativePath;
+		std::time_t LastWriteTime = 0;
+		FileStamp GitIgnore;
+	};
+
+	/**
+	* Result of the last read of a single directory. Untracked directories visited while
+	* checking for untracked content are revalidated by their own modification times and
+	* .gitignore.
+	*/
+	struct CachedDirectory
+	{
+		std::time_t LastWriteTime = 0;
+		std::time_t ReadTime = 0;
+		uint64_t LastWalk = 0;
+		FileStamp GitIgnore;
+		size_t TrackedHash = 0;
+		std::vector<std::string> Subdirectories;
+		std::vector<std::string> Untracked;
+		std::vector<VisitedDirectory> VisitedUntrackedDirectories;
+	};
+
+	/**
+	* Cached state for a single repository. Mutex serializes walks of the repository.
+	* SizeInBytes estimates memory held by the cache as of the last walk.
+	*/
+	struct RepositoryCache
+	{
+		std::mutex Mutex;
+		std::atomic<uint64_t> SizeInBytes = 0;
+		uint64_t Walks = 0;
+		size_t IndexPathsHash = 0;
+		FileStamp Exclude;
+		std::string ExcludesFilePath;
+		FileStamp ExcludesFile;
+		std::unordered_map<std::string, TrackedDirectory> TrackedDirectories;
+		std::unordered_map<std::string, CachedDirectory> Directories;
+	};
+
+	/**
+	* Counters for a single walk of the working tree.
+	*/
+	struct WalkStatistics
+	{
+		size_t DirectoriesRead = 0;
+		size_t DirectoriesReused = 0;
+	};
+
+	std::unordered_map<std::string, std::shared_ptr<RepositoryCache>> m_repositories;
+	boost::shared_mutex m_repositoriesMutex;
+
+	/**
+	* Returns stamp for file at provided path.
+	*/
+	static FileStamp GetFileStamp(const boost::filesystem::path& path);
+
+	/**
+	* Returns path of the excludes file configured by core.excludesFile, or the default excludes
+	* file in the XDG configuration directory. Returns empty path if there is neither.
+	*/
+	static std::string GetExcludesFilePath(UniqueGitRepository& repository);
+
+	/**
+	* Checks if a directory entry should be walked into. Symbolic links and junctions are
+	* treated as files, as in git, even if they point to directories.
+	*/
+	static bool IsDirectory(const boost::filesystem::directory_entry& entry);
+
+	/**
+	* Estimates bytes held by tracked names and cached directories. Cache's mutex must be held.
+	*/
+	static uint64_t GetSizeInBytes(const RepositoryCache& cache);
+
+	/**
+	* Rebuilds tracked names for each directory from the repository's index.
+	*/
+	static bool LoadTrackedDirectories(RepositoryCache& cache, const std::string& repositoryPath, UniqueGitRepository& repository);
+
+	/**
+	* Records modification time of directory relative to the working directory.
+	*/
+	static bool GetLastWriteTime(std::time_t& lastWriteTime, const boost::filesystem::path& workingDirectory, const std::string& relativePath);
+
+	/**
+	* Checks if a path that isn't tracked is ignored. Directories must end with a slash.
+	*/
+	static bool IsIgnored(UniqueGitRepository& repository, const std::string& relativePath);
+
+	/**
+	* Checks if an untracked directory contains any file that isn't ignored.
+	*/
+	static bool ContainsUntrackedContent(
+		UniqueGitRepository& repository,
+		const boost::filesystem::path& workingDirectory,
+		const std::string& relativeDirectory,
+		std::vector<VisitedDirectory>& visitedDirectories);
+
+	/**
+	* Reads directory and records its untracked entries and tracked subdirectories.
+	*/
+	static void ReadDirectory(
+		CachedDirectory& cachedDirectory,
+		UniqueGitRepository& repository,
+		const boost::filesystem::path& workingDirectory,
+		const std::string& relativeDirectory,
+		const TrackedDirectory* trackedDirectory);
+
+	/**
+	* Checks if the cached result for a directory can be reused.
+	*/
+	static bool CanReuse(
+		const CachedDirectory& cachedDirectory,
+		const boost::filesystem::path& workingDirectory,
+		std::time_t lastWriteTime,
+		const FileStamp& gitIgnore,
+		size_t trackedHash);
+
+	/**
+	* Collects untracked paths for directory and its tracked subdirectories.
+	*/
+	static void Walk(
+		RepositoryCache& cache,
+		UniqueGitRepository& repository,
+		const boost::filesystem::path& workingDirectory,
+		const std::string& relativeDirectory,
+		bool ignoreRulesChanged,
+		std::vector<std::string>& untrackedPaths,
+		WalkStatistics& statistics);
+
+public:
+	/**
+	* Retrieves files and directories that are neither tracked nor ignored. Untracked directories
+	* are reported once with a trailing slash, matching libgit2 status without recursion into
+	* untracked directories. Paths are relative to the working directory and sorted.
+	*/
+	bool GetUntrackedPaths(
+		std::vector<std::string>& untrackedPaths,
+		const std::string& repositoryPath,
+		const std::string& workingDirectory,
+		UniqueGitRepository& repository);
+
+	/**
+	* Discards cached directories for repository at provided path.
+	*/
+	void Remove(const std::string& repositoryPath);
+
+	/**
+	* Estimates bytes held by cached directories for repository at provided path.
+	*/
+	uint64_t GetSizeInBytes(const std::string& repositoryPath);
+};
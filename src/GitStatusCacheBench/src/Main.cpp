@@ -0,0 +1,154 @@
+#include "stdafx.h"
+#include <iomanip>
+#include <iostream>
+#include "Cache.h"
+
+const size_t RepositoryCount = 1024;
+const size_t InvalidationThreadCount = 2;
+const uint32_t BenchmarkComponents = Git::FileStatusComponent;
+
+/**
+* Hits and invalidations completed during a single run.
+*/
+struct BenchmarkResult
+{
+	uint64_t Hits = 0;
+	uint64_t Invalidations = 0;
+	double Seconds = 0;
+};
+
+std::string GetRepositoryPath(size_t index)
+{
+	return "C:\\GitStatusCacheBench\\" + std::to_string(index) + "\\.git\\";
+}
+
+/**
+* Hits hitRepositoryPaths from hitThreadCount threads while InvalidationThreadCount threads
+* invalidate invalidatedRepositoryPaths for the provided duration. Both sets of repositories
+* hash to every shard, so hits only scale if invalidations don't serialize them.
+*/
+BenchmarkResult RunBenchmark(
+	Cache& cache,
+	const std::vector<std::string>& hitRepositoryPaths,
+	const std::vector<std::string>& invalidatedRepositoryPaths,
+	size_t hitThreadCount,
+	std::chrono::milliseconds duration)
+{
+	std::atomic<bool> isStopping(false);
+	std::atomic<uint64_t> hits(0);
+	std::atomic<uint64_t> invalidations(0);
+
+	std::vector<std::thread> threads;
+	for (auto i = size_t{ 0 }; i < hitThreadCount; ++i)
+	{
+		threads.emplace_back([i, hitThreadCount, &cache, &hitRepositoryPaths, &isStopping, &hits]()
+		{
+			// Counted locally so the benchmark's own counter doesn't bounce between cores.
+			auto threadHits = uint64_t{ 0 };
+			auto position = i * hitRepositoryPaths.size() / hitThreadCount;
+			while (!isStopping.load(std::memory_order_relaxed))
+			{
+				cache.GetStatus(hitRepositoryPaths[position], BenchmarkComponents);
+				++threadHits;
+				if (++position == hitRepositoryPaths.size())
+					position = 0;
+			}
+			hits += threadHits;
+		});
+	}
+
+	for (auto i = size_t{ 0 }; i < InvalidationThreadCount; ++i)
+	{
+		threads.emplace_back([i, &cache, &invalidatedRepositoryPaths, &isStopping, &invalidations]()
+		{
+			auto threadInvalidations = uint64_t{ 0 };
+			auto position = i * invalidatedRepositoryPaths.size() / InvalidationThreadCount;
+			while (!isStopping.load(std::memory_order_relaxed))
+			{
+				cache.InvalidateCacheEntry(invalidatedRepositoryPaths[position], "file.txt");
+				++threadInvalidations;
+				if (++position == invalidatedRepositoryPaths.size())
+					position = 0;
+			}
+			invalidations += threadInvalidations;
+		});
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(duration);
+	isStopping = true;
+	for (auto& thread : threads)
+		thread.join();
+
+	BenchmarkResult result;
+	result.Hits = hits;
+	result.Invalidations = invalidations;
+	result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	auto duration = std::chrono::milliseconds(argc > 1 ? std::stoul(argv[1]) : 2000);
+	auto maximumThreadCount = static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1u));
+
+	// Entries are restored from statuses that never touch disk, so hits never compute status
+	// and the cache is the only thing measured.
+	GitSettings gitSettings;
+	std::unique_ptr<Cache> cache(new Cache(gitSettings));
+	FILETIME now;
+	::GetSystemTimeAsFileTime(&now);
+	auto computeStartTime = (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+	std::vector<std::string> hitRepositoryPaths;
+	std::vector<std::string> invalidatedRepositoryPaths;
+	for (auto i = size_t{ 0 }; i < RepositoryCount; ++i)
+	{
+		Git::Status status;
+		status.RepositoryPath = GetRepositoryPath(i);
+		status.WorkingDirectory = status.RepositoryPath.substr(0, status.RepositoryPath.size() - 5);
+		status.Components = BenchmarkComponents;
+		cache->RestoreCacheEntry(status, computeStartTime);
+
+		if (i % 2 == 0)
+			hitRepositoryPaths.push_back(status.RepositoryPath);
+		else
+			invalidatedRepositoryPaths.push_back(status.RepositoryPath);
+	}
+
+	std::cout << "Cache hits with " << InvalidationThreadCount << " threads invalidating other repositories for "
+		<< duration.count() << " ms per run." << std::endl;
+	std::cout << std::setw(8) << "Threads"
+		<< std::setw(16) << "Hits/s"
+		<< std::setw(16) << "Hits/s/thread"
+		<< std::setw(10) << "Scaling"
+		<< std::setw(18) << "Invalidations/s" << std::endl;
+
+	auto singleThreadHitsPerSecond = 0.0;
+	for (auto threadCount = size_t{ 1 }; ; threadCount = (std::min)(threadCount * 2, maximumThreadCount))
+	{
+		auto result = RunBenchmark(*cache, hitRepositoryPaths, invalidatedRepositoryPaths, threadCount, duration);
+		auto hitsPerSecond = result.Hits / result.Seconds;
+		if (threadCount == 1)
+			singleThreadHitsPerSecond = hitsPerSecond;
+
+		std::cout << std::fixed << std::setprecision(0)
+			<< std::setw(8) << threadCount
+			<< std::setw(16) << hitsPerSecond
+			<< std::setw(16) << hitsPerSecond / threadCount
+			<< std::setw(9) << std::setprecision(2) << hitsPerSecond / singleThreadHitsPerSecond << "x"
+			<< std::setw(18) << std::setprecision(0) << result.Invalidations / result.Seconds << std::endl;
+
+		if (threadCount == maximumThreadCount)
+			break;
+	}
+
+	// Hits on invalidated entries would have computed status and skewed the results.
+	auto statistics = cache->GetCacheStatistics();
+	if (statistics.CacheMisses != 0)
+	{
+		std::cerr << "Error: " << statistics.CacheMisses << " requests missed the cache." << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <stdio.h>
+#include <codecvt>
+#include <locale>
+#include <string>
+#include <vector>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+const DWORD BufferSize = 4096;
+const DWORD PipeTimeoutInMilliseconds = 1000;
+
+std::string ConvertToUtf8(const std::wstring& unicode)
+{
+	std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+	return converter.to_bytes(unicode);
+}
+
+std::string BuildRequest(const std::string& path, const std::string& token)
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer{buffer};
+
+	writer.StartObject();
+	writer.String("Version");
+	writer.Uint(1);
+	writer.String("Action");
+	writer.String("GetFsmonitorChanges");
+	writer.String("Path");
+	writer.String(path.c_str());
+	writer.String("Token");
+	writer.String(token.c_str());
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+bool SendRequest(const std::string& request, std::string& response)
+{
+	auto pipeName = L"\\\\.\\pipe\\GitStatusCache";
+	auto pipe = ::CreateFile(pipeName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (pipe == INVALID_HANDLE_VALUE)
+	{
+		if (::GetLastError() != ERROR_PIPE_BUSY || !::WaitNamedPipe(pipeName, PipeTimeoutInMilliseconds))
+			return false;
+
+		pipe = ::CreateFile(pipeName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		if (pipe == INVALID_HANDLE_VALUE)
+			return false;
+	}
+
+	DWORD mode = PIPE_READMODE_MESSAGE;
+	DWORD bytesWritten = 0;
+	auto succeeded = ::SetNamedPipeHandleState(pipe, &mode, nullptr, nullptr)
+		&& ::WriteFile(pipe, request.data(), static_cast<DWORD>(request.size()), &bytesWritten, nullptr);
+
+	auto buffer = std::vector<char>(BufferSize);
+	while (succeeded)
+	{
+		DWORD bytesRead = 0;
+		auto readResult = ::ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), &bytesRead, nullptr);
+		response.append(buffer.data(), bytesRead);
+		if (readResult)
+			break;
+		succeeded = ::GetLastError() == ERROR_MORE_DATA;
+	}
+
+	::CloseHandle(pipe);
+	return succeeded;
+}
+
+bool WriteResponse(const std::string& response)
+{
+	rapidjson::Document document;
+	const auto& parser = document.Parse(response.c_str());
+	if (parser.HasParseError() || document.HasMember("Error"))
+		return false;
+
+	if (!document.HasMember("Token") || !document["Token"].IsString()
+		|| !document.HasMember("AllChanged") || !document["AllChanged"].IsBool()
+		|| !document.HasMember("Paths") || !document["Paths"].IsArray())
+	{
+		return false;
+	}
+
+	// Protocol version 2 output is the new token followed by changed paths, each terminated
+	// by NUL. A single "/" path tells git every path may have changed.
+	std::string output(document["Token"].GetString());
+	output.push_back('\0');
+	if (document["AllChanged"].GetBool())
+	{
+		output.append("/");
+		output.push_back('\0');
+	}
+	else
+	{
+		const auto& paths = document["Paths"];
+		for (auto path = paths.Begin(); path != paths.End(); ++path)
+		{
+			if (!path->IsString())
+				return false;
+			output.append(path->GetString(), path->GetStringLength());
+			output.push_back('\0');
+		}
+	}
+
+	_setmode(_fileno(stdout), _O_BINARY);
+	return fwrite(output.data(), 1, output.size(), stdout) == output.size() && fflush(stdout) == 0;
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	// Non-zero exit makes git fall back to scanning the working tree.
+	if (argc != 3 || std::wstring(argv[1]) != L"2")
+	{
+		fwprintf(stderr, L"Usage: %s 2 <token>\n", argc > 0 ? argv[0] : L"GitStatusCacheFsmonitor");
+		return 1;
+	}
+
+	auto currentDirectory = std::vector<wchar_t>(MAX_PATH);
+	auto length = ::GetCurrentDirectory(static_cast<DWORD>(currentDirectory.size()), currentDirectory.data());
+	if (length > currentDirectory.size())
+	{
+		currentDirectory.resize(length);
+		length = ::GetCurrentDirectory(static_cast<DWORD>(currentDirectory.size()), currentDirectory.data());
+	}
+	if (length == 0 || length > currentDirectory.size())
+		return 1;
+
+	auto path = ConvertToUtf8(std::wstring(currentDirectory.data(), length));
+	auto token = ConvertToUtf8(argv[2]);
+
+	std::string response;
+	if (!SendRequest(BuildRequest(path, token), response))
+		return 1;
+
+	return WriteResponse(response) ? 0 : 1;
+}